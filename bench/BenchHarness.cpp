@@ -0,0 +1,249 @@
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <thread>
+#include <vector>
+
+#include "BenchHarness.h"
+#include "../include/Common.h"
+
+using namespace std;
+
+// The simulation objects refer to the global log. Benchmarks leave it closed and
+// switch its level off, so events cost one check each.
+
+AsyncLog simLog;
+
+// Registered benchmarks, in registration order
+
+struct BenchEntry {
+    string name;
+    BenchFunction function;
+    uint64_t iterations;
+};
+
+static vector<BenchEntry>& registry() {
+    static vector<BenchEntry> entries;
+    return entries;
+}
+
+BenchRegistrar::BenchRegistrar(const char* name, BenchFunction function, uint64_t iterations) {
+    registry().push_back({name, function, iterations});
+}
+
+// Constructor for a run of the given number of iterations.
+
+BenchState::BenchState(uint64_t iterations) : wanted(iterations), done(0), started(false), allocationsAtStart(0), seconds(0.0), allocations(0) {}
+
+// Counts iterations; the clock and the allocation counter run from the first call
+// to the call that ends the loop.
+
+bool BenchState::keepRunning() {
+    if (!started) {
+        started = true;
+        allocationsAtStart = allocationCount();
+        start = chrono::steady_clock::now();
+    }
+
+    if (done < wanted) {
+        done++;
+        return true;
+    }
+
+    pauseTiming();
+    return false;
+}
+
+void BenchState::pauseTiming() {
+    seconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    allocations += allocationCount() - allocationsAtStart;
+}
+
+void BenchState::resumeTiming() {
+    allocationsAtStart = allocationCount();
+    start = chrono::steady_clock::now();
+}
+
+uint64_t BenchState::iterations() const {
+    return wanted;
+}
+
+void BenchState::fail(const string& reason) {
+    failure = reason;
+}
+
+// Result of one benchmark
+
+struct BenchResult {
+    string name;
+    uint64_t iterations;
+    double nsPerIteration;
+    double allocationsPerIteration;
+    map<string, double> counters;
+    string failure;
+};
+
+// Runs a benchmark. Without a fixed count the iterations grow (about tenfold,
+// less when the last run was close) until a run takes at least minTime seconds.
+
+static BenchResult runBenchmark(const BenchEntry& entry, double minTime) {
+    uint64_t iterations = entry.iterations > 0 ? entry.iterations : 1;
+    BenchState state(iterations);
+
+    while (true) {
+        state = BenchState(iterations);
+        entry.function(state);
+
+        if (entry.iterations > 0 || !state.failure.empty() || state.seconds >= minTime || iterations >= ((uint64_t)1 << 40)) break;
+
+        double scale = (state.seconds > 0.0) ? 1.4 * minTime / state.seconds : 10.0;
+        if (scale > 10.0) scale = 10.0;
+        if (scale < 2.0) scale = 2.0;
+        iterations = (uint64_t)(iterations * scale);
+    }
+
+    BenchResult result;
+    result.name = entry.name;
+    result.iterations = iterations;
+    result.nsPerIteration = state.seconds * 1e9 / iterations;
+    result.allocationsPerIteration = (double)state.allocations / iterations;
+    result.counters = state.counters;
+    result.failure = state.failure;
+    return result;
+}
+
+// Writes the results in the layout of Google Benchmark's JSON reporter.
+
+static bool writeJson(const string& path, const vector<BenchResult>& results, double minTime) {
+    ofstream out(path.c_str());
+    if (!out) return false;
+
+    time_t now = time(0);
+    char date[32];
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+
+#ifdef __OPTIMIZE__
+    const char* buildType = "release";
+#else
+    const char* buildType = "debug";
+#endif
+
+    out << setprecision(10);
+    out << "{\n  \"context\": {\n";
+    out << "    \"date\": \"" << date << "\",\n";
+    out << "    \"num_cpus\": " << thread::hardware_concurrency() << ",\n";
+    out << "    \"library_build_type\": \"" << buildType << "\",\n";
+    out << "    \"min_time\": " << minTime << "\n";
+    out << "  },\n  \"benchmarks\": [\n";
+
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchResult& r = results[i];
+
+        out << "    {\n";
+        out << "      \"name\": \"" << r.name << "\",\n";
+        out << "      \"iterations\": " << r.iterations << ",\n";
+        out << "      \"real_time\": " << r.nsPerIteration << ",\n";
+        out << "      \"time_unit\": \"ns\",\n";
+        out << "      \"allocs_per_iter\": " << r.allocationsPerIteration;
+
+        for (map<string, double>::const_iterator c = r.counters.begin(); c != r.counters.end(); ++c)
+            out << ",\n      \"" << c->first << "\": " << c->second;
+
+        out << "\n    }" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+
+    out << "  ]\n}\n";
+    return (bool)out;
+}
+
+// Prints the usage of avs-bench.
+
+static void printUsage() {
+    cout << "Usage: avs-bench [options]" << endl;
+    cout << " --filter <text> Only run benchmarks whose name contains text" << endl;
+    cout << " --min-time <s> Minimum time per adaptive benchmark (default : 0.2)" << endl;
+    cout << " --json <file> Write the results as JSON" << endl;
+    cout << " --list List the benchmarks and exit" << endl;
+}
+
+int main(int argc, char** argv) {
+    string filter;
+    string jsonPath;
+    double minTime = 0.2;
+    bool list = false;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+
+        if (arg == "--filter" && (i + 1) < argc) filter = argv[++i];
+
+        else if (arg == "--min-time" && (i + 1) < argc) minTime = atof(argv[++i]);
+
+        else if (arg == "--json" && (i + 1) < argc) jsonPath = argv[++i];
+
+        else if (arg == "--list") list = true;
+
+        else {
+            printUsage();
+            return 1;
+        }
+    }
+
+    simLog.setLevel(LOG_OFF);
+
+    vector<BenchResult> results;
+    int failed = 0;
+
+    if (!list) {
+        cout << left << setw(36) << "Benchmark" << right << setw(16) << "Time/iter" << setw(12) << "Iterations" << setw(14) << "Allocs/iter" << "  Counters" << endl;
+        cout << string(100, '-') << endl;
+    }
+
+    for (size_t i = 0; i < registry().size(); ++i) {
+        const BenchEntry& entry = registry()[i];
+        if (!filter.empty() && entry.name.find(filter) == string::npos) continue;
+
+        if (list) {
+            cout << entry.name << endl;
+            continue;
+        }
+
+        BenchResult r = runBenchmark(entry, minTime);
+        results.push_back(r);
+
+        ostringstream time;
+        time << fixed << setprecision(r.nsPerIteration < 1e4 ? 1 : 0) << r.nsPerIteration << " ns";
+
+        cout << left << setw(36) << r.name << right << setw(16) << time.str() << setw(12) << r.iterations
+             << setw(14) << fixed << setprecision(2) << r.allocationsPerIteration << " ";
+
+        for (map<string, double>::const_iterator c = r.counters.begin(); c != r.counters.end(); ++c)
+            cout << " " << c->first << "=" << setprecision(c->second < 100 ? 2 : 0) << c->second;
+
+        cout << endl;
+
+        if (!r.failure.empty()) {
+            cout << "  FAILED: " << r.failure << endl;
+            failed++;
+        }
+    }
+
+    if (!jsonPath.empty() && !list) {
+        if (!writeJson(jsonPath, results, minTime)) {
+            cout << "Error: Could not write '" << jsonPath << "'!" << endl;
+            return 1;
+        }
+        cout << "Results written to " << jsonPath << endl;
+    }
+
+    if (failed > 0) {
+        cout << failed << " benchmark" << (failed > 1 ? "s" : "") << " failed." << endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,81 @@
+#ifndef BENCH_HARNESS_H
+#define BENCH_HARNESS_H
+
+#include <cstdint>
+#include <chrono>
+#include <map>
+#include <string>
+
+#include "../include/Profiler.h"
+
+// Small benchmark harness in the style of Google Benchmark, without the dependency.
+//
+//     static void BM_Something(BenchState& state) {
+//         ... setup, not timed ...
+//         while (state.keepRunning()) {
+//             ... timed body, one iteration ...
+//         }
+//         state.counters["items_per_iter"] = ...;
+//     }
+//     AVS_BENCHMARK(BM_Something, "Something/variant", 0);
+//
+// A benchmark registered with 0 iterations is run with a growing iteration count
+// until it takes at least --min-time; otherwise it runs exactly that many times.
+// Heap allocations inside the timed loop are counted for every benchmark (through
+// allocationCount() of the simulator, see Profiler.h). A benchmark that checks a
+// property calls state.fail(); avs-bench then reports it and exits with status 1.
+
+class BenchState {
+    private:
+        uint64_t wanted;
+        uint64_t done;
+        bool started;
+        std::chrono::steady_clock::time_point start;
+        uint64_t allocationsAtStart;
+
+    public:
+        double seconds;
+        uint64_t allocations;
+
+        // Extra results, reported next to the time per iteration
+
+        std::map<std::string, double> counters;
+
+        // Why the benchmark failed (empty if it did not)
+
+        std::string failure;
+
+        explicit BenchState(uint64_t iterations);
+
+        // True while another iteration should run; starts the clock on the first call
+
+        bool keepRunning();
+
+        // Excludes the work between pauseTiming() and resumeTiming() from the result
+
+        void pauseTiming();
+
+        void resumeTiming();
+
+        uint64_t iterations() const;
+
+        // Marks the benchmark as failed
+
+        void fail(const std::string& reason);
+};
+
+typedef void (*BenchFunction)(BenchState&);
+
+// Adds a benchmark to the registry (used through AVS_BENCHMARK)
+
+struct BenchRegistrar {
+    BenchRegistrar(const char* name, BenchFunction function, uint64_t iterations);
+};
+
+#define AVS_BENCH_JOIN2(a, b) a##b
+#define AVS_BENCH_JOIN(a, b) AVS_BENCH_JOIN2(a, b)
+
+#define AVS_BENCHMARK(function, name, iterations) \
+    static BenchRegistrar AVS_BENCH_JOIN(benchRegistrar, __LINE__)(name, function, iterations)
+
+#endif
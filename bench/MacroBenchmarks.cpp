@@ -0,0 +1,191 @@
+#include "BenchHarness.h"
+#include "../include/GridWorld.h"
+
+using namespace std;
+
+// Macro benchmarks: whole ticks of generated cities, small to huge, sparse and dense.
+// One iteration is one GridWorld::update() with a fleet of four cars; generation is
+// not timed. allocs_per_iter is the number of allocations per tick.
+
+struct Scenario {
+    int size;
+    int movers;
+    int parked;
+    int signs;
+    int lights;
+};
+
+// Small and medium cities tick their objects directly, the huge ones run on the
+// actor store (--soa) that large worlds would use.
+
+static const Scenario SMALL_SPARSE = {40, 5, 5, 2, 2};
+static const Scenario SMALL_DENSE = {40, 300, 200, 50, 50};
+static const Scenario MEDIUM_SPARSE = {200, 1000, 600, 200, 200};
+static const Scenario MEDIUM_DENSE = {200, 8000, 6000, 1000, 1000};
+static const Scenario HUGE_SPARSE = {2000, 100000, 60000, 20000, 20000};
+static const Scenario HUGE_DENSE = {2000, 800000, 600000, 100000, 100000};
+
+// Runs the ticks of one scenario. A target density keeps the traffic topped up
+// from the edges, so long runs measure a steady state instead of an emptying city.
+
+static void runScenario(BenchState& state, const Scenario& scenario, bool actorStore, double density = 0.0) {
+    SimSettings settings = parseArguments(0, nullptr);
+    settings.seed = 42;
+    settings.dimX = scenario.size;
+    settings.dimY = scenario.size;
+    settings.numMovingCars = scenario.movers / 2;
+    settings.numMovingBikes = scenario.movers - scenario.movers / 2;
+    settings.numParkedCars = scenario.parked;
+    settings.numStopSigns = scenario.signs;
+    settings.numTrafficLights = scenario.lights;
+    settings.placement = PLACEMENT_SHUFFLE;
+    settings.useActorStore = actorStore;
+    settings.render = RENDER_NONE;
+    settings.fleetSize = 4;
+    settings.targetDensity = density;
+
+    for (int i = 0; i < settings.fleetSize; ++i)
+        settings.gpsTargets.push_back({scenario.size / 4 + i * scenario.size / 8, scenario.size / 2});
+
+    GridWorld world(settings.dimX, settings.dimY);
+    world.generateWorld(settings);
+
+    size_t objects = world.getObjects().size();
+
+    while (state.keepRunning()) world.update();
+
+    state.counters["objects"] = (double)objects;
+    state.counters["ticks_per_sec"] = state.iterations() / state.seconds;
+    state.counters["ns_per_object"] = state.seconds * 1e9 / state.iterations() / objects;
+
+    if (density > 0.0) {
+        state.counters["movers_at_end"] = (double)world.getMovers();
+        state.counters["pool_slots"] = (double)world.getObjectPool().getCapacity();
+    }
+}
+
+static void BM_SmallSparse(BenchState& state) {
+    runScenario(state, SMALL_SPARSE, false);
+}
+
+static void BM_SmallDense(BenchState& state) {
+    runScenario(state, SMALL_DENSE, false);
+}
+
+static void BM_MediumSparse(BenchState& state) {
+    runScenario(state, MEDIUM_SPARSE, false);
+}
+
+static void BM_MediumDense(BenchState& state) {
+    runScenario(state, MEDIUM_DENSE, false);
+}
+
+static void BM_HugeSparse(BenchState& state) {
+    runScenario(state, HUGE_SPARSE, true);
+}
+
+static void BM_HugeDense(BenchState& state) {
+    runScenario(state, HUGE_DENSE, true);
+}
+
+// Medium sparse city held at its starting traffic for 1000 ticks
+
+static void BM_MediumSteady(BenchState& state) {
+    runScenario(state, MEDIUM_SPARSE, false, 0.025);
+}
+
+AVS_BENCHMARK(BM_SmallSparse, "Scenario/small/sparse", 500);
+AVS_BENCHMARK(BM_SmallDense, "Scenario/small/dense", 500);
+AVS_BENCHMARK(BM_MediumSparse, "Scenario/medium/sparse", 100);
+AVS_BENCHMARK(BM_MediumDense, "Scenario/medium/dense", 100);
+AVS_BENCHMARK(BM_MediumSteady, "Scenario/medium/steady", 1000);
+AVS_BENCHMARK(BM_HugeSparse, "Scenario/huge/sparse", 10);
+AVS_BENCHMARK(BM_HugeDense, "Scenario/huge/dense", 10);
+
+// Allocation checks ('make check'): once a city has warmed up, a tick must not
+// allocate. Reading buffers, fusion tables, planner scratch, index buckets and the
+// thread pool's task slots all keep their capacity between ticks. Each case warms
+// up, untimed, then fails if any of the measured ticks allocates. The self-driving
+// cars drive across the city, so sensing, fusion, planning and repairs are all live.
+
+static const int STEADY_WARMUP_TICKS = 100;
+
+static void runSteady(BenchState& state, int fleet, int threads) {
+    SimSettings settings = parseArguments(0, nullptr);
+    settings.seed = 42;
+    settings.dimX = 100;
+    settings.dimY = 100;
+    settings.numMovingCars = 400;
+    settings.numMovingBikes = 400;
+    settings.numParkedCars = 600;
+    settings.numStopSigns = 60;
+    settings.numTrafficLights = 60;
+    settings.placement = PLACEMENT_SHUFFLE;
+    settings.useActorStore = threads > 1;
+    settings.threads = threads;
+    settings.render = RENDER_NONE;
+    settings.fleetSize = fleet;
+    settings.gpsTargets = {{90, 90}, {10, 90}, {90, 10}, {10, 10}};
+
+    GridWorld world(settings.dimX, settings.dimY);
+    world.generateWorld(settings);
+
+    for (int t = 0; t < STEADY_WARMUP_TICKS; ++t) world.update();
+
+    while (state.keepRunning()) world.update();
+
+    state.counters["ticks_per_sec"] = state.iterations() / state.seconds;
+
+    if (state.allocations > 0)
+        state.fail(to_string(state.allocations) + " allocations in " + to_string(state.iterations()) + " steady-state ticks");
+}
+
+static void BM_SteadySingle(BenchState& state) {
+    runSteady(state, 1, 1);
+}
+
+static void BM_SteadyFleet(BenchState& state) {
+    runSteady(state, 16, 1);
+}
+
+static void BM_SteadyThreads(BenchState& state) {
+    runSteady(state, 1, 4);
+}
+
+static void BM_SteadyFleetThreads(BenchState& state) {
+    runSteady(state, 16, 4);
+}
+
+AVS_BENCHMARK(BM_SteadySingle, "Steady/single", 400);
+AVS_BENCHMARK(BM_SteadyFleet, "Steady/fleet", 400);
+AVS_BENCHMARK(BM_SteadyThreads, "Steady/threads", 400);
+AVS_BENCHMARK(BM_SteadyFleetThreads, "Steady/fleet/threads", 400);
+
+// Sensor package check ('make check'): a radar whose range reaches back over the
+// car's own cell. The car is in the spatial index, so a sensor that reported it
+// would see a car in its way and stop for good. With the default package this
+// route takes 31 ticks; the case fails unless the car finishes it within 100.
+
+static void BM_PackageOwnCell(BenchState& state) {
+    SimSettings settings = parseArguments(0, nullptr);
+    settings.seed = 3;
+    settings.render = RENDER_NONE;
+    settings.gpsTargets = {{10, 20}, {32, 15}};
+    settings.sensors = defaultSensorPackage();
+
+    for (size_t s = 0; s < settings.sensors.size(); ++s)
+        if (settings.sensors[s].kind == SENSOR_RADAR) settings.sensors[s].minAhead = -2;
+
+    GridWorld world(settings.dimX, settings.dimY);
+    world.generateWorld(settings);
+
+    const CarStats& stats = world.getCar()->getStats();
+
+    while (state.keepRunning())
+        if (stats.outcome == CAR_RUNNING) world.update();
+
+    if (stats.targetsReached < (int)settings.gpsTargets.size())
+        state.fail("reached " + to_string(stats.targetsReached) + " of " + to_string(settings.gpsTargets.size()) + " targets with the radar over the car's cell");
+}
+
+AVS_BENCHMARK(BM_PackageOwnCell, "Package/own-cell", 100);
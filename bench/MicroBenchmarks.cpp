@@ -0,0 +1,320 @@
+#include <iostream>
+#include <streambuf>
+#include <vector>
+
+#include "BenchHarness.h"
+#include "../include/GridWorld.h"
+#include "../include/Renderer.h"
+#include "../include/Sensors.h"
+#include "../include/VehicleSystem.h"
+
+using namespace std;
+
+// Micro benchmarks: single hot functions on a 200x200 city with about a fifth of
+// the cells taken (the density where sensors see the most objects per scan).
+
+static const int CITY_SIZE = 200;
+
+// Scan positions cycled through by the sensor and fusion benchmarks
+
+static const int SCAN_POSITIONS = 256;
+
+// Default settings with a given size and object counts
+
+static SimSettings citySettings(int size, int movers, int parked, int signs, int lights) {
+    SimSettings settings = parseArguments(0, nullptr);
+    settings.seed = 42;
+    settings.dimX = size;
+    settings.dimY = size;
+    settings.numMovingCars = movers / 2;
+    settings.numMovingBikes = movers - movers / 2;
+    settings.numParkedCars = parked;
+    settings.numStopSigns = signs;
+    settings.numTrafficLights = lights;
+    settings.placement = PLACEMENT_SHUFFLE;
+    settings.render = RENDER_NONE;
+    settings.gpsTargets.push_back({size / 2, size / 2});
+    return settings;
+}
+
+static SimSettings denseCity() {
+    return citySettings(CITY_SIZE, 4000, 3200, 400, 400);
+}
+
+// Random cells of the world to scan from
+
+static vector<Position> scanPositions(int size) {
+    Random rng(7);
+    vector<Position> positions;
+
+    for (int i = 0; i < SCAN_POSITIONS; ++i) positions.push_back({(int)rng.below(size), (int)rng.below(size)});
+    return positions;
+}
+
+// One sensor's getReadings() from changing positions and headings.
+
+template <typename SensorType>
+static void scanBenchmark(BenchState& state) {
+    SimSettings settings = denseCity();
+    GridWorld world(settings.dimX, settings.dimY);
+    world.generateWorld(settings);
+
+    SensorType sensor("BENCH");
+    sensor.setNoiseEngine(world.getNoiseEngine(), 1);
+
+    vector<Position> positions = scanPositions(settings.dimX);
+    vector<SensorReading> out;
+    size_t next = 0;
+    uint64_t readings = 0;
+
+    while (state.keepRunning()) {
+        Position p = positions[next % SCAN_POSITIONS];
+        sensor.getReadings(world.getSpatialIndex(), p, (Direction)(next % 4), 1, out);
+        readings += out.size();
+        next++;
+    }
+
+    state.counters["readings_per_scan"] = (double)readings / state.iterations();
+}
+
+static void BM_LidarScan(BenchState& state) {
+    scanBenchmark<Lidar>(state);
+}
+
+static void BM_RadarScan(BenchState& state) {
+    scanBenchmark<Radar>(state);
+}
+
+static void BM_CameraScan(BenchState& state) {
+    scanBenchmark<Camera>(state);
+}
+
+AVS_BENCHMARK(BM_LidarScan, "Lidar::getReadings", 0);
+AVS_BENCHMARK(BM_RadarScan, "Radar::getReadings", 0);
+AVS_BENCHMARK(BM_CameraScan, "Camera::getReadings", 0);
+
+// All three sensors in one pass of the sensor suite, same positions and headings
+// (compare with the sum of the three scans above).
+
+static void BM_SuiteScan(BenchState& state) {
+    SimSettings settings = denseCity();
+    GridWorld world(settings.dimX, settings.dimY);
+    world.generateWorld(settings);
+
+    Lidar lidar("LIDAR");
+    Radar radar("RADAR");
+    Camera camera("CAMERA");
+    lidar.setNoiseEngine(world.getNoiseEngine(), 1);
+    radar.setNoiseEngine(world.getNoiseEngine(), 2);
+    camera.setNoiseEngine(world.getNoiseEngine(), 3);
+    SensorSuite suite({&lidar, &radar, &camera});
+
+    vector<Position> positions = scanPositions(settings.dimX);
+    vector<SensorReading> lidarOut, radarOut, cameraOut;
+    vector<SensorReading>* const out[3] = {&lidarOut, &radarOut, &cameraOut};
+    size_t next = 0;
+    uint64_t readings = 0;
+
+    while (state.keepRunning()) {
+        Position p = positions[next % SCAN_POSITIONS];
+        suite.getReadings(world.getSpatialIndex(), p, (Direction)(next % 4), 1, out);
+        readings += lidarOut.size() + radarOut.size() + cameraOut.size();
+        next++;
+    }
+
+    state.counters["readings_per_scan"] = (double)readings / state.iterations();
+}
+
+AVS_BENCHMARK(BM_SuiteScan, "SensorSuite::getReadings", 0);
+
+// A range-test kernel on its own: the Camera footprint over all objects of the
+// dense city, gathered once, from changing positions and headings. A kernel the
+// CPU lacks falls back (and says so in the counters). The generic variants run
+// the kernel that reads the footprint at run time instead of the one compiled
+// for the Camera's bounds.
+
+static void kernelBenchmark(BenchState& state, SensorKernelMode mode, bool generic) {
+    SimSettings settings = denseCity();
+    GridWorld world(settings.dimX, settings.dimY);
+    world.generateWorld(settings);
+
+    SensorCandidates objects;
+    objects.gather(world.getSpatialIndex(), 0, 0, settings.dimX - 1, settings.dimY - 1);
+
+    Camera camera("BENCH");
+    SensorFootprint footprint = camera.getFootprint();
+    if (generic) footprint.shape = FOOTPRINT_GENERIC;
+
+    SensorHits hits;
+    vector<Position> positions = scanPositions(settings.dimX);
+    size_t next = 0;
+    uint64_t found = 0;
+
+    SensorKernelMode used = selectSensorKernel(mode);
+
+    while (state.keepRunning()) {
+        rangeTest(footprint, positions[next % SCAN_POSITIONS], (Direction)(next % 4),
+            objects.x.data(), objects.y.data(), objects.mover.data(), objects.size(), hits);
+        found += hits.count;
+        next++;
+    }
+
+    selectSensorKernel(KERNEL_AUTO);
+
+    state.counters["ns_per_object"] = state.seconds * 1e9 / state.iterations() / objects.size();
+    state.counters["hits_per_test"] = (double)found / state.iterations();
+    if (used != mode) state.counters["fell_back"] = 1;
+}
+
+static void BM_KernelScalar(BenchState& state) {
+    kernelBenchmark(state, KERNEL_SCALAR, false);
+}
+
+static void BM_KernelSse4(BenchState& state) {
+    kernelBenchmark(state, KERNEL_SSE4, false);
+}
+
+static void BM_KernelAvx2(BenchState& state) {
+    kernelBenchmark(state, KERNEL_AVX2, false);
+}
+
+static void BM_KernelScalarGeneric(BenchState& state) {
+    kernelBenchmark(state, KERNEL_SCALAR, true);
+}
+
+static void BM_KernelSse4Generic(BenchState& state) {
+    kernelBenchmark(state, KERNEL_SSE4, true);
+}
+
+static void BM_KernelAvx2Generic(BenchState& state) {
+    kernelBenchmark(state, KERNEL_AVX2, true);
+}
+
+AVS_BENCHMARK(BM_KernelScalar, "rangeTest/scalar", 0);
+AVS_BENCHMARK(BM_KernelSse4, "rangeTest/sse4", 0);
+AVS_BENCHMARK(BM_KernelAvx2, "rangeTest/avx2", 0);
+AVS_BENCHMARK(BM_KernelScalarGeneric, "rangeTest/scalar/generic", 0);
+AVS_BENCHMARK(BM_KernelSse4Generic, "rangeTest/sse4/generic", 0);
+AVS_BENCHMARK(BM_KernelAvx2Generic, "rangeTest/avx2/generic", 0);
+
+// Fusion of the three sensors' batches, prepared for every scan position beforehand.
+
+static void BM_Fusion(BenchState& state) {
+    SimSettings settings = denseCity();
+    GridWorld world(settings.dimX, settings.dimY);
+    world.generateWorld(settings);
+
+    Lidar lidar("LIDAR");
+    Radar radar("RADAR");
+    Camera camera("CAMERA");
+    lidar.setNoiseEngine(world.getNoiseEngine(), 1);
+    radar.setNoiseEngine(world.getNoiseEngine(), 2);
+    camera.setNoiseEngine(world.getNoiseEngine(), 3);
+
+    vector<Position> positions = scanPositions(settings.dimX);
+    vector<vector<SensorReading>> batches(SCAN_POSITIONS * 3);
+
+    for (int i = 0; i < SCAN_POSITIONS; ++i) {
+        Direction dir = (Direction)(i % 4);
+        lidar.getReadings(world.getSpatialIndex(), positions[i], dir, 1, batches[i * 3]);
+        radar.getReadings(world.getSpatialIndex(), positions[i], dir, 1, batches[i * 3 + 1]);
+        camera.getReadings(world.getSpatialIndex(), positions[i], dir, 1, batches[i * 3 + 2]);
+    }
+
+    SelfDrivingCar* car = world.getCar();
+    vector<SensorReading> fused;
+    size_t next = 0;
+    uint64_t readings = 0;
+
+    while (state.keepRunning()) {
+        size_t i = (next % SCAN_POSITIONS) * 3;
+        car->fuseSensorData(batches[i], batches[i + 1], batches[i + 2], fused);
+        readings += batches[i].size() + batches[i + 1].size() + batches[i + 2].size();
+        next++;
+    }
+
+    state.counters["readings_per_fusion"] = (double)readings / state.iterations();
+}
+
+AVS_BENCHMARK(BM_Fusion, "SelfDrivingCar::fuseSensorData", 0);
+
+// One tick of the dense city (objects, then the car).
+
+static void BM_WorldUpdate(BenchState& state) {
+    SimSettings settings = denseCity();
+    GridWorld world(settings.dimX, settings.dimY);
+    world.generateWorld(settings);
+
+    size_t objects = world.getObjects().size();
+
+    while (state.keepRunning()) world.update();
+
+    state.counters["objects_at_start"] = (double)objects;
+}
+
+AVS_BENCHMARK(BM_WorldUpdate, "GridWorld::update", 100);
+
+// World generation; getRandomEmptyPosition() is private, so it is measured through
+// the placement loop of generateWorld() on a world that ends up half full.
+
+static void generationBenchmark(BenchState& state, PlacementMode placement) {
+    SimSettings settings = citySettings(CITY_SIZE, 8000, 8000, 2000, 2000);
+    settings.placement = placement;
+    size_t objects = 0;
+
+    while (state.keepRunning()) {
+        GridWorld* world = new GridWorld(settings.dimX, settings.dimY);
+        world->generateWorld(settings);
+
+        state.pauseTiming();
+        objects = world->getObjects().size();
+        delete world;
+        state.resumeTiming();
+    }
+
+    state.counters["objects"] = (double)objects;
+}
+
+static void BM_GenerateRejection(BenchState& state) {
+    generationBenchmark(state, PLACEMENT_REJECTION);
+}
+
+static void BM_GenerateShuffle(BenchState& state) {
+    generationBenchmark(state, PLACEMENT_SHUFFLE);
+}
+
+AVS_BENCHMARK(BM_GenerateRejection, "GridWorld::generateWorld/rejection", 0);
+AVS_BENCHMARK(BM_GenerateShuffle, "GridWorld::generateWorld/shuffle", 0);
+
+// Discards everything written to it
+
+class NullBuffer : public streambuf {
+    protected:
+        virtual int overflow(int c) override {
+            return c;
+        }
+
+        virtual streamsize xsputn(const char*, streamsize n) override {
+            return n;
+        }
+};
+
+// Full map frame of the dense city (the framebuffer that replaced the per-cell
+// glyph lookup). The frame goes to a discarding stream.
+
+static void BM_RenderFull(BenchState& state) {
+    SimSettings settings = denseCity();
+    GridWorld world(settings.dimX, settings.dimY);
+    world.generateWorld(settings);
+
+    Renderer renderer(settings.dimX, settings.dimY, RENDER_FULL);
+    NullBuffer sink;
+    streambuf* console = cout.rdbuf(&sink);
+
+    while (state.keepRunning()) renderer.showFull(world);
+
+    cout.rdbuf(console);
+    state.counters["cells"] = (double)settings.dimX * settings.dimY;
+}
+
+AVS_BENCHMARK(BM_RenderFull, "Renderer::showFull", 0);
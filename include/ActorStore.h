@@ -0,0 +1,65 @@
+#ifndef ACTOR_STORE_H
+#define ACTOR_STORE_H
+
+#include <vector>
+
+#include "Common.h"
+
+class WorldObjects;
+
+// Kind of actor as seen by the tick kernels
+
+enum ActorKind {ACTOR_STATIC, ACTOR_MOVER, ACTOR_LIGHT};
+
+// Light state used for actors that are not traffic lights (extends LightState)
+
+const unsigned char LIGHT_NONE = 3;
+
+// Structure-of-arrays backing store for the world's actors.
+// Slot i of every array describes objects[i] of the owning GridWorld, so the
+// tick can run as tight loops over contiguous memory. The polymorphic objects
+// stay alive as a read-only view whose accessors read from these arrays.
+
+class ActorStore {
+    public:
+        std::vector<int> x;
+        std::vector<int> y;
+        std::vector<int> speed;
+        std::vector<unsigned char> direction;
+
+        // Per-tick displacement (speed along the direction), precomputed so that
+        // moving is a branch-free add over the whole array.
+
+        std::vector<int> velX;
+        std::vector<int> velY;
+
+        std::vector<char> glyph;
+        std::vector<unsigned char> kind;
+        std::vector<unsigned char> lightState;
+        std::vector<int> lightTimer;
+        std::vector<WorldObjects*> owner;
+
+        // Appends an object and binds it to its slot. Returns the slot.
+
+        int add(WorldObjects* obj);
+
+        // Removes a slot by moving the last actor into it (O(1)). The removed object is
+        // unbound but not deleted.
+
+        void removeAt(size_t slot);
+
+        // Advances the traffic light timers of slots [begin, end) and cycles their state (RED -> GREEN -> YELLOW)
+
+        void stepLights(size_t begin, size_t end);
+
+        // Moves the actors of slots [begin, end) by their velocity.
+        // Ranges are independent, so disjoint ranges may run on different threads.
+
+        void stepMovers(size_t begin, size_t end);
+
+        size_t size() const;
+
+        void clear();
+};
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef BATCH_RUNNER_H
+#define BATCH_RUNNER_H
+
+#include <string>
+#include <vector>
+
+#include "Simulation.h"
+
+// Command line of a batch: the batch flags plus the remaining arguments, which
+// are the base settings of every run
+
+struct BatchOptions {
+    std::string specPath;
+    int jobs;
+    std::string csvPath;
+    std::string jsonPath;
+    std::string logDir;
+    std::vector<std::string> baseArgs;
+};
+
+// One swept setting: a command line flag and the values it takes.
+// A value is the list of tokens that follow the flag (e.g. "10 10 30 30" for gps).
+
+struct SweepAxis {
+    std::string flag;
+    std::vector<std::vector<std::string>> values;
+};
+
+// Outcome of one run, summed over the fleet
+
+struct BatchResult {
+    bool valid;
+    int seed;
+    int ticks;
+    int end;
+    int cars;
+    int arrived;
+    int outOfBounds;
+    int targets;
+    int stops;
+    int nearMisses;
+    long long cells;
+    long long arrivalTicks;
+};
+
+// In-process Monte Carlo runner.
+// The sweep spec is a text file with one setting per line:
+//
+//     # comment
+//     seed = 1..100
+//     minConfidenceThreshold = 0.3..0.6:0.1
+//     numMovingCars = 3, 10, 20
+//     gps = 10 10 30 30
+//
+// The names are the command line flags without '--'. Values are separated by
+// commas; 'a..b' and 'a..b:step' expand to ranges. Every combination of the
+// values (last line varying fastest) is one run. Runs are independent GridWorlds,
+// each with its own log, handed out one at a time to a thread pool, and the
+// outcomes are summed per combination of the non-seed settings.
+
+class BatchRunner {
+    private:
+        BatchOptions options;
+        std::vector<SweepAxis> axes;
+
+        // Per run: the chosen value of every axis, the parsed settings and the outcome
+
+        std::vector<std::vector<size_t>> choices;
+        std::vector<SimSettings> settings;
+        std::vector<BatchResult> results;
+
+        bool loadSpec();
+
+        // Builds the settings of every combination through the normal argument parser
+
+        void expand();
+
+        void runOne(size_t run);
+
+        // Text of a run's value on an axis (tokens joined by spaces)
+
+        std::string valueText(size_t run, size_t axis) const;
+
+        // Key of the run's group: its values on every axis except seed
+
+        std::string groupKey(size_t run) const;
+
+        void printSummary(double seconds) const;
+
+        bool writeCsv() const;
+
+        bool writeJson() const;
+
+    public:
+        explicit BatchRunner(const BatchOptions& batchOptions);
+
+        // Runs the whole sweep; returns the process exit code
+
+        int run();
+};
+
+// Checks if the command line asks for a batch
+
+bool isBatchCommand(int argc, char** argv);
+
+// Splits the command line into batch flags and base run arguments
+
+BatchOptions parseBatchArguments(int argc, char** argv);
+
+#endif
@@ -0,0 +1,139 @@
+#ifndef BYTE_CODEC_H
+#define BYTE_CODEC_H
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "Common.h"
+
+// Byte encoding shared by the snapshot and sensor recording files: LEB128 varints,
+// zigzag for signed numbers, length-prefixed strings and raw bytes for the rest.
+
+// Appends an unsigned LEB128 varint.
+
+inline void putVarint(std::vector<unsigned char>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back((unsigned char)(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back((unsigned char)value);
+}
+
+// Appends a signed number, zigzag encoded so small negative values stay short.
+
+inline void putSigned(std::vector<unsigned char>& out, int64_t value) {
+    putVarint(out, ((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+}
+
+inline void putRaw(std::vector<unsigned char>& out, const void* data, size_t size) {
+    const unsigned char* bytes = (const unsigned char*)data;
+    out.insert(out.end(), bytes, bytes + size);
+}
+
+inline void putString(std::vector<unsigned char>& out, const std::string& text) {
+    putVarint(out, text.size());
+    putRaw(out, text.data(), text.size());
+}
+
+inline void putPosition(std::vector<unsigned char>& out, Position p) {
+    putSigned(out, p.x);
+    putSigned(out, p.y);
+}
+
+// Reads values back from a byte buffer. Reading past the end, or a count larger
+// than the bytes left could hold, marks the reader as failed and yields zeros.
+
+struct ByteReader {
+    const unsigned char* data;
+    size_t size;
+    size_t offset;
+    bool failed;
+
+    uint64_t varint() {
+        uint64_t value = 0;
+
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (offset >= size) break;
+
+            unsigned char byte = data[offset++];
+            value |= (uint64_t)(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0) return value;
+        }
+
+        failed = true;
+        return 0;
+    }
+
+    int64_t signedValue() {
+        uint64_t value = varint();
+        return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+    }
+
+    int integer() {
+        return (int)signedValue();
+    }
+
+    unsigned char byte() {
+        if (offset >= size) {
+            failed = true;
+            return 0;
+        }
+        return data[offset++];
+    }
+
+    void raw(void* out, size_t length) {
+        if (size - offset < length) {
+            failed = true;
+            memset(out, 0, length);
+            return;
+        }
+        memcpy(out, data + offset, length);
+        offset += length;
+    }
+
+    // Element count of a list whose elements take at least 'minBytes' each
+
+    size_t count(size_t minBytes) {
+        uint64_t n = varint();
+
+        if (n > (size - offset) / minBytes) {
+            failed = true;
+            return 0;
+        }
+        return (size_t)n;
+    }
+
+    std::string text() {
+        size_t length = count(1);
+        std::string value((const char*)data + offset, length);
+        offset += length;
+        return value;
+    }
+
+    Position position() {
+        Position p;
+        p.x = integer();
+        p.y = integer();
+        return p;
+    }
+};
+
+// Reads a varint straight from a file (block and frame prefixes).
+
+inline bool readFileVarint(FILE* file, uint64_t& value) {
+    value = 0;
+
+    for (int shift = 0; shift < 64; shift += 7) {
+        int c = fgetc(file);
+        if (c == EOF) return false;
+
+        value |= (uint64_t)(c & 0x7F) << shift;
+        if ((c & 0x80) == 0) return true;
+    }
+    return false;
+}
+
+#endif
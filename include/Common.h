@@ -1,7 +1,7 @@
 #ifndef COMMON_H
 #define COMMON_H
 
-#include <fstream>
+#include "Logger.h"
 
 // Represents a coordinate on the 2D grid
  
@@ -10,8 +10,14 @@ struct Position {
     int y;
 };
 
-// Global log file stream
+// Global simulation log (asynchronous, see Logger.h)
  
-extern std::ofstream simLog;
+extern AsyncLog simLog;
+
+// Log the calling thread writes events to: simLog, unless a LogBinding redirected it
+
+inline AsyncLog& currentLog() {
+    return boundLog != nullptr ? *boundLog : simLog;
+}
 
 #endif
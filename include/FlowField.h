@@ -0,0 +1,118 @@
+#ifndef FLOW_FIELD_H
+#define FLOW_FIELD_H
+
+#include <cstddef>
+#include <vector>
+#include <list>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "Common.h"
+#include "WorldObjects.h"
+
+// BFS distance (in steps) from every cell to one target over the static-obstacle map.
+// -1 marks blocked and unreachable cells.
+
+class DistanceField {
+    private:
+        int width;
+        int height;
+        Position target;
+        std::vector<int> dist;
+
+    public:
+        DistanceField(int dimX, int dimY, Position targetPos);
+
+        // Fills the field with a breadth-first search from the target.
+        // 'queue' is scratch space of at least width * height cells.
+
+        void compute(const std::vector<unsigned char>& blocked, std::vector<int>& queue);
+
+        int distanceAt(int x, int y) const;
+
+        // Picks the neighbour one step closer to the target, keeping 'current' on ties.
+        // Returns false if the cell is unreachable or already the target.
+        // runLength is 2 if the next two steps both go in that direction, otherwise 1.
+
+        bool gradient(Position at, Direction current, Direction& next, int& runLength) const;
+
+        size_t bytes() const;
+};
+
+// Cache of distance fields keyed by target cell, shared by every car of a world.
+// Fields are computed on a background thread: prefetch() queues a target early,
+// acquire() returns the finished field and blocks only if it is still pending, so
+// results never depend on timing. Finished fields are kept within a memory budget
+// and evicted least recently used first; cars keep the field they follow alive
+// through the shared pointer even after eviction.
+
+class FlowFieldCache {
+    private:
+        struct Entry {
+            std::shared_ptr<const DistanceField> field;
+            bool ready;
+            std::list<int>::iterator lru;
+        };
+
+        int width;
+        int height;
+        const std::vector<unsigned char>& blocked;
+        size_t budgetBytes;
+        size_t usedBytes;
+        size_t peakBytes;
+
+        // Finished targets, most recently used at the front
+
+        std::list<int> lru;
+        std::unordered_map<int, Entry> entries;
+        std::deque<int> pending;
+
+        size_t computed;
+        size_t hits;
+        size_t evictions;
+
+        std::mutex lock;
+        std::condition_variable wake;
+        std::condition_variable finished;
+        bool stopping;
+        std::thread worker;
+
+        void workerLoop();
+
+        // Queues a target unless it is cached or pending. Lock must be held.
+
+        void enqueue(int cell);
+
+        // Drops least recently used fields until the budget holds. Lock must be held.
+
+        void evict();
+
+    public:
+        FlowFieldCache(int dimX, int dimY, const std::vector<unsigned char>& staticCells, size_t budget);
+
+        ~FlowFieldCache();
+
+        // Asks for a field without waiting for it
+
+        void prefetch(Position target);
+
+        // Returns the field for a target, computing it first if needed
+
+        std::shared_ptr<const DistanceField> acquire(Position target);
+
+        // Statistics
+
+        size_t getComputed();
+
+        size_t getHits();
+
+        size_t getEvictions();
+
+        size_t getPeakBytes();
+};
+
+#endif
@@ -6,11 +6,68 @@
 
 #include "Common.h"
 #include "WorldObjects.h"
+#include "SpatialIndex.h"
+#include "ActorStore.h"
+#include "ObjectPool.h"
+#include "ThreadPool.h"
+#include "Random.h"
+#include "NoiseEngine.h"
+#include "FlowField.h"
 #include "VehicleSystem.h"
 #include "Simulation.h"
+#include "SensorRecording.h"
  
+// Why a run stops (RUN_ACTIVE while it goes on)
+
+enum RunEnd {RUN_ACTIVE, RUN_FLEET_DONE, RUN_OUT_OF_BOUNDS, RUN_DESTINATION, RUN_CAR_GONE};
+
+// State of one world object in a snapshot. The glyph tells the kind (and a
+// light's color); 'direction' is used by cars and bikes, 'timer' by lights and
+// 'text' by signs.
+
+struct ObjectState {
+    char glyph;
+    std::string id;
+    int handle;
+    Position pos;
+    Direction direction;
+    int timer;
+    std::string text;
+};
+
+// Entry of the change journal kept for incremental snapshots: an object removed
+// from a slot of the object list (swap-and-pop), or one appended to it.
+
+struct WorldChange {
+    int removedSlot;
+    ObjectState added;
+};
+
+// Complete world between two ticks
+
+struct WorldState {
+    int tick;
+    uint64_t rngState;
+    int handleCount;
+    std::vector<int> freeHandles;
+    std::vector<ObjectState> objects;
+    std::vector<CarState> cars;
+};
+
+// Changes since the previous snapshot. 'moving' holds the state of every car,
+// bike and light in object order after the journal is applied; parked cars and
+// signs never change, so they are not repeated.
+
+struct WorldDelta {
+    int tick;
+    uint64_t rngState;
+    std::vector<WorldChange> changes;
+    std::vector<ObjectState> moving;
+    std::vector<CarState> cars;
+};
+
 // Represents the simulation environment (grid).
-// Manages all dynamic and static objects and the self-driving car.
+// Manages all dynamic and static objects and the fleet of self-driving cars.
 
 class GridWorld {
     private:
@@ -18,12 +75,152 @@ class GridWorld {
         int height;
         int currentTick;
         std::vector<WorldObjects*> objects;
+        SpatialIndex spatialIndex;
+
+        // Storage of the objects: one slab pool per kind, sized at generation
+        // (see ObjectPool.h). Objects that leave the grid free their slot for reuse.
+
+        WorldObjectPool objectPool;
+
+        // Handle table: handles[h] is the object with handle h (nullptr when free).
+        // Sensor readings refer to objects by these dense handles.
+
+        std::vector<WorldObjects*> handles;
+        std::vector<int> freeHandles;
+
+        // Self-driving cars. 'car' is the primary one (fleet[0]) that follows --gps.
+
+        std::vector<SelfDrivingCar*> fleet;
+        std::vector<SelfDrivingCar*> activeCars;
         SelfDrivingCar* car;
+
+        // Optional structure-of-arrays state; when enabled, slot i mirrors objects[i]
+
+        ActorStore actors;
+        bool useActorStore;
+
+        // Random stream for world generation, seeded from the settings
+
+        Random rng;
+
+        // Counter-based sensor noise shared by every sensor in the world
+
+        NoiseEngine* noise;
+
+        // Optional worker pool (--threads) and per-slot out-of-bounds flags filled by it
+
+        ThreadPool* pool;
+        std::vector<unsigned char> leaving;
+
+        // Cells holding a static object (1) and the distance fields computed over them.
+        // Only built with --planner field; static objects never move, so fields stay valid.
+
+        std::vector<unsigned char> staticCells;
+        FlowFieldCache* fields;
+
+        // Free-cell list used by PLACEMENT_SHUFFLE during generation.
+        // Cells before freeDrawn have already been handed out.
+
+        std::vector<int> freeCells;
+        size_t freeDrawn;
+        bool drawFromFreeList;
+
+        // Traffic entering at the edges (--spawn-rate, --target-density): expected
+        // arrivals per tick at the north, south, east and west edge, the number of
+        // cars and bikes to keep (0: no target), the seed of the per-tick spawn
+        // streams, and how many entered and left so far
+
+        bool spawning;
+        double spawnRates[4];
+        long long targetMovers;
+        uint64_t spawnSeed;
+        long long spawnedMovers;
+        long long departedMovers;
+
+        // Receives the sensor batches of every tick (--record-sensors), or nullptr
+
+        SensorRecorder* recorder;
+
+        // Change journal for incremental snapshots, only kept while tracking is on
+
+        bool trackingChanges;
+        std::vector<WorldChange> changes;
         
         // Helper to find a free cell
      
         Position getRandomEmptyPosition();
 
+        // Fills freeCells with every cell not occupied by an object or a car
+
+        void buildFreeCellList();
+
+        // True while at least one cell is not occupied
+
+        bool hasFreeCell() const;
+
+        // Takes ownership of a self-driving car; cars are indexed so they can sense each other
+
+        void addCar(SelfDrivingCar* sdc);
+
+        // Random GPS route with the given number of waypoints
+
+        std::vector<Position> randomRoute(int waypoints);
+
+        // Sense/plan for all active cars, then act and check per-car end conditions
+
+        void updateFleet();
+
+        // Act part of the fleet update: moves the active cars in fleet order and retires
+        // those that left the grid or arrived
+
+        void moveFleet();
+
+        // Tick implementations for the object (virtual update) and SoA paths
+
+        void updateObjects();
+
+        void updateActors();
+
+        void sortObjectsByCell();
+
+        // Runs fn over [0, n) on the pool when present, otherwise inline
+
+        void forEachChunk(size_t n, const std::function<void(size_t, size_t)>& fn);
+
+        // Takes ownership of an object and registers it in the spatial index
+
+        void addObject(WorldObjects* obj);
+
+        // Gives an object a handle, reusing released ones first
+
+        void acquireHandle(WorldObjects* obj);
+
+        // Returns an object's handle to the free list
+
+        void releaseHandle(WorldObjects* obj);
+
+        // Static-obstacle map and distance field cache (--planner field)
+
+        void buildFlowFields(const SimSettings& settings);
+
+        // Sets up the actor store and the worker pool for the selected tick mode
+
+        void setupTickMode(const SimSettings& settings);
+
+        // Takes over the spawn settings and reserves pool slots for the target population
+
+        void setupSpawning(const SimSettings& settings);
+
+        // Lets new cars and bikes enter at the edges, heading into the grid
+
+        void spawnTraffic();
+
+        // Snapshot record of an object, and the object rebuilt from one (in the pool)
+
+        static ObjectState describeObject(const WorldObjects* obj);
+
+        WorldObjects* createObject(const ObjectState& state);
+
     public:
         
         // Constructor
@@ -38,14 +235,57 @@ class GridWorld {
          
         void generateWorld(const SimSettings& settings);
 
+        // Rebuilds a world saved with saveState() in place of generateWorld().
+        // The settings must match the ones the world was saved with (see Snapshot.h).
+
+        void restoreState(const WorldState& state, const SimSettings& settings);
+
+        // Copies the complete world state
+
+        void saveState(WorldState& state) const;
+
+        // Starts (with an empty journal) or stops recording the changes for saveChanges()
+
+        void trackChanges(bool enabled);
+
+        // Collects what changed since tracking started or since the last call, and clears the journal
+
+        void saveChanges(WorldDelta& delta);
+
         // Updates state of world and objects
 
         void update();
+
+        // Replays a recorded tick instead of update(): the recorded cars get their
+        // sensor batches from the recording and navigate and move; objects stay where
+        // they are. Returns the number of cars that are not where the recording has them.
+
+        int replayTick(const SensorReplay& replay);
+
+        // Adds an object during the run (the actor-spawn path): it takes a recycled
+        // pool slot and a recycled handle when there is one, joins the actor store in
+        // SoA mode and is journaled for snapshots. Returns nullptr if the cell is
+        // taken or outside the grid, or the glyph is unknown.
+
+        WorldObjects* spawnObject(const ObjectState& state);
+
+        // Sends the sensor batches of every following tick to 'sensorRecorder' (nullptr stops)
+
+        void setRecorder(SensorRecorder* sensorRecorder);
  
         // Checks boundary conditions for car
  
         bool isCarOutOfBounds() const;
 
+        // True once every car of the fleet has arrived or left the grid
+
+        bool isFleetDone() const;
+
+        // End condition after a tick: a fleet runs until every car has arrived or
+        // left the grid, a single car until it leaves the grid or stops at its destination
+
+        RunEnd checkEnd();
+
         // Getters
          
         int getWidth() const;
@@ -56,7 +296,37 @@ class GridWorld {
 
         const std::vector<WorldObjects*>& getObjects() const;
 
+        const SpatialIndex& getSpatialIndex() const;
+
         SelfDrivingCar* getCar();
+
+        const std::vector<SelfDrivingCar*>& getFleet() const;
+
+        ThreadPool* getThreadPool() const;
+
+        const NoiseEngine* getNoiseEngine() const;
+
+        // Distance field cache (nullptr unless --planner field)
+
+        FlowFieldCache* getFlowFields() const;
+
+        // Object behind a handle, or nullptr if the handle is free or out of range
+
+        WorldObjects* objectByHandle(int handle) const;
+
+        // Upper bound (exclusive) of the handles in use
+
+        int getHandleCount() const;
+
+        const WorldObjectPool& getObjectPool() const;
+
+        // Cars and bikes in the world, and how many entered at the edges and left the grid
+
+        long long getMovers() const;
+
+        long long getSpawned() const;
+
+        long long getDeparted() const;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,194 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <cstdio>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_map>
+
+#include "Trace.h"
+
+// Severity of a log line. LOG_OFF disables logging altogether.
+
+enum LogLevel {LOG_DEBUG, LOG_INFO, LOG_WARN, LOG_ERROR, LOG_OFF};
+
+// Compile-time floor: lines below this level compile to nothing.
+// Set with 'make LOG_MIN_LEVEL=n' (0 debug .. 4 off).
+
+#ifndef AVS_LOG_MIN_LEVEL
+#define AVS_LOG_MIN_LEVEL 0
+#endif
+
+// Asynchronous log file.
+// Every thread that logs gets its own single-producer ring buffer, so producing
+// a line is a copy into memory without locks or system calls. A background
+// writer thread drains the rings in batches and writes them with one fwrite.
+// Lines of one thread keep their order; the simulation only logs from the tick
+// thread, which keeps the log reproducible.
+// Opened with openTrace() the same rings carry fixed-size TraceRecords instead of
+// text; the writer packs them (see packEvent) and object IDs are interned once
+// into the trace's string table.
+
+class AsyncLog {
+    private:
+
+        // Lock-free single-producer / single-consumer byte ring.
+        // head and tail only grow; the index is the counter masked by the capacity.
+
+        struct Ring {
+            std::vector<char> data;
+            size_t mask;
+            std::atomic<size_t> head;
+            std::atomic<size_t> tail;
+            std::thread::id owner;
+
+            explicit Ring(size_t capacity);
+        };
+
+        FILE* file;
+        std::atomic<int> level;
+        unsigned long long instance;
+        bool tracing;
+        int tick;
+        unsigned long long bytesWritten;
+
+        // Writer-side state of a trace: last packed tick, records so far, pack buffer
+
+        int packedTick;
+        unsigned long long recordCount;
+        std::vector<unsigned char> packed;
+
+        std::vector<Ring*> rings;
+        std::mutex lock;
+        std::condition_variable wake;
+        bool stopping;
+        std::thread writer;
+
+        std::mutex namesLock;
+        std::unordered_map<std::string, int> nameIndex;
+        std::vector<std::string> names;
+
+        // Index of an ID in the string table, adding it on first use
+
+        int intern(const std::string& name);
+
+        // Appends the string table and fills in the header (trace mode)
+
+        void finishTrace();
+
+        // Finds (or creates) the calling thread's ring
+
+        Ring* ringForThread();
+
+        // Copies everything published in the rings to the file
+
+        void drain(std::vector<char>& batch);
+
+        void writerLoop();
+
+    public:
+        AsyncLog();
+
+        ~AsyncLog();
+
+        // Opens (truncates) the log file and starts the writer thread
+
+        bool open(const std::string& path);
+
+        // Opens (truncates) a binary trace file instead of a text log
+
+        bool openTrace(const std::string& path);
+
+        bool is_open() const;
+
+        // Writes all pending lines, stops the writer and closes the file
+
+        void close();
+
+        // Runtime level; lines below it are skipped before any formatting happens
+
+        void setLevel(LogLevel minimum);
+
+        bool enabled(LogLevel lineLevel) const {
+            return file != nullptr && (int)lineLevel >= level.load(std::memory_order_relaxed);
+        }
+
+        // Appends raw text (one or more complete lines) from the calling thread
+
+        void write(const char* text, size_t length);
+
+        // Tick stamped on the events that follow (set by the world every tick)
+
+        void setTick(int currentTick) {
+            tick = currentTick;
+        }
+
+        int getTick() const {
+            return tick;
+        }
+
+        // Writes one event: its text line in a text log, the raw record in a trace.
+        // 'name' is the object ID the event refers to (may be empty).
+
+        void event(const TraceRecord& record, const std::string& name);
+};
+
+// Log bound to the calling thread by a LogBinding (nullptr: the global simLog)
+
+extern thread_local AsyncLog* boundLog;
+
+// Sends the events of the calling thread to another log while it exists, so
+// simulations running side by side (batch runs) never share a log.
+
+class LogBinding {
+    private:
+        AsyncLog* previous;
+
+    public:
+        explicit LogBinding(AsyncLog& log);
+
+        ~LogBinding();
+};
+
+// One event under construction. Fields are filled in with the chained setters
+// and the event is handed to the log when the statement ends.
+
+class LogEvent {
+    private:
+        AsyncLog& log;
+        TraceRecord record;
+        std::string& nameText;
+
+    public:
+        LogEvent(AsyncLog& target, EventKind kind);
+
+        ~LogEvent();
+
+        LogEvent& name(const std::string& id);
+        LogEvent& arg(int value);
+        LogEvent& at(int x, int y);
+        LogEvent& values(int a, int b = 0, int c = 0);
+};
+
+// Lets SIM_EVENT be a single expression (safe inside an unbraced if/else)
+
+struct LogVoidify {
+    void operator&(const LogEvent&) {}
+};
+
+// Usage: SIM_EVENT(EV_CAR_MOVED).name(id).at(x, y);
+// Events go to the calling thread's log (see currentLog in Common.h).
+// The level of each kind comes from EVENT_LEVELS. Below AVS_LOG_MIN_LEVEL the
+// whole statement, arguments included, is removed at compile time; below the
+// runtime level the arguments are not evaluated.
+
+#define SIM_EVENT_ENABLED(kind) (EVENT_LEVELS[kind] >= AVS_LOG_MIN_LEVEL && currentLog().enabled((LogLevel)EVENT_LEVELS[kind]))
+
+#define SIM_EVENT(kind) !SIM_EVENT_ENABLED(kind) ? (void)0 : LogVoidify() & LogEvent(currentLog(), kind)
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef NOISE_ENGINE_H
+#define NOISE_ENGINE_H
+
+#include <cstdint>
+#include <cstddef>
+
+#include "Simulation.h"
+
+// Counter-based source of sensor noise.
+// A noise value is a pure function of (seed, tick, sensor, object), so a batch of
+// readings can be noised in any order, on any thread, with the same result.
+
+class NoiseEngine {
+    protected:
+        uint64_t seed;
+
+    public:
+        explicit NoiseEngine(uint64_t seedValue);
+
+        virtual ~NoiseEngine();
+
+        // Writes one raw 64-bit sample per object key into out[0 .. count - 1]
+
+        virtual void generate(uint64_t tick, uint64_t sensorKey, const uint64_t* objectKeys, size_t count, uint64_t* out) const = 0;
+
+        // Converts raw samples to confidence offsets in [-0.05, 0.049] (steps of 0.001)
+
+        static void toConfidenceNoise(const uint64_t* samples, size_t count, double* out);
+};
+
+// SplitMix-style hash of the full counter. Cheapest option, the default.
+
+class HashNoise : public NoiseEngine {
+    public:
+        explicit HashNoise(uint64_t seedValue);
+
+        virtual void generate(uint64_t tick, uint64_t sensorKey, const uint64_t* objectKeys, size_t count, uint64_t* out) const override;
+};
+
+// Philox4x32-10 block cipher keyed by (seed, sensor) over the counter (object, tick).
+
+class PhiloxNoise : public NoiseEngine {
+    public:
+        explicit PhiloxNoise(uint64_t seedValue);
+
+        virtual void generate(uint64_t tick, uint64_t sensorKey, const uint64_t* objectKeys, size_t count, uint64_t* out) const override;
+};
+
+// Creates the engine selected in the settings
+
+NoiseEngine* createNoiseEngine(NoiseModel model, uint64_t seedValue);
+
+#endif
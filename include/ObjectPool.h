@@ -0,0 +1,126 @@
+#ifndef OBJECT_POOL_H
+#define OBJECT_POOL_H
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include "WorldObjects.h"
+
+// Slab storage for objects of one type.
+// Objects are constructed in place in large chunks, so objects of a type sit next
+// to each other in memory and creating one does not allocate while a chunk or the
+// free list has room. destroy() runs the destructor and puts the slot on the free
+// list, where the next create() picks it up again. The chunks are released when
+// the pool goes away; every object must have been destroyed by then.
+
+template <typename T>
+class TypedPool {
+    private:
+
+        // Smallest chunk allocated when the pool grows without a reservation
+
+        static const size_t MIN_CHUNK = 256;
+
+        std::vector<T*> chunks;
+        size_t chunkCapacity;
+        size_t chunkUsed;
+        size_t capacity;
+        size_t live;
+        std::vector<T*> freeSlots;
+
+        // Starts a new chunk; the unused tail of the previous one goes to the free list
+
+        void addChunk(size_t slots) {
+            if (!chunks.empty())
+                for (size_t i = chunkCapacity; i-- > chunkUsed;) freeSlots.push_back(chunks.back() + i);
+
+            chunks.push_back(static_cast<T*>(::operator new(slots * sizeof(T))));
+            chunkCapacity = slots;
+            chunkUsed = 0;
+            capacity += slots;
+        }
+
+        T* takeSlot() {
+            if (!freeSlots.empty()) {
+                T* slot = freeSlots.back();
+                freeSlots.pop_back();
+                return slot;
+            }
+
+            if (chunks.empty() || chunkUsed == chunkCapacity) addChunk(capacity > MIN_CHUNK ? capacity : MIN_CHUNK);
+            return chunks.back() + chunkUsed++;
+        }
+
+    public:
+        TypedPool() : chunkCapacity(0), chunkUsed(0), capacity(0), live(0) {}
+
+        ~TypedPool() {
+            for (size_t i = 0; i < chunks.size(); ++i) ::operator delete(chunks[i]);
+        }
+
+        TypedPool(const TypedPool&) = delete;
+
+        TypedPool& operator=(const TypedPool&) = delete;
+
+        // Makes room for 'count' more objects in one chunk (one allocation for a whole world)
+
+        void reserve(size_t count) {
+            size_t spare = freeSlots.size() + (chunkCapacity - chunkUsed);
+            if (spare < count) addChunk(count);
+        }
+
+        template <typename... Args>
+        T* create(Args&&... args) {
+            T* slot = takeSlot();
+            T* obj = new (slot) T(std::forward<Args>(args)...);
+            live++;
+            return obj;
+        }
+
+        void destroy(T* obj) {
+            obj->~T();
+            freeSlots.push_back(obj);
+            live--;
+        }
+
+        size_t getLive() const {
+            return live;
+        }
+
+        size_t getCapacity() const {
+            return capacity;
+        }
+
+        size_t getChunks() const {
+            return chunks.size();
+        }
+};
+
+// Pools for every kind of world object a GridWorld owns (the self-driving cars
+// are not pooled). Objects are destroyed through the pool of their kind, which is
+// found from the glyph like everywhere else.
+
+class WorldObjectPool {
+    public:
+        TypedPool<TrafficLight> lights;
+        TypedPool<TrafficSign> signs;
+        TypedPool<StationaryVehicles> parked;
+        TypedPool<Car> cars;
+        TypedPool<Bike> bikes;
+
+        // Destroys an object created by one of the pools
+
+        void destroy(WorldObjects* obj);
+
+        size_t getLive() const;
+
+        // Object slots allocated over all pools, and the number of chunks holding them
+
+        size_t getCapacity() const;
+
+        size_t getChunks() const;
+};
+
+#endif
@@ -0,0 +1,211 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <cstdint>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <mutex>
+
+// Compile-time switch: with 'make PROFILING=0' the PROFILE_* macros compile to nothing.
+
+#ifndef AVS_PROFILING
+#define AVS_PROFILING 1
+#endif
+
+// Timed phases of a tick. TICK is the whole GridWorld::update(); WORLD, the sensors,
+// FUSE, PLAN and MOVE run inside it. SENSORS is a single-pass scan of all three
+// sensors; LIDAR, RADAR and CAMERA time them when they are scanned separately. RENDER is the map output after the tick.
+
+enum ProfilePhase {
+    PHASE_TICK,
+    PHASE_WORLD,
+    PHASE_LIDAR,
+    PHASE_RADAR,
+    PHASE_CAMERA,
+    PHASE_SENSORS,
+    PHASE_FUSE,
+    PHASE_PLAN,
+    PHASE_MOVE,
+    PHASE_RENDER,
+    PHASE_COUNT
+};
+
+// Counted quantities. OBJECTS_SCANNED are the spatial index candidates the sensors
+// looked at, READINGS_FUSED the readings that went into fusion. ALLOCATIONS are
+// the heap allocations of the whole process during the tick.
+
+enum ProfileCounter {
+    COUNTER_OBJECTS_SCANNED,
+    COUNTER_READINGS_PRODUCED,
+    COUNTER_READINGS_FUSED,
+    COUNTER_ALLOCATIONS,
+    COUNTER_COUNT
+};
+
+const char* profilePhaseName(ProfilePhase phase);
+
+const char* profileCounterName(ProfileCounter counter);
+
+// Heap allocations made by the process so far (counted by the replaced operator new)
+
+uint64_t allocationCount();
+
+// Per-phase tick profiler (--profile).
+// Every thread that times a phase gets its own buffer, so a timer costs two clock
+// reads and a few adds without locks. endTick() runs on the tick thread between
+// ticks, while the worker pool is idle, and folds the buffers into the tick's row.
+// Times of phases that run on several threads at once (sensors, fleet cars) are
+// summed over the threads, so they can add up to more than the tick's wall time.
+// While disabled a timer or counter is one check of a flag.
+
+class Profiler {
+    public:
+
+        // Number of log2 buckets of the duration histograms (1 ns .. ~1 s and above)
+
+        static const int BUCKETS = 32;
+
+    private:
+
+        // One timed call, kept for the Chrome trace
+
+        struct Span {
+            int phase;
+            int thread;
+            int tick;
+            int64_t start;
+            int64_t duration;
+        };
+
+        // Phase times, counters and spans of one thread since the last endTick()
+
+        struct ThreadBuffer {
+            int thread;
+            int64_t phaseNanos[PHASE_COUNT];
+            uint64_t phaseCalls[PHASE_COUNT];
+            int64_t maxNanos[PHASE_COUNT];
+            uint64_t histogram[PHASE_COUNT][BUCKETS];
+            uint64_t counters[COUNTER_COUNT];
+            std::vector<Span> spans;
+
+            explicit ThreadBuffer(int index);
+
+            void reset();
+        };
+
+        // Totals of one tick (one CSV row)
+
+        struct TickRow {
+            int tick;
+            int64_t phaseNanos[PHASE_COUNT];
+            uint64_t counters[COUNTER_COUNT];
+        };
+
+        bool enabled;
+        bool keepRows;
+        bool keepSpans;
+        std::chrono::steady_clock::time_point origin;
+        uint64_t allocationsAtTick;
+
+        std::mutex lock;
+        std::vector<ThreadBuffer*> buffers;
+
+        // Whole-run totals and per-call duration histograms
+
+        int ticks;
+        int64_t totalNanos[PHASE_COUNT];
+        uint64_t totalCalls[PHASE_COUNT];
+        int64_t maxNanos[PHASE_COUNT];
+        uint64_t histogram[PHASE_COUNT][BUCKETS];
+        uint64_t totalCounters[COUNTER_COUNT];
+
+        std::vector<TickRow> rows;
+        std::vector<Span> spans;
+
+        // Finds (or creates) the calling thread's buffer
+
+        ThreadBuffer* bufferForThread();
+
+    public:
+        Profiler();
+
+        ~Profiler();
+
+        // Starts profiling. With 'rows' every tick's totals are kept for writeCsv(),
+        // with 'spans' every timed call is kept for writeChromeTrace().
+
+        void enable(bool rows, bool spans);
+
+        bool isEnabled() const {
+            return enabled;
+        }
+
+        // Nanoseconds since enable()
+
+        int64_t now() const {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - origin).count();
+        }
+
+        // Adds a finished call of a phase (used by ProfileScope)
+
+        void record(ProfilePhase phase, int64_t start, int64_t duration);
+
+        void count(ProfileCounter counter, uint64_t amount);
+
+        // Closes the given tick: folds the thread buffers into its row and the totals
+
+        void endTick(int tick);
+
+        int getTicks() const;
+
+        // Prints the per-phase table, the counters and the tick time histogram
+
+        void printReport() const;
+
+        // One row per tick: phase times in microseconds, then the counters
+
+        bool writeCsv(const std::string& path) const;
+
+        // Every timed call as a complete event ("ph":"X") and the counters of each
+        // tick as counter events, in the Trace Event format (chrome://tracing, Perfetto)
+
+        bool writeChromeTrace(const std::string& path) const;
+};
+
+// Global profiler, enabled by --profile
+
+extern Profiler simProfiler;
+
+// Times the enclosing scope as one call of a phase
+
+class ProfileScope {
+    private:
+        ProfilePhase phase;
+        int64_t start;
+
+    public:
+        explicit ProfileScope(ProfilePhase timedPhase) : phase(timedPhase), start(-1) {
+            if (simProfiler.isEnabled()) start = simProfiler.now();
+        }
+
+        ~ProfileScope() {
+            if (start >= 0) simProfiler.record(phase, start, simProfiler.now() - start);
+        }
+};
+
+// Usage: PROFILE_SCOPE(PHASE_FUSE); times the rest of the block.
+//        PROFILE_COUNT(COUNTER_READINGS_FUSED, n); adds n to a counter.
+
+#define PROFILE_JOIN2(a, b) a##b
+#define PROFILE_JOIN(a, b) PROFILE_JOIN2(a, b)
+
+#if AVS_PROFILING
+#define PROFILE_SCOPE(phase) ProfileScope PROFILE_JOIN(profileScope, __LINE__)(phase)
+#define PROFILE_COUNT(counter, amount) (!simProfiler.isEnabled() ? (void)0 : simProfiler.count(counter, (uint64_t)(amount)))
+#else
+#define PROFILE_SCOPE(phase) ((void)0)
+#define PROFILE_COUNT(counter, amount) ((void)0)
+#endif
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include <cstdint>
+#include <string>
+
+// SplitMix64 finalizer: maps any 64-bit value to a well-mixed 64-bit value
+
+inline uint64_t mix64(uint64_t z) {
+    z += 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// FNV-1a hash, used to derive stable stream keys from object and sensor IDs
+
+inline uint64_t hashString(const std::string& text) {
+    uint64_t h = 0xCBF29CE484222325ULL;
+    for (size_t i = 0; i < text.size(); ++i) {
+        h ^= (unsigned char)text[i];
+        h *= 0x100000001B3ULL;
+    }
+    return h;
+}
+
+// Small, self-contained random stream (SplitMix64).
+// Every consumer owns its own stream, so results do not depend on the
+// order in which other parts of the simulation draw numbers.
+
+class Random {
+    private:
+        uint64_t state;
+
+    public:
+        explicit Random(uint64_t seedValue = 0) : state(seedValue) {}
+
+        void seed(uint64_t seedValue) {
+            state = seedValue;
+        }
+
+        uint64_t getState() const {
+            return state;
+        }
+
+        uint64_t next() {
+            uint64_t z = state;
+            state += 0x9E3779B97F4A7C15ULL;
+            return mix64(z);
+        }
+
+        // Uniform integer in [0, n)
+
+        uint64_t below(uint64_t n) {
+            return n == 0 ? 0 : next() % n;
+        }
+
+        // Uniform double in [0, 1)
+
+        double uniform() {
+            return (double)(next() >> 11) * (1.0 / 9007199254740992.0);
+        }
+};
+
+#endif
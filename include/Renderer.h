@@ -0,0 +1,89 @@
+#ifndef RENDERER_H
+#define RENDERER_H
+
+#include <string>
+#include <vector>
+
+#include "Common.h"
+#include "Simulation.h"
+
+class GridWorld;
+
+// Console renderer for the grid.
+// Objects are rasterized into a char framebuffer in one pass over the objects;
+// when several share a cell the glyph with the highest priority wins
+// (car @ > R > Y > S > B > C > G > P). Each frame is assembled in a string
+// and written with a single call. The POV view is a crop of the same buffer.
+// In ANSI mode the renderer remembers what the terminal shows and only moves
+// the cursor to the cells that changed.
+
+class Renderer {
+    private:
+        RenderMode mode;
+        int every;
+        int width;
+        int height;
+
+        // Glyph of every cell, row-major with y = 0 first; '.' when empty
+
+        std::vector<char> cells;
+
+        // Cells painted by the last rasterization, so the next one only clears those
+
+        std::vector<int> painted;
+
+        // ANSI mode: glyphs currently on the terminal, and the cells painted in the frame before
+
+        std::vector<char> shown;
+        std::vector<int> previous;
+        bool screenDrawn;
+
+        // Output buffer, reused between frames
+
+        std::string frame;
+
+        // Rank of every glyph (0 for empty and unknown glyphs)
+
+        unsigned char priority[256];
+
+        void paint(int x, int y, char glyph);
+
+        // Redraws the framebuffer from the world's objects and cars
+
+        void rasterize(GridWorld& world);
+
+        void appendRow(int y, int fromX, int toX);
+
+        void appendFullMap(int tick);
+
+        void flush();
+
+        // ANSI mode: clears the screen and draws the whole map, later only the changed cells
+
+        void showAnsi(GridWorld& world);
+
+    public:
+
+        // Constructor for a world of the given size. RENDER_NONE allocates no framebuffer.
+
+        Renderer(int dimX, int dimY, RenderMode renderMode = RENDER_POV, int renderEvery = 1);
+
+        // Prints the whole map
+
+        void showFull(GridWorld& world);
+
+        // Prints the cells within 'radius' of the (first) self-driving car; X marks cells outside the grid
+
+        void showPov(GridWorld& world, int radius);
+
+        // Output of the selected mode before the first tick, after every tick
+        // (only every n-th tick is drawn) and after the last tick
+
+        void showStart(GridWorld& world);
+
+        void showTick(GridWorld& world);
+
+        void showEnd(GridWorld& world);
+};
+
+#endif
@@ -0,0 +1,142 @@
+#ifndef ROUTE_PLANNER_H
+#define ROUTE_PLANNER_H
+
+#include <cstdint>
+#include <vector>
+
+#include "Common.h"
+#include "WorldObjects.h"
+
+// Grid route planner owned by one self-driving car.
+// Plans with A* over the static blockers the car has sensed so far (parked cars,
+// signs, lights) and caches the path to the current target. When a new blocker
+// lands on the cached path only the blocked stretch is searched again and spliced
+// back in; a full search is the fallback.
+
+class RoutePlanner {
+    private:
+
+        // A* state = (cell, heading on arrival), so turns can carry a small cost
+        // and paths prefer long straight runs the car can drive at full speed
+
+        struct Node {
+            int g;
+            long long parent;
+        };
+
+        // Slot of the node table: open addressing with linear probing. A slot holds
+        // a node of the current search only if its generation matches, so starting
+        // a search is one increment instead of clearing the table.
+
+        struct NodeSlot {
+            long long state;
+            uint32_t generation;
+            Node node;
+        };
+
+        struct OpenEntry {
+            int f;
+            int g;
+            long long state;
+        };
+
+        // Node table and open list of a search. They are only used while a search
+        // runs, so all planners on a thread share one (see threadScratch()). It is
+        // sized for the largest search of the grid on first use and only grows
+        // (doubling when half full) past that, so planning does not allocate.
+
+        struct SearchScratch {
+            std::vector<NodeSlot> nodes;
+            size_t nodeCount;
+            uint32_t generation;
+            std::vector<OpenEntry> open;
+        };
+
+        int width;
+        int height;
+
+        // Cells known to hold a static object, one bit per cell (y * width + x)
+
+        std::vector<uint64_t> blocked;
+
+        // Cached path; path[0] is where planning started, cursor is the car's place on it
+
+        std::vector<Position> path;
+        size_t cursor;
+
+        // Scratch of the running search (the calling thread's), and the detour and
+        // splice buffers of repairs, which keep their capacity between repairs
+
+        SearchScratch* scratch;
+        std::vector<Position> detour;
+        std::vector<Position> spliced;
+
+        bool inBounds(int x, int y) const;
+
+        // Node of a state in the current search, or nullptr
+
+        Node* findNode(long long state);
+
+        // Node of a state in the current search, added (with g unset) if missing
+
+        Node& insertNode(long long state);
+
+        // Starts a new search on the calling thread's scratch: forgets all nodes
+
+        void resetNodes();
+
+        // Search scratch of the calling thread, shared by all its planners
+
+        static SearchScratch& threadScratch();
+
+        // Most nodes any search on this grid can reach (its expansion budget and
+        // the number of states bound it)
+
+        size_t maxSearchNodes() const;
+
+        static bool worseEntry(const OpenEntry& a, const OpenEntry& b);
+
+        // A* from 'from' (facing 'heading') to 'to', giving up after 'budget' expansions
+
+        bool search(Position from, Direction heading, Position to, int budget, std::vector<Position>& out);
+
+    public:
+        RoutePlanner(int dimX, int dimY);
+
+        // Records a static blocker; returns true if it was not known before
+
+        bool addBlocker(Position p);
+
+        bool isBlocked(int x, int y) const;
+
+        // Full plan from the car's position to a target. Replaces the cached path.
+
+        bool plan(Position from, Direction heading, Position to);
+
+        // True if a known blocker lies on the part of the path still ahead
+
+        bool isPathBlocked() const;
+
+        // Re-plans around every blocked stretch ahead of the car
+
+        bool repair(Position from, Direction heading);
+
+        // Locates the car on the path and returns the next heading and how many
+        // cells (1 or 2) the car can drive straight before it has to turn
+
+        bool follow(Position at, Direction& dir, int& runLength);
+
+        // Number of steps of the cached path (-1 without a path)
+
+        int getPathLength() const;
+
+        void clearPath();
+
+        // Snapshot support: the known blockers (sorted), the cached path and the cursor
+
+        void saveState(std::vector<int>& blockedCells, std::vector<Position>& pathCells, int& pathCursor) const;
+
+        void restoreState(const std::vector<int>& blockedCells, const std::vector<Position>& pathCells, int pathCursor);
+};
+
+#endif
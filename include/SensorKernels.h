@@ -0,0 +1,108 @@
+#ifndef SENSOR_KERNELS_H
+#define SENSOR_KERNELS_H
+
+#include <cstddef>
+#include <vector>
+
+#include "Common.h"
+#include "WorldObjects.h"
+#include "Simulation.h"
+
+// Area a sensor covers, in the car's frame: 'ahead' is the offset along the
+// car's heading, 'side' the offset across it (positive to the car's right).
+// Readings lose confidence linearly with the Manhattan distance and reach
+// zero at 'falloff'.
+
+struct SensorFootprint {
+    int minAhead;
+    int maxAhead;
+    int minSide;
+    int maxSide;
+
+    // Skip the car's own cell, and objects that are not movers
+
+    bool skipOrigin;
+    bool moversOnly;
+
+    double accuracy;
+    double falloff;
+
+    // Kernel specialization for this footprint (FOOTPRINT_*), set by footprintShape()
+
+    int shape = 0;
+};
+
+// Footprints the kernels are compiled for with constant bounds: the default
+// Lidar, Radar and Camera. Any other footprint uses the GENERIC kernels, which
+// read the bounds from the footprint.
+
+enum FootprintShape {FOOTPRINT_GENERIC, FOOTPRINT_LIDAR, FOOTPRINT_RADAR, FOOTPRINT_CAMERA, FOOTPRINT_SHAPES};
+
+// Specialized shape matching the footprint exactly, or FOOTPRINT_GENERIC
+
+int footprintShape(const SensorFootprint& footprint);
+
+// World-space bounding box of a footprint seen from a car at 'origin' heading 'dir'
+
+void footprintBox(const SensorFootprint& footprint, Position origin, Direction dir, int& minX, int& minY, int& maxX, int& maxY);
+
+// Hits of one footprint test: index into the tested arrays, Manhattan distance
+// and confidence before noise, in the order of the tested objects.
+// The arrays are sized with some slack past 'count', which the vector kernels
+// use to store whole registers.
+
+struct SensorHits {
+    size_t count;
+    std::vector<int> index;
+    std::vector<int> distance;
+    std::vector<double> confidence;
+
+    // Makes room for up to 'objects' hits
+
+    void reserve(size_t objects);
+};
+
+// Range-test kernel: tests objects [0, count) at (x[i], y[i]), mover[i] != 0 for
+// movers, against a footprint seen from 'origin' heading 'dir', and writes the
+// compacted hits with their distances and confidences to 'hits'.
+// All kernels give the same hits, distances and (bit-identical) confidences.
+
+typedef void (*RangeTestKernel)(const SensorFootprint& footprint, Position origin, Direction dir,
+    const int* x, const int* y, const unsigned char* mover, size_t count, SensorHits& hits);
+
+// Portable kernel, one object at a time without branches
+
+void rangeTestScalar(const SensorFootprint& footprint, Position origin, Direction dir,
+    const int* x, const int* y, const unsigned char* mover, size_t count, SensorHits& hits);
+
+// SSE4.1 (4 objects per instruction) and AVX2 (8 objects per instruction) kernels.
+// Only call them when sensorKernelSupported() says the CPU has the instructions.
+
+void rangeTestSse4(const SensorFootprint& footprint, Position origin, Direction dir,
+    const int* x, const int* y, const unsigned char* mover, size_t count, SensorHits& hits);
+
+void rangeTestAvx2(const SensorFootprint& footprint, Position origin, Direction dir,
+    const int* x, const int* y, const unsigned char* mover, size_t count, SensorHits& hits);
+
+// True if the CPU can run the given kernel (AUTO and SCALAR always can)
+
+bool sensorKernelSupported(SensorKernelMode mode);
+
+// Selects the kernel used by the sensors. AUTO picks the widest one the CPU
+// supports; a kernel the CPU lacks falls back the same way. Returns the kernel in use.
+// Called once at startup before any scan; until then AUTO is in effect.
+
+SensorKernelMode selectSensorKernel(SensorKernelMode mode);
+
+// Kernel in use, and its name as accepted by --sensor-kernel
+
+SensorKernelMode activeSensorKernel();
+
+const char* sensorKernelName(SensorKernelMode mode);
+
+// Runs the selected kernel, specialized for the footprint's shape
+
+void rangeTest(const SensorFootprint& footprint, Position origin, Direction dir,
+    const int* x, const int* y, const unsigned char* mover, size_t count, SensorHits& hits);
+
+#endif
@@ -0,0 +1,123 @@
+#ifndef SENSOR_RECORDING_H
+#define SENSOR_RECORDING_H
+
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Sensors.h"
+#include "Simulation.h"
+
+class SelfDrivingCar;
+
+// Sensor recordings (--record-sensors and --replay).
+// A recording holds the Lidar, Radar and Camera batches of every active car for
+// every tick, so fusion and navigation can be run again on exactly the same inputs
+// without simulating the world. The file starts with the settings the world was
+// generated from, followed by one block per tick. Blocks are columnar: first the
+// per-car columns, then each reading field as one column over all readings of
+// the tick (Lidar, Radar, Camera of the first car, then the next car, ...).
+//
+//     header    "AVSSENS1", uint32 version, uint32 reserved
+//     settings  varint size, then the generation settings and GPS targets
+//     block     varint size, then:
+//               tick, car count
+//               fleet index[], x[], y[], lidar count[], radar count[], camera count[]
+//               handle[], type[], x[], y[], speed[], direction[], sign[], light[]
+//               distance[], confidence[]          (raw doubles)
+//
+// Numbers are varints (signed ones zigzag encoded). Blocks are written as the run
+// goes, so a recording can be read while it is still growing.
+
+const uint32_t SENSOR_RECORDING_VERSION = 1;
+
+// Appends the sensor batches of a run to a recording
+
+class SensorRecorder {
+    private:
+        FILE* file;
+        int ticks;
+        uint64_t readings;
+        uint64_t bytes;
+
+        // Fleet indices of the active cars and the column buffers of the current block,
+        // reused between ticks
+
+        std::vector<int> active;
+        std::vector<const std::vector<SensorReading>*> batches;
+        std::vector<unsigned char> block;
+
+    public:
+        SensorRecorder();
+
+        ~SensorRecorder();
+
+        // Creates the file with the header and the settings
+
+        bool open(const std::string& path, const SimSettings& settings);
+
+        // Writes the sensor buffers of every active car after they sensed at 'tick'
+
+        bool recordTick(int tick, const std::vector<SelfDrivingCar*>& fleet);
+
+        void close();
+
+        int getTicks() const;
+
+        uint64_t getReadings() const;
+
+        uint64_t getBytes() const;
+};
+
+// Reads a recording one tick at a time
+
+class SensorReplay {
+    private:
+        FILE* file;
+        std::vector<unsigned char> block;
+
+        // The current tick: cars in recording order, their positions when they sensed,
+        // and for each car the offset of its first reading of each sensor
+
+        int tick;
+        std::vector<int> cars;
+        std::vector<Position> positions;
+        std::vector<size_t> offsets;
+        std::vector<SensorReading> readings;
+
+    public:
+        SensorReplay();
+
+        ~SensorReplay();
+
+        // Opens a recording; the saved settings replace those in 'settings'.
+        // Returns false with a message in 'error' if the file cannot be used.
+
+        bool open(const std::string& path, SimSettings& settings, std::string& error);
+
+        // Decodes the next tick. Returns false at the end of the recording, and sets
+        // 'damaged' if the file ends inside a block or a block does not decode.
+
+        bool nextTick(bool& damaged);
+
+        int getTick() const;
+
+        // Number of cars in the current tick, the fleet index and position of the i-th one
+
+        size_t getCarCount() const;
+
+        int getCar(size_t i) const;
+
+        Position getPosition(size_t i) const;
+
+        // Copies the i-th car's readings of one sensor (0 = Lidar, 1 = Radar, 2 = Camera) into 'out'
+
+        void copyReadings(size_t i, int sensor, std::vector<SensorReading>& out) const;
+
+        size_t getReadingCount() const;
+
+        void close();
+};
+
+#endif
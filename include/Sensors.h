@@ -6,18 +6,33 @@
 
 #include "Common.h"
 #include "WorldObjects.h"
+#include "SpatialIndex.h"
+#include "NoiseEngine.h"
+#include "SensorKernels.h"
+#include "Simulation.h"
+#include "Profiler.h"
  
-// Structure containing data returned by a sensor for a specific object
+// Enum for the kind of object a sensor recognized
+
+enum ObjectType {TYPE_UNKNOWN, TYPE_CAR, TYPE_BIKE, TYPE_TRAFFIC_SIGN, TYPE_PARKED_CAR, TYPE_TRAFFIC_LIGHT};
+
+// Returns the log name of an object type (e.g. "PARKED_CAR")
+
+const char* objectTypeName(ObjectType type);
+ 
+// Structure containing data returned by a sensor for a specific object.
+// Holds no strings, so readings can be copied and buffered without allocating.
+// The object is identified by its world handle.
 
 struct SensorReading{
-    std::string objectID;
-    std:: string type;
+    int objectHandle;
+    ObjectType type;
     Position pos;
     double distance;
     double confidence;
     int speed;
     Direction direction;
-    std::string signText;
+    SignType sign;
     LightState lightState;
 };
  
@@ -25,58 +40,184 @@ struct SensorReading{
  
 SensorReading createEmptyReading();
 
-// Abstract base class for all sensors
- 
+// Objects around a car in structure-of-arrays form for the range-test kernels.
+// Gathered from the spatial index in its query order; each object is classified
+// once (reading type, detail kind) from its glyph.
+
+class SensorCandidates {
+    public:
+        std::vector<WorldObjects*> objects;
+        std::vector<int> x;
+        std::vector<int> y;
+        std::vector<unsigned char> mover;
+        std::vector<unsigned char> type;
+        std::vector<unsigned char> kind;
+
+        // Replaces the contents with the objects inside the inclusive box
+
+        void gather(const SpatialIndex& index, int minX, int minY, int maxX, int maxY);
+
+        size_t size() const;
+};
+
+// Which details a sensor reports besides type, position and distance
+
+enum SensorDetail {DETAIL_NONE, DETAIL_MOTION, DETAIL_ALL};
+
+// Base class for all sensors.
+// A sensor is its kind, its footprint (range and falloff, see SensorKernels.h) and
+// the details it reports. A scan gathers the objects in the footprint's bounding box,
+// runs the selected range-test kernel over them and builds a reading per hit.
+// The footprint's kernel specialization is picked once, at construction.
+
 class Sensor {
     protected:
         std::string id;
+        SensorKind kind;
+
+        SensorFootprint footprint;
+        SensorDetail detail;
+
+        // Scratch buffers reused between scans: the objects gathered from the
+        // spatial index and the kernel's hits among them
+
+        SensorCandidates candidates;
+        SensorHits hits;
+
+        // Counter-based noise: the sample for a reading depends only on
+        // (seed, tick, noiseKey, object key), never on scan order or threads.
+
+        const NoiseEngine* noise;
+        uint64_t noiseKey;
 
-        double baseAccuracy;
+        // The car carrying the sensor; it is in the spatial index too, but never a reading
 
-        double calculateDistance(Position pos1, Position pos2) const;
+        const WorldObjects* owner;
 
-        double applyNoise(double conf) const;
+        // Object keys of the readings of the current scan, and the noise batch buffers
+
+        std::vector<uint64_t> noiseObjects;
+        std::vector<uint64_t> noiseSamples;
+        std::vector<double> noiseValues;
+
+        // Adds noise to the confidence of the readings of the scan (from 'first' on)
+        // in one batch and keeps the results within [0.0, 1.0]
+
+        void applyNoise(std::vector<SensorReading>& readings, size_t first, int tick);
 
     public:
-        Sensor(const std::string& sensorID, double accuracy);
+        Sensor(const std::string& sensorID, SensorKind sensorKind, const SensorFootprint& sensorFootprint, SensorDetail sensorDetail);
 
         virtual ~Sensor();
 
-        // Pure virtual function to get readings from the environment
- 
-        virtual std::vector<SensorReading> getReadings(const std::vector<WorldObjects*>& allObjects, Position carPos, Direction carDir) = 0;
+        // Gets the readings of the environment at a given tick.
+        // Sensors only look at the index buckets overlapping their range.
+        // 'out' is cleared and refilled; its capacity is reused between ticks.
+
+        virtual void getReadings(const SpatialIndex& index, Position carPos, Direction carDir, int tick, std::vector<SensorReading>& out);
+
+        // Same, but appends to 'out' (several sensors of a kind share a buffer)
+
+        void addReadings(const SpatialIndex& index, Position carPos, Direction carDir, int tick, std::vector<SensorReading>& out);
+
+        // Appends the readings over objects gathered by the caller; they must include
+        // the footprint's bounding box (used by the sensor suite to share one gather)
+
+        void scanCandidates(const SensorCandidates& batch, Position carPos, Direction carDir, int tick, std::vector<SensorReading>& out);
 
         std::string getId() const;
+
+        SensorKind getKind() const;
+
+        const SensorFootprint& getFootprint() const;
+
+        // Selects the noise engine and the key identifying this sensor instance
+
+        void setNoiseEngine(const NoiseEngine* engine, uint64_t sensorKey);
+
+        // Selects the car the sensor is mounted on, which its scans leave out
+
+        void setOwner(const WorldObjects* car);
 };
  
-// Lidar Sensor: Accurate short-range 360 detection
+// Lidar Sensor: Accurate short-range 360 detection (9x9 box)
 
 class Lidar : public Sensor {
     public:
         Lidar(const std::string& sensorID);
+        Lidar(const std::string& sensorID, const SensorFootprint& sensorFootprint);
         virtual ~Lidar();
-        
-        virtual std::vector<SensorReading> getReadings(const std::vector<WorldObjects*>& allObjects, Position carPos, Direction carDir) override;     
 };
  
-// Radar Sensor: Detects moving objects at longer range
+// Radar Sensor: Detects moving objects at longer range (12-cell beam ahead)
 
 class Radar : public Sensor {
     public:
         Radar(const std::string& sensorID);
+        Radar(const std::string& sensorID, const SensorFootprint& sensorFootprint);
         virtual ~Radar();
-
-        virtual std::vector<SensorReading> getReadings(const std::vector <WorldObjects*>& allObjects, Position carPos, Direction carDir) override;
 };
 
-// Camera Sensor: Identifies object types/states (signs, lights) in FOV
+// Camera Sensor: Identifies object types/states (signs, lights) in FOV (7x7 ahead)
  
 class Camera : public Sensor {
     public:
         Camera(const std::string& sensorID);
+        Camera(const std::string& sensorID, const SensorFootprint& sensorFootprint);
         virtual ~Camera();
+};
+
+// Footprint of the standard sensor of a kind: Lidar 9x9 box, Radar 12-cell beam,
+// Camera 7x7 field of view. These are the shapes the kernels are specialized for.
+
+SensorFootprint defaultFootprint(SensorKind kind);
+
+// The standard package: one Lidar, Radar and Camera ("LIDAR", "RADAR", "CAMERA")
+
+std::vector<SensorSpec> defaultSensorPackage();
+
+// Creates the sensor described by a package entry
+
+Sensor* createSensor(const SensorSpec& spec);
+
+// Reads a sensor package file (--sensors). One sensor per line, '#' starts a comment:
+//
+//   <lidar|radar|camera> <id> [ahead=<a>..<b>] [side=<a>..<b>] [accuracy=<x>] [falloff=<x>]
+//
+// Omitted keys keep the kind's default footprint; a single number n is the range n..n.
+// 'ahead' and 'side' are in cells in the car's frame (positive side is the car's right).
+// The kind decides the rest: Lidar skips the car's own cell, Radar sees only movers
+// and reports their motion, Camera also reports light states and signs. A range may
+// include the car's cell; no sensor ever reports the car itself. A car scans its
+// sensors into one buffer per kind, in file order; IDs must be unique.
+// Example, the standard package plus a long-range radar:
+//
+//   lidar LIDAR
+//   radar RADAR
+//   camera CAMERA
+//   radar LONG_RADAR ahead=13..40 accuracy=0.97 falloff=40
+
+bool loadSensorPackage(const std::string& path, std::vector<SensorSpec>& sensors, std::string& error);
+
+// All sensors of one car scanned together in a single pass.
+// One index traversal gathers the union of their footprints (for the standard
+// package the Lidar box stretched to the Radar beam ahead), classifying each object
+// once; each sensor then runs its range-test kernel over the shared arrays and
+// appends to the buffer of its kind. The buffers end up exactly as if each sensor
+// had been scanned on its own: same readings, same order, same noise.
+
+class SensorSuite {
+    private:
+        std::vector<Sensor*> sensors;
+
+        SensorCandidates candidates;
+
+    public:
+        SensorSuite(const std::vector<Sensor*>& suiteSensors);
+
+        // Clears and refills the buffers, indexed by SensorKind
 
-        virtual std::vector<SensorReading> getReadings(const std::vector <WorldObjects*>& allObjects, Position carPos, Direction carDir) override;
+        void getReadings(const SpatialIndex& index, Position carPos, Direction carDir, int tick, std::vector<SensorReading>* const out[3]);
 };
 
-#endif
\ No newline at end of file
+#endif
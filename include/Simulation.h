@@ -5,6 +5,49 @@
 
 #include "Common.h"
  
+// Strategy used to pick free cells while generating the world.
+// REJECTION re-samples random cells until a free one is found,
+// SHUFFLE draws from the list of free cells with a partial Fisher-Yates shuffle.
+
+enum PlacementMode {PLACEMENT_REJECTION, PLACEMENT_SHUFFLE};
+
+// Counter-based generator used for sensor noise (see NoiseEngine.h)
+
+enum NoiseModel {NOISE_HASH, NOISE_PHILOX};
+
+// Range-test kernels used by the sensors (see SensorKernels.h). AUTO picks the
+// widest vector instructions the CPU has.
+
+enum SensorKernelMode {KERNEL_AUTO, KERNEL_SCALAR, KERNEL_SSE4, KERNEL_AVX2};
+
+// Steering used by the self-driving cars.
+// GREEDY turns straight toward the current target, ASTAR follows a planned path
+// around the static objects the car has sensed (see RoutePlanner.h), FIELD
+// descends a cached distance field of the target over all static objects (see FlowField.h).
+
+enum PlannerMode {PLANNER_GREEDY, PLANNER_ASTAR, PLANNER_FIELD};
+
+// Console output of the map (see Renderer.h).
+// NONE prints no maps, POV the car's surroundings every rendered tick, FULL the whole
+// map every rendered tick, ANSI draws the map once and then only redraws changed cells.
+
+enum RenderMode {RENDER_NONE, RENDER_POV, RENDER_FULL, RENDER_ANSI};
+
+// One sensor of the self-driving cars' sensor package (--sensors, format in Sensors.h).
+// The ranges are in the car's frame, as in SensorFootprint; readings lose
+// confidence linearly with the distance and reach zero at 'falloff'.
+
+struct SensorSpec {
+    SensorKind kind;
+    std::string id;
+    int minAhead;
+    int maxAhead;
+    int minSide;
+    int maxSide;
+    double accuracy;
+    double falloff;
+};
+
 // Stores all configuration parameters for the simulation
 
 struct SimSettings {
@@ -18,6 +61,32 @@ struct SimSettings {
     int numTrafficLights;
     int simulationTicks;
     double minConfidenceThreshold ;
+    PlacementMode placement;
+    bool useActorStore;
+    int threads;
+    NoiseModel noiseModel;
+    SensorKernelMode sensorKernel;
+    std::string sensorPath;
+    std::vector<SensorSpec> sensors;
+    int fleetSize;
+    PlannerMode planner;
+    int fieldBudgetMB;
+    LogLevel logLevel;
+    std::string tracePath;
+    RenderMode render;
+    int renderEvery;
+    int saveAt;
+    int checkpointEvery;
+    std::string snapshotPath;
+    std::string loadPath;
+    int loadTick;
+    std::string recordPath;
+    std::string replayPath;
+    bool profile;
+    double spawnRates[4];
+    double targetDensity;
+    std::string profileCsvPath;
+    std::string profileTracePath;
     bool helpRequested;
     std::vector<Position> gpsTargets;
 };
@@ -0,0 +1,81 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "GridWorld.h"
+#include "Simulation.h"
+
+// Snapshot files (--save-at, --checkpoint-every and --load).
+// A file starts with a header and the settings that shape the world, followed
+// by frames. The first frame holds a complete WorldState; every later frame is a
+// WorldDelta against the frame before it: the world's change journal, the state
+// of the cars, bikes and lights, and the fleet. Parked cars and signs are only
+// written once, so a checkpoint costs about as much as the moving part of the world.
+//
+//     header    "AVSSNAP1", uint32 version, uint32 reserved
+//     settings  seed, dimX, dimY, noise, planner, field budget, min confidence
+//     frame     uint8 kind (full or delta), varint payload size, payload
+//
+// Payload numbers are varints (signed ones zigzag encoded), strings are a varint
+// length and the bytes, the random state and doubles are raw 8-byte values.
+// Snapshots are read on the machine type that wrote them (little endian).
+
+const uint32_t SNAPSHOT_VERSION = 1;
+
+// Writes a snapshot file: one full frame, then optional deltas
+
+class SnapshotWriter {
+    private:
+        FILE* file;
+        bool baseWritten;
+        int frames;
+        uint64_t bytes;
+
+        // Scratch state and encoding buffer, reused between frames
+
+        WorldState state;
+        WorldDelta delta;
+        std::vector<unsigned char> buffer;
+
+        bool writeFrame(unsigned char kind);
+
+    public:
+        SnapshotWriter();
+
+        ~SnapshotWriter();
+
+        // Creates the file and writes the header and the settings
+
+        bool open(const std::string& path, const SimSettings& settings);
+
+        // Writes the complete world and starts its change journal for later deltas
+
+        bool writeFull(GridWorld& world);
+
+        // Writes what changed since the previous frame
+
+        bool writeDelta(GridWorld& world);
+
+        void close();
+
+        bool isOpen() const;
+
+        // Frames and bytes written so far (header included)
+
+        int getFrames() const;
+
+        uint64_t getBytes() const;
+};
+
+// Reads a snapshot file and rebuilds the world state of its last frame at or
+// before 'tick' (-1 for the last frame). The world settings saved in the file
+// replace those in 'settings'. Returns false with a message in 'error' if the
+// file cannot be used.
+
+bool loadSnapshot(const std::string& path, int tick, SimSettings& settings, WorldState& state, std::string& error);
+
+#endif
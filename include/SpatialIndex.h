@@ -0,0 +1,94 @@
+#ifndef SPATIAL_INDEX_H
+#define SPATIAL_INDEX_H
+
+#include <algorithm>
+#include <vector>
+
+#include "Common.h"
+#include "WorldObjects.h"
+
+// Uniform grid of square tiles ("buckets") covering the world.
+// Every in-bounds object is stored in the bucket of the tile it stands on,
+// so range queries only visit the tiles overlapping the requested box.
+// Also keeps a dense per-cell occupancy count (objects may share a cell while moving).
+
+class SpatialIndex {
+    private:
+        int width;
+        int height;
+        int tileSize;
+        int tilesX;
+        int tilesY;
+        std::vector<std::vector<WorldObjects*>> buckets;
+        std::vector<unsigned short> occupancy;
+        long long occupiedCells;
+
+        bool inBounds(Position p) const;
+
+        int bucketOf(Position p) const;
+
+        void removeFromBucket(WorldObjects* obj, int bucket);
+
+        void occupy(Position p);
+
+        void vacate(Position p);
+
+    public:
+
+        // Constructor. Tile size is the side of a bucket in cells.
+
+        SpatialIndex(int dimX, int dimY, int tile = 8);
+
+        // Adds an object at its current position (ignored if out of bounds)
+
+        void insert(WorldObjects* obj);
+
+        // Removes an object that was last indexed at the given position
+
+        void remove(WorldObjects* obj, Position at);
+
+        // Moves an object between buckets after its position changed
+
+        void relocate(WorldObjects* obj, Position from, Position to);
+
+        // Appends to 'out' every object whose position lies inside the inclusive box
+
+        void query(int minX, int minY, int maxX, int maxY, std::vector<WorldObjects*>& out) const;
+
+        // Calls visit(obj, pos) for every object whose position lies inside the
+        // inclusive box, in the order query() would append them. Saves callers that
+        // look at every object once the candidate list and a second position read.
+
+        template <typename Visitor>
+        void forEachIn(int minX, int minY, int maxX, int maxY, Visitor&& visit) const {
+            int x0 = std::max(minX, 0);
+            int y0 = std::max(minY, 0);
+            int x1 = std::min(maxX, width - 1);
+            int y1 = std::min(maxY, height - 1);
+
+            if (x0 > x1 || y0 > y1) return;
+
+            for (int ty = y0 / tileSize; ty <= y1 / tileSize; ++ty) {
+                for (int tx = x0 / tileSize; tx <= x1 / tileSize; ++tx) {
+                    const std::vector<WorldObjects*>& cell = buckets[ty * tilesX + tx];
+
+                    for (size_t i = 0; i < cell.size(); ++i) {
+                        Position p = cell[i]->getPosition();
+                        if (p.x >= minX && p.x <= maxX && p.y >= minY && p.y <= maxY) visit(cell[i], p);
+                    }
+                }
+            }
+        }
+
+        // O(1) occupancy lookup (out-of-bounds cells count as occupied)
+
+        bool isOccupied(int x, int y) const;
+
+        // Number of grid cells holding at least one object
+
+        long long getOccupiedCells() const;
+
+        void clear();
+};
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+// Fixed-size pool of worker threads used to split the world tick.
+// Work is handed out as numbered tasks; the calling thread takes part too,
+// so a pool of N threads starts N - 1 workers.
+
+class ThreadPool {
+    private:
+        std::vector<std::thread> workers;
+        std::mutex lock;
+        std::condition_variable wake;
+        std::condition_variable done;
+
+        // The published job is only borrowed for the duration of run(), so no copy
+        // of the callable (and no heap allocation) happens per job
+
+        const std::function<void(size_t)>* job;
+        size_t taskCount;
+        size_t nextTask;
+        size_t finishedTasks;
+        unsigned long long generation;
+        bool stopping;
+
+        void workerLoop();
+
+        // Runs tasks of the current job until none are left
+
+        void drainTasks(std::unique_lock<std::mutex>& guard);
+
+    public:
+        explicit ThreadPool(int threads);
+
+        ~ThreadPool();
+
+        // Total number of threads taking part in a job (workers + caller)
+
+        int size() const;
+
+        // Runs fn(0) .. fn(tasks - 1) across the pool and waits for all of them
+
+        void run(size_t tasks, const std::function<void(size_t)>& fn);
+
+        // Splits [0, n) into size() contiguous chunks and runs fn(begin, end) for each.
+        // Chunk boundaries only depend on n and size(), never on timing.
+
+        void parallelFor(size_t n, const std::function<void(size_t, size_t)>& fn);
+};
+
+#endif
@@ -0,0 +1,119 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Every kind of line the simulation logs. The text log formats an event with
+// formatEvent(); the binary trace stores the packed record, and avs-trace formats
+// it later with the same function, so both produce identical text.
+
+enum EventKind {
+    EV_WORLD_CREATED,
+    EV_WORLD_DESTROYED,
+    EV_WORLD_NO_FREE_CELL,
+    EV_WORLD_OVERFULL,
+    EV_OBJECT_ADDED,
+    EV_OBJECT_DESTROYED,
+    EV_SENSOR_READY,
+    EV_SENSOR_OFFLINE,
+    EV_SDC_CREATED,
+    EV_SDC_DESTROYED,
+    EV_CAR_MOVED,
+    EV_NAV_REACHED,
+    EV_PLANNER_PATH,
+    EV_PLANNER_UNREACHABLE,
+    EV_PLANNER_REPAIRED,
+    EV_PLANNER_LOST,
+    EV_AUTOPILOT_RED_LIGHT,
+    EV_AUTOPILOT_STOP_SIGN,
+    EV_AUTOPILOT_OBSTACLE,
+    EV_FLEET_OUT_OF_BOUNDS,
+    EV_FLEET_ARRIVED,
+    EV_FLEET_SUMMARY,
+    EV_ERROR_NO_GPS,
+    EV_SIM_END_FLEET,
+    EV_SIM_END_OUT_OF_BOUNDS,
+    EV_SIM_END_DESTINATION,
+    EV_SIM_FINISHED,
+    EV_COUNT
+};
+
+// Sensor named by the 'arg' of sensor events
+
+enum SensorKind {SENSOR_LIDAR, SENSOR_RADAR, SENSOR_CAMERA};
+
+// Log level of each event kind (0 debug, 1 info, 2 warn, 3 error; see LogLevel),
+// indexed by EventKind. constexpr so that SIM_EVENT can drop disabled kinds at compile time.
+
+constexpr int EVENT_LEVELS[EV_COUNT] = {
+    0, 0, 2, 2,         // world
+    0, 0, 0, 0, 0, 0,   // object, sensor and car lifecycle
+    0,                  // car moved
+    1, 1, 1, 1, 1,      // navigation and planner
+    1, 1, 1,            // autopilot
+    1, 1, 1,            // fleet
+    3, 1, 1, 1, 1       // run results
+};
+
+// Fixed-size event record (32 bytes), as producers hand it to the log.
+// 'name' is the index of the object/car/sensor ID in the trace's string table
+// (-1 for none); 'arg' carries a small enum (object type, sensor, outcome);
+// x, y, a, b, c are event specific numbers.
+
+struct TraceRecord {
+    int32_t tick;
+    uint16_t kind;
+    uint16_t arg;
+    int32_t name;
+    int32_t x;
+    int32_t y;
+    int32_t a;
+    int32_t b;
+    int32_t c;
+};
+
+// Header at the start of a trace file. The packed records follow it; the string
+// table (count, then [uint32 length][bytes] per string) follows the records at
+// namesOffset. The header is filled in when the trace is closed.
+
+struct TraceHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t recordCount;
+    uint64_t namesOffset;
+};
+
+// Identifies trace files ("AVSTRACE")
+
+extern const char TRACE_MAGIC[8];
+
+const uint32_t TRACE_VERSION = 1;
+
+// Largest packed record: kind and field mask bytes plus eight 5-byte varints
+
+const size_t TRACE_MAX_PACKED = 42;
+
+// Builds a record with all numbers zero and no name
+
+TraceRecord makeEvent(EventKind kind, int tick);
+
+// Appends the text form of an event (without newline) to 'out'.
+// 'name' is the record's ID string (empty if it has none).
+
+void formatEvent(const TraceRecord& record, const std::string& name, std::string& out);
+
+// Packs a record for the trace file: the kind, a mask of the fields that are
+// set, then those fields as varints (the tick as the difference to 'lastTick').
+// Most records take 3 to 8 bytes. Returns the packed size.
+
+size_t packEvent(const TraceRecord& record, int& lastTick, unsigned char* out);
+
+// Unpacks one record from 'size' bytes. Returns the bytes used, or 0 if the
+// buffer ends inside the record.
+
+size_t unpackEvent(const unsigned char* data, size_t size, int& lastTick, TraceRecord& record);
+
+#endif
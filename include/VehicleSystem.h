@@ -1,15 +1,79 @@
 #ifndef VEHICLE_SYSTEM_H
 #define VEHICLE_SYSTEM_H
 
+#include <string>
+#include <vector>
+#include <memory>
+
 #include "WorldObjects.h"
 #include "Sensors.h"
+#include "RoutePlanner.h"
+#include "FlowField.h"
+#include "Simulation.h"
 
  
 // Enum defining possible speed levels
 
 enum SpeedState {STOPPED, HALF_SPEED, FULL_SPEED};
 
-struct SimSettings;
+// Enum describing how a car's run ended
+
+enum CarOutcome {CAR_RUNNING, CAR_ARRIVED, CAR_OUT_OF_BOUNDS};
+
+const char* carOutcomeName(CarOutcome outcome);
+
+// Per-car statistics collected during a run
+
+struct CarStats {
+    CarOutcome outcome;
+    int finishTick;
+    int targetsReached;
+    int safetyStops;
+    int nearMisses;
+    int cellsTravelled;
+};
+
+// Route planning results for one GPS target
+
+struct RouteStats {
+    Position target;
+    int pathLength;
+    int repairs;
+    double planMillis;
+};
+
+// Everything a snapshot needs to rebuild a car between two ticks (see Snapshot.h).
+// The planner fields are only used with --planner astar.
+
+struct CarState {
+    std::string id;
+    int handle;
+    Position pos;
+    Direction direction;
+    SpeedState speedState;
+    std::vector<Position> gpsTargets;
+    int currentTargetIndex;
+    CarStats stats;
+    std::vector<RouteStats> routeStats;
+    int plannedTarget;
+    int lastStopSign;
+    std::vector<int> blockedCells;
+    std::vector<Position> path;
+    int pathCursor;
+};
+
+// Per-object accumulator used by sensor fusion, indexed by object handle
+
+struct FusionEntry {
+    bool used;
+    bool sawBike;
+    int count;
+    double totalScore;
+    double weightedDist;
+    Position firstPos;
+    SensorReading merged;
+};
+
 class GridWorld;
  
 // Represents the autonomous vehicle with sensors and navigation logic
@@ -19,17 +83,88 @@ class SelfDrivingCar : public MovingObject {
         SpeedState speedState;
         const GridWorld* world;
         double minConfidence;
-        Lidar* lidar;
-        Radar* radar;
-        Camera* camera;
+        std::vector<Sensor*> sensors;
+        SensorSuite* sensorSuite;
         std::vector<Position> gpsTargets;
         int currentTargetIndex;
+        CarStats stats;
+
+        // Set when the car shares the world with other self-driving cars: sensors are not
+        // scanned on the thread pool (cars are planned in parallel instead).
+
+        bool fleetMode;
+
+        // Route planner (only with --planner astar), the target index it has
+        // planned for, and the per-target planning results
+
+        PlannerMode plannerMode;
+        RoutePlanner* planner;
+        int plannedTarget;
+        std::vector<RouteStats> routeStats;
+
+        // Distance field of the current target (--planner field)
+
+        std::shared_ptr<const DistanceField> field;
+
+        // Handle of the STOP sign the car last stopped at, so it can go on afterwards
+
+        int lastStopSign;
+
+        // Navigation events produced while planning; written to the log when the car acts,
+        // so cars can plan concurrently and still log in a fixed order.
+
+        std::vector<TraceRecord> pendingEvents;
+
+        void queueEvent(EventKind kind, int arg, int a, int b);
+
+        // Reading buffers owned by the car and refilled every tick. They keep their
+        // capacity, so sensing and fusion stop allocating once the largest scan was seen.
+
+        std::vector<SensorReading> lidarData;
+        std::vector<SensorReading> radarData;
+        std::vector<SensorReading> cameraData;
+        std::vector<SensorReading> currentObstacles;
+
+        // Fusion table with one entry per world handle, and the handles filled this tick.
+        // Only touched entries are reset, so a tick costs O(readings), not O(objects).
+
+        std::vector<FusionEntry> fusionTable;
+        std::vector<int> fusionTouched;
+
+        // Adds one reading to its object's fusion entry
+
+        void accumulateReading(const SensorReading& r);
+
+        // Runs the sensors of one kind (0 = Lidar, 1 = Radar, 2 = Camera) into its buffer
+
+        void scanSensor(int sensor);
+
+        // Runs all sensors in one pass of the sensor suite
+
+        void scanSensors();
+
+        // Feeds static objects from the fused readings to the planner; true if any was new
+
+        bool learnBlockers();
+
+        // Plans, repairs and follows the route to the current target.
+        // Returns false if there is no path, so the caller can fall back to greedy steering.
+
+        bool steerAlongRoute(Position target, bool newBlockers, bool& turnAhead);
+
+        // Steps down the current target's distance field. Same contract as steerAlongRoute().
+
+        bool steerAlongField(Position target, bool& turnAhead);
 
     public:
 
-        // Constructor that initializes car and sensors
+        // Constructor that initializes car and sensors, using the GPS targets from the settings
 
         SelfDrivingCar(int startX, int startY, const GridWorld* worldRef, const SimSettings& settings);
+
+        // Constructor for fleet cars with their own ID and route
+
+        SelfDrivingCar(const std::string& carID, int startX, int startY, const GridWorld* worldRef, const SimSettings& settings, const std::vector<Position>& route);
  
         // Destructor cleaning up sensor memory
     
@@ -46,20 +181,35 @@ class SelfDrivingCar : public MovingObject {
         // Changes current moving direction
         
         void turn(Direction newDirection);
+
+        // True if a position lies in the car's cell or ahead of it
+
+        bool isAhead(Position p) const;
          
-        // Merges data from multiple sensors into a single consistent view
+        // Merges data from multiple sensors into a single consistent view.
+        // 'fused' is cleared and refilled, one reading per object handle.
         
-        std::vector<SensorReading> fuseSensorData(
+        void fuseSensorData(
             const std::vector<SensorReading>& lidarData, 
             const std::vector<SensorReading>& radarData, 
-            const std::vector<SensorReading>& cameraData
+            const std::vector<SensorReading>& cameraData,
+            std::vector<SensorReading>& fused
         );
          
         // Main logic loop: Sense -> Plan -> Act
         
         void syncNavigationSystem();
+
+        // The Plan part of syncNavigationSystem(): fuses the readings in the sensor
+        // buffers and steers. Replays call it after filling the buffers themselves.
+
+        void navigate();
+
+        // Reading buffer of one sensor (0 = Lidar, 1 = Radar, 2 = Camera), as of the last scan
+
+        std::vector<SensorReading>& sensorBuffer(int sensor);
          
-        // Applies movement updates
+        // Applies movement updates and writes the pending navigation log
 
         void executeMovement();
          
@@ -70,6 +220,31 @@ class SelfDrivingCar : public MovingObject {
         std::string getStatus() const;
 
         bool hasReachedDestination() const;
+
+        // Fleet bookkeeping
+
+        bool isActive() const;
+
+        void markFinished(CarOutcome outcome, int tick);
+
+        const CarStats& getStats() const;
+
+        std::string getOutcomeName() const;
+
+        void setFleetMode(bool enabled);
+
+        const std::vector<RouteStats>& getRouteStats() const;
+
+        // Queues the distance fields of the current and next target (--planner field)
+
+        void prefetchRoute() const;
+
+        // Snapshot support. restoreState() expects a car built with the state's ID,
+        // position and route; with --planner field it picks the current field up again.
+
+        void saveState(CarState& state) const;
+
+        void restoreState(const CarState& state);
 };
 
 #endif
\ No newline at end of file
@@ -4,9 +4,12 @@
 #include <iostream>
 #include <vector>
 #include <string>
+#include <cstdint>
 
 #include "Common.h"
 
+class SpatialIndex;
+class ActorStore;
  
 // Enum for cardinal directions
  
@@ -16,13 +19,26 @@ enum Direction {NORTH, SOUTH, EAST, WEST};
 
 enum LightState {RED, GREEN, YELLOW};
 
+// Enum for the meaning of a traffic sign
+
+enum SignType {SIGN_NONE, SIGN_STOP};
+
 // WorldObjects -> Abstract base class for all entities in the grid
  
 class WorldObjects {
     protected:
         std::string id;
+        uint64_t key;
+        int handle;
         Position pos;
         char glyph;
+        SpatialIndex* index;
+
+        // When bound, the object's state lives in slot 'slot' of an ActorStore
+        // and the accessors read it from there (compatibility view).
+
+        const ActorStore* store;
+        int slot;
 
     public:
         WorldObjects(const std::string& objectID, int x, int y, char g);
@@ -31,8 +47,26 @@ class WorldObjects {
 
         virtual void update() = 0;
 
+        // Registers the spatial index that must be notified when the object moves
+
+        void setIndex(SpatialIndex* spatialIndex);
+
+        // Binds the object to a structure-of-arrays slot (nullptr unbinds it)
+
+        void bindStore(const ActorStore* actorStore, int actorSlot);
+
         const std::string& getId() const;
 
+        // Stable 64-bit hash of the ID, used as the object's noise counter
+
+        uint64_t getKey() const;
+
+        // Dense integer handle assigned by GridWorld (-1 while not in a world)
+
+        int getHandle() const;
+
+        void setHandle(int objectHandle);
+
         Position getPosition() const;
 
         char getGlyph() const;
@@ -60,6 +94,12 @@ class TrafficLight : public StaticObject {
         virtual void update() override;
 
         LightState getState() const;
+
+        int getTimer() const;
+
+        // Puts the light at a point of its cycle (when restoring a snapshot)
+
+        void setState(LightState lightState, int lightTimer);
 };
 
 // TrafficSign -> Represents a road sign with text (e.g. "STOP")
@@ -67,11 +107,14 @@ class TrafficLight : public StaticObject {
 class TrafficSign : public StaticObject {
     private:
         std::string text;
+        SignType signType;
     
     public:
         TrafficSign(const std::string& objectID, int x, int y, const std::string& txt);
 
         const std::string& getText() const;
+
+        SignType getSignType() const;
 };
 
 // StationaryVehicles -> Represents a parked car (obstacle)
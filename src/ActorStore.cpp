@@ -0,0 +1,151 @@
+#include "../include/ActorStore.h"
+#include "../include/WorldObjects.h"
+
+using namespace std;
+
+// Light cycle tables indexed by light state (RED, GREEN, YELLOW, LIGHT_NONE).
+// Non-light actors "flip" every tick from LIGHT_NONE to LIGHT_NONE, which keeps their timer at 0.
+
+static const int lightDuration[4] = {4, 8, 2, 1};
+static const unsigned char nextLight[4] = {GREEN, YELLOW, RED, LIGHT_NONE};
+static const char lightGlyph[4] = {'R', 'G', 'Y', 0};
+
+// Copies the state of an object into a new slot and makes the object read from it.
+
+int ActorStore::add(WorldObjects* obj) {
+    int slot = (int)owner.size();
+    Position p = obj->getPosition();
+    char g = obj->getGlyph();
+
+    x.push_back(p.x);
+    y.push_back(p.y);
+    glyph.push_back(g);
+    owner.push_back(obj);
+
+    int s = 0, vx = 0, vy = 0;
+    unsigned char dir = NORTH;
+    unsigned char k = ACTOR_STATIC;
+    unsigned char light = LIGHT_NONE;
+    int timer = 0;
+
+    if (g == 'C' || g == 'B') {
+        MovingObject* mov = (MovingObject*)obj;
+        k = ACTOR_MOVER;
+        s = mov->getSpeed();
+        dir = mov->getDirection();
+
+        switch (mov->getDirection()) {
+            case NORTH: vy = s; break;
+            case SOUTH: vy = -s; break;
+            case EAST: vx = s; break;
+            case WEST: vx = -s; break;
+        }
+    }
+
+    else if (g == 'R' || g == 'G' || g == 'Y') {
+        TrafficLight* tl = (TrafficLight*)obj;
+        k = ACTOR_LIGHT;
+        light = tl->getState();
+        timer = tl->getTimer();
+    }
+
+    speed.push_back(s);
+    direction.push_back(dir);
+    velX.push_back(vx);
+    velY.push_back(vy);
+    kind.push_back(k);
+    lightState.push_back(light);
+    lightTimer.push_back(timer);
+
+    obj->bindStore(this, slot);
+    return slot;
+}
+
+// Swap-and-pop removal. The actor moved into the freed slot is re-bound to it.
+
+void ActorStore::removeAt(size_t slot) {
+    size_t last = owner.size() - 1;
+    owner[slot]->bindStore(nullptr, -1);
+
+    if (slot != last) {
+        x[slot] = x[last];
+        y[slot] = y[last];
+        speed[slot] = speed[last];
+        direction[slot] = direction[last];
+        velX[slot] = velX[last];
+        velY[slot] = velY[last];
+        glyph[slot] = glyph[last];
+        kind[slot] = kind[last];
+        lightState[slot] = lightState[last];
+        lightTimer[slot] = lightTimer[last];
+        owner[slot] = owner[last];
+        owner[slot]->bindStore(this, (int)slot);
+    }
+
+    x.pop_back();
+    y.pop_back();
+    speed.pop_back();
+    direction.pop_back();
+    velX.pop_back();
+    velY.pop_back();
+    glyph.pop_back();
+    kind.pop_back();
+    lightState.pop_back();
+    lightTimer.pop_back();
+    owner.pop_back();
+}
+
+// Same cycle as TrafficLight::update(), written with table lookups instead of a switch.
+
+void ActorStore::stepLights(size_t begin, size_t end) {
+    unsigned char* state = lightState.data();
+    int* timer = lightTimer.data();
+    char* g = glyph.data();
+
+    for (size_t i = begin; i < end; ++i) {
+        unsigned char st = state[i];
+        int t = timer[i] + 1;
+        bool flip = t >= lightDuration[st];
+        unsigned char ns = flip ? nextLight[st] : st;
+
+        state[i] = ns;
+        timer[i] = flip ? 0 : t;
+        if (lightGlyph[ns] != 0) g[i] = lightGlyph[ns];
+    }
+}
+
+// Same movement as MovingObject::move(); static actors have zero velocity.
+
+void ActorStore::stepMovers(size_t begin, size_t end) {
+    int* px = x.data();
+    int* py = y.data();
+    const int* vx = velX.data();
+    const int* vy = velY.data();
+
+    for (size_t i = begin; i < end; ++i) {
+        px[i] += vx[i];
+        py[i] += vy[i];
+    }
+}
+
+// Number of actors in the store.
+
+size_t ActorStore::size() const {
+    return owner.size();
+}
+
+// Drops every slot without touching the owning objects.
+
+void ActorStore::clear() {
+    x.clear();
+    y.clear();
+    speed.clear();
+    direction.clear();
+    velX.clear();
+    velY.clear();
+    glyph.clear();
+    kind.clear();
+    lightState.clear();
+    lightTimer.clear();
+    owner.clear();
+}
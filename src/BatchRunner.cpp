@@ -0,0 +1,468 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <map>
+#include <thread>
+
+#include "../include/BatchRunner.h"
+#include "../include/GridWorld.h"
+#include "../include/ThreadPool.h"
+#include "../include/Sensors.h"
+
+using namespace std;
+
+// Names of the RunEnd values as written to the summaries
+
+static const char* const END_NAMES[] = {"TICK_LIMIT", "FLEET_DONE", "OUT_OF_BOUNDS", "DESTINATION", "CAR_GONE"};
+
+// Removes leading and trailing blanks.
+
+static string trim(const string& text) {
+    size_t first = text.find_first_not_of(" \t\r");
+    if (first == string::npos) return "";
+    size_t last = text.find_last_not_of(" \t\r");
+    return text.substr(first, last - first + 1);
+}
+
+// Splits a value into whitespace separated tokens.
+
+static vector<string> tokenize(const string& text) {
+    vector<string> tokens;
+    istringstream in(text);
+    string token;
+    while (in >> token) tokens.push_back(token);
+    return tokens;
+}
+
+// Checks if a token is a plain integer.
+
+static bool isInteger(const string& text) {
+    if (text.empty()) return false;
+    size_t start = (text[0] == '-' || text[0] == '+') ? 1 : 0;
+    if (start == text.size()) return false;
+    return text.find_first_not_of("0123456789", start) == string::npos;
+}
+
+// Expands 'a..b' or 'a..b:step' into the values of the range. Returns false if
+// the token is not a well-formed range.
+
+static bool expandRange(const string& token, vector<vector<string>>& values) {
+    size_t dots = token.find("..");
+    if (dots == string::npos) return false;
+
+    size_t colon = token.find(':', dots);
+    string from = token.substr(0, dots);
+    string to = token.substr(dots + 2, colon == string::npos ? string::npos : colon - dots - 2);
+    string step = (colon == string::npos) ? "1" : token.substr(colon + 1);
+
+    if (isInteger(from) && isInteger(to) && isInteger(step)) {
+        long long first = atoll(from.c_str()), last = atoll(to.c_str()), delta = atoll(step.c_str());
+        if (delta <= 0 || last < first) return false;
+
+        for (long long v = first; v <= last; v += delta) values.push_back(vector<string>(1, to_string(v)));
+        return true;
+    }
+
+    char* end = nullptr;
+    double first = strtod(from.c_str(), &end);
+    if (from.empty() || *end != '\0') return false;
+    double last = strtod(to.c_str(), &end);
+    if (to.empty() || *end != '\0') return false;
+    double delta = strtod(step.c_str(), &end);
+    if (step.empty() || *end != '\0' || delta <= 0.0 || last < first) return false;
+
+    // Count the steps up front so rounding does not drop the last value
+
+    long long count = (long long)((last - first) / delta + 1e-9) + 1;
+
+    for (long long i = 0; i < count; ++i) {
+        char text[32];
+        snprintf(text, sizeof(text), "%g", first + i * delta);
+        values.push_back(vector<string>(1, text));
+    }
+    return true;
+}
+
+// Escapes a string for a JSON document.
+
+static string jsonString(const string& text) {
+    string out = "\"";
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (text[i] == '"' || text[i] == '\\') out += '\\';
+        out += text[i];
+    }
+    return out + "\"";
+}
+
+// Quotes a CSV field if it contains separators or quotes.
+
+static string csvField(const string& text) {
+    if (text.find_first_of(",\"") == string::npos) return text;
+
+    string out = "\"";
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (text[i] == '"') out += '"';
+        out += text[i];
+    }
+    return out + "\"";
+}
+
+// Formats a mean for the summaries ("-" when there is nothing to average).
+
+static string meanText(double total, long long count) {
+    if (count == 0) return "-";
+    char text[32];
+    snprintf(text, sizeof(text), "%.2f", total / count);
+    return text;
+}
+
+// Checks if the command line asks for a batch.
+
+bool isBatchCommand(int argc, char** argv) {
+    for (int i = 1; i < argc; i++)
+        if (string(argv[i]) == "--batch") return true;
+    return false;
+}
+
+// Splits the command line. Everything that is not a batch flag is passed to every run.
+
+BatchOptions parseBatchArguments(int argc, char** argv) {
+    BatchOptions options;
+    options.jobs = (int)thread::hardware_concurrency();
+    if (options.jobs < 1) options.jobs = 1;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+
+        if (arg == "--batch" && (i + 1) < argc) options.specPath = argv[++i];
+
+        else if (arg == "--jobs" && (i + 1) < argc) {
+            options.jobs = atoi(argv[++i]);
+            if (options.jobs < 1) options.jobs = 1;
+        }
+
+        else if (arg == "--csv" && (i + 1) < argc) options.csvPath = argv[++i];
+
+        else if (arg == "--json" && (i + 1) < argc) options.jsonPath = argv[++i];
+
+        else if (arg == "--batch-log-dir" && (i + 1) < argc) options.logDir = argv[++i];
+
+        else options.baseArgs.push_back(arg);
+    }
+
+    return options;
+}
+
+// Constructor.
+
+BatchRunner::BatchRunner(const BatchOptions& batchOptions) : options(batchOptions) {}
+
+// Reads the sweep spec.
+
+bool BatchRunner::loadSpec() {
+    ifstream in(options.specPath.c_str());
+    if (!in.is_open()) {
+        cout << "Error: Could not open sweep spec '" << options.specPath << "'!" << endl;
+        return false;
+    }
+
+    string line;
+    int lineNumber = 0;
+
+    while (getline(in, line)) {
+        lineNumber++;
+
+        size_t hash = line.find('#');
+        if (hash != string::npos) line = line.substr(0, hash);
+        line = trim(line);
+        if (line.empty()) continue;
+
+        size_t equals = line.find('=');
+        if (equals == string::npos) {
+            cout << "Error: Line " << lineNumber << " of the sweep spec has no '='." << endl;
+            return false;
+        }
+
+        SweepAxis axis;
+        axis.flag = trim(line.substr(0, equals));
+        if (axis.flag.substr(0, 2) == "--") axis.flag = axis.flag.substr(2);
+
+        string rest = line.substr(equals + 1);
+        size_t start = 0;
+
+        while (start <= rest.size()) {
+            size_t comma = rest.find(',', start);
+            if (comma == string::npos) comma = rest.size();
+
+            vector<string> tokens = tokenize(rest.substr(start, comma - start));
+
+            if (tokens.size() == 1 && tokens[0].find("..") != string::npos) {
+                if (!expandRange(tokens[0], axis.values)) {
+                    cout << "Error: Bad range '" << tokens[0] << "' on line " << lineNumber << " of the sweep spec." << endl;
+                    return false;
+                }
+            }
+            else if (!tokens.empty()) axis.values.push_back(tokens);
+
+            start = comma + 1;
+        }
+
+        if (axis.flag.empty() || axis.values.empty()) {
+            cout << "Error: Line " << lineNumber << " of the sweep spec has no values." << endl;
+            return false;
+        }
+
+        axes.push_back(axis);
+    }
+
+    return true;
+}
+
+// Enumerates every combination and parses its settings. The base arguments come
+// first, so the swept values override them.
+
+void BatchRunner::expand() {
+    vector<size_t> choice(axes.size(), 0);
+
+    while (true) {
+        vector<string> args(1, "avs");
+        args.insert(args.end(), options.baseArgs.begin(), options.baseArgs.end());
+
+        for (size_t a = 0; a < axes.size(); ++a) {
+            args.push_back("--" + axes[a].flag);
+            const vector<string>& value = axes[a].values[choice[a]];
+            args.insert(args.end(), value.begin(), value.end());
+        }
+
+        vector<char*> argv;
+        for (size_t i = 0; i < args.size(); ++i) argv.push_back(&args[i][0]);
+
+        choices.push_back(choice);
+        settings.push_back(parseArguments((int)argv.size(), argv.data()));
+
+        // Advance the last axis first, like an odometer
+
+        int a = (int)axes.size() - 1;
+        while (a >= 0 && ++choice[a] == axes[a].values.size()) choice[a--] = 0;
+        if (a < 0) break;
+    }
+}
+
+// Runs one simulation with its own world and its own log (closed unless --batch-log-dir).
+
+void BatchRunner::runOne(size_t run) {
+    const SimSettings& config = settings[run];
+    BatchResult& result = results[run];
+
+    result.valid = !(config.gpsTargets.empty() && config.fleetSize <= 1);
+    result.seed = config.seed;
+    if (!result.valid) return;
+
+    AsyncLog log;
+
+    if (!options.logDir.empty()) {
+        log.open(options.logDir + "/run_" + to_string(run) + ".log");
+        log.setLevel(config.logLevel);
+    }
+
+    LogBinding binding(log);
+
+    {
+        GridWorld world(config.dimX, config.dimY);
+        world.generateWorld(config);
+
+        RunEnd end = RUN_ACTIVE;
+
+        while (end == RUN_ACTIVE && world.getTicks() < config.simulationTicks) {
+            world.update();
+            end = world.checkEnd();
+        }
+
+        result.ticks = world.getTicks();
+        result.end = end;
+
+        const vector<SelfDrivingCar*>& fleet = world.getFleet();
+        result.cars = (int)fleet.size();
+
+        for (size_t i = 0; i < fleet.size(); ++i) {
+            const CarStats& stats = fleet[i]->getStats();
+
+            if (stats.outcome == CAR_ARRIVED) {
+                result.arrived++;
+                result.arrivalTicks += stats.finishTick;
+            }
+            else if (stats.outcome == CAR_OUT_OF_BOUNDS) result.outOfBounds++;
+
+            result.targets += stats.targetsReached;
+            result.stops += stats.safetyStops;
+            result.nearMisses += stats.nearMisses;
+            result.cells += stats.cellsTravelled;
+        }
+    }
+
+    log.close();
+}
+
+// Value of a run on an axis.
+
+string BatchRunner::valueText(size_t run, size_t axis) const {
+    const vector<string>& value = axes[axis].values[choices[run][axis]];
+    string text;
+
+    for (size_t i = 0; i < value.size(); ++i) {
+        if (i > 0) text += ' ';
+        text += value[i];
+    }
+    return text;
+}
+
+// Group of a run: the settings it was run with, apart from the seed.
+
+string BatchRunner::groupKey(size_t run) const {
+    string key;
+
+    for (size_t a = 0; a < axes.size(); ++a) {
+        if (axes[a].flag == "seed") continue;
+        if (!key.empty()) key += ' ';
+        key += axes[a].flag + "=" + valueText(run, a);
+    }
+    return key.empty() ? "all" : key;
+}
+
+// Prints one line per group: how many cars arrived or left the grid, how long
+// arriving took and how often the cars stopped or nearly hit something.
+
+void BatchRunner::printSummary(double seconds) const {
+    map<string, vector<size_t>> groups;
+    for (size_t r = 0; r < results.size(); ++r) groups[groupKey(r)].push_back(r);
+
+    for (map<string, vector<size_t>>::const_iterator it = groups.begin(); it != groups.end(); ++it) {
+        int runs = 0, cars = 0, arrived = 0, outOfBounds = 0;
+        long long arrivalTicks = 0, stops = 0, nearMisses = 0;
+
+        for (size_t i = 0; i < it->second.size(); ++i) {
+            const BatchResult& result = results[it->second[i]];
+            if (!result.valid) continue;
+
+            runs++;
+            cars += result.cars;
+            arrived += result.arrived;
+            outOfBounds += result.outOfBounds;
+            arrivalTicks += result.arrivalTicks;
+            stops += result.stops;
+            nearMisses += result.nearMisses;
+        }
+
+        cout << "[" << it->first << "] runs=" << runs << " arrived=" << arrived << "/" << cars
+             << " outOfBounds=" << outOfBounds << " ticksToDestination=" << meanText((double)arrivalTicks, arrived)
+             << " stops=" << meanText((double)stops, runs) << " nearMisses=" << meanText((double)nearMisses, runs) << endl;
+    }
+
+    cout << "Batch finished: " << results.size() << " runs in " << seconds << " s ("
+         << (seconds > 0.0 ? results.size() / seconds : 0.0) << " runs/s)" << endl;
+}
+
+// One row per run.
+
+bool BatchRunner::writeCsv() const {
+    ofstream out(options.csvPath.c_str());
+    if (!out.is_open()) return false;
+
+    out << "run,seed";
+    for (size_t a = 0; a < axes.size(); ++a)
+        if (axes[a].flag != "seed") out << "," << csvField(axes[a].flag);
+    out << ",end,ticks,cars,arrived,out_of_bounds,targets,stops,near_misses,cells,mean_arrival_tick\n";
+
+    for (size_t r = 0; r < results.size(); ++r) {
+        const BatchResult& result = results[r];
+
+        out << r << "," << result.seed;
+        for (size_t a = 0; a < axes.size(); ++a)
+            if (axes[a].flag != "seed") out << "," << csvField(valueText(r, a));
+
+        if (!result.valid) {
+            out << ",INVALID,,,,,,,,,\n";
+            continue;
+        }
+
+        out << "," << END_NAMES[result.end] << "," << result.ticks << "," << result.cars << "," << result.arrived
+            << "," << result.outOfBounds << "," << result.targets << "," << result.stops << "," << result.nearMisses
+            << "," << result.cells << "," << (result.arrived > 0 ? meanText((double)result.arrivalTicks, result.arrived) : "") << "\n";
+    }
+
+    return true;
+}
+
+// The runs as an array of objects, with the swept values under "settings".
+
+bool BatchRunner::writeJson() const {
+    ofstream out(options.jsonPath.c_str());
+    if (!out.is_open()) return false;
+
+    out << "{\n  \"runs\": [\n";
+
+    for (size_t r = 0; r < results.size(); ++r) {
+        const BatchResult& result = results[r];
+
+        out << "    {\"run\": " << r << ", \"seed\": " << result.seed << ", \"settings\": {";
+        for (size_t a = 0; a < axes.size(); ++a)
+            out << (a > 0 ? ", " : "") << jsonString(axes[a].flag) << ": " << jsonString(valueText(r, a));
+        out << "}";
+
+        if (result.valid) {
+            out << ", \"end\": " << jsonString(END_NAMES[result.end]) << ", \"ticks\": " << result.ticks
+                << ", \"cars\": " << result.cars << ", \"arrived\": " << result.arrived << ", \"outOfBounds\": " << result.outOfBounds
+                << ", \"targets\": " << result.targets << ", \"stops\": " << result.stops << ", \"nearMisses\": " << result.nearMisses
+                << ", \"cells\": " << result.cells;
+            if (result.arrived > 0) out << ", \"meanArrivalTick\": " << meanText((double)result.arrivalTicks, result.arrived);
+        }
+        else out << ", \"end\": \"INVALID\"";
+
+        out << "}" << (r + 1 < results.size() ? "," : "") << "\n";
+    }
+
+    out << "  ]\n}\n";
+    return true;
+}
+
+// Loads the spec, runs every combination and writes the summaries.
+
+int BatchRunner::run() {
+    if (!loadSpec()) return 1;
+
+    expand();
+
+    for (size_t i = 0; i < settings.size(); ++i) {
+        string error;
+
+        if (!settings[i].sensorPath.empty() && !loadSensorPackage(settings[i].sensorPath, settings[i].sensors, error)) {
+            cout << "Error: " << error << endl;
+            return 1;
+        }
+    }
+
+    BatchResult empty = {false, 0, 0, RUN_ACTIVE, 0, 0, 0, 0, 0, 0, 0, 0};
+    results.assign(settings.size(), empty);
+
+    cout << "Batch: " << settings.size() << " runs on " << options.jobs << " threads" << endl;
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    // Runs are claimed one at a time, so a thread that finishes a short run
+    // immediately takes the next one instead of waiting on a fixed share
+
+    {
+        ThreadPool pool(options.jobs);
+        pool.run(settings.size(), [this](size_t run) { runOne(run); });
+    }
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    printSummary(seconds);
+
+    if (!options.csvPath.empty() && !writeCsv()) cout << "Error: Could not write '" << options.csvPath << "'!" << endl;
+    if (!options.jsonPath.empty() && !writeJson()) cout << "Error: Could not write '" << options.jsonPath << "'!" << endl;
+    return 0;
+}
@@ -0,0 +1,230 @@
+#include "../include/FlowField.h"
+
+using namespace std;
+
+// Cell offsets for NORTH, SOUTH, EAST, WEST (same convention as MovingObject::move)
+
+static const int DIR_X[4] = {0, 0, 1, -1};
+static const int DIR_Y[4] = {1, -1, 0, 0};
+
+// Constructor. The field starts with every cell unreachable.
+
+DistanceField::DistanceField(int dimX, int dimY, Position targetPos) : width(dimX), height(dimY), target(targetPos), dist((size_t)dimX * dimY, -1) {}
+
+// Breadth-first search outwards from the target over the free cells.
+
+void DistanceField::compute(const vector<unsigned char>& blocked, vector<int>& queue) {
+    int start = target.y * width + target.x;
+    if (blocked[start]) return;
+
+    size_t head = 0, tail = 0;
+    dist[start] = 0;
+    queue[tail++] = start;
+
+    while (head < tail) {
+        int cell = queue[head++];
+        int x = cell % width;
+        int y = cell / width;
+
+        for (int d = 0; d < 4; ++d) {
+            int nx = x + DIR_X[d];
+            int ny = y + DIR_Y[d];
+            if (nx < 0 || nx >= width || ny < 0 || ny >= height) continue;
+
+            int next = ny * width + nx;
+            if (dist[next] >= 0 || blocked[next]) continue;
+
+            dist[next] = dist[cell] + 1;
+            queue[tail++] = next;
+        }
+    }
+}
+
+// Accessor for the distance of a cell (-1 outside the grid).
+
+int DistanceField::distanceAt(int x, int y) const {
+    if (x < 0 || x >= width || y < 0 || y >= height) return -1;
+    return dist[y * width + x];
+}
+
+// Steepest descent step: any neighbour with distance d - 1 lies on a shortest path.
+
+bool DistanceField::gradient(Position at, Direction current, Direction& next, int& runLength) const {
+    int here = distanceAt(at.x, at.y);
+    if (here <= 0) return false;
+
+    int cx = at.x + DIR_X[current];
+    int cy = at.y + DIR_Y[current];
+
+    if (distanceAt(cx, cy) == here - 1) next = current;
+
+    else {
+        bool found = false;
+
+        for (int d = 0; d < 4 && !found; ++d) {
+            if (distanceAt(at.x + DIR_X[d], at.y + DIR_Y[d]) == here - 1) {
+                next = (Direction)d;
+                found = true;
+            }
+        }
+        if (!found) return false;
+    }
+
+    runLength = (distanceAt(at.x + 2 * DIR_X[next], at.y + 2 * DIR_Y[next]) == here - 2) ? 2 : 1;
+    return true;
+}
+
+// Memory held by the field.
+
+size_t DistanceField::bytes() const {
+    return dist.size() * sizeof(int);
+}
+
+// Constructor. Starts the background thread that computes queued fields.
+
+FlowFieldCache::FlowFieldCache(int dimX, int dimY, const vector<unsigned char>& staticCells, size_t budget) : width(dimX), height(dimY), blocked(staticCells), budgetBytes(budget), usedBytes(0), peakBytes(0), computed(0), hits(0), evictions(0), stopping(false) {
+    worker = thread(&FlowFieldCache::workerLoop, this);
+}
+
+// Destructor. Stops the worker; queued fields that were never needed are dropped.
+
+FlowFieldCache::~FlowFieldCache() {
+    {
+        unique_lock<mutex> guard(lock);
+        stopping = true;
+    }
+    wake.notify_all();
+    worker.join();
+}
+
+// Worker body: takes queued targets one by one and computes their fields
+// without holding the lock.
+
+void FlowFieldCache::workerLoop() {
+    vector<int> queue;
+    unique_lock<mutex> guard(lock);
+
+    while (true) {
+        wake.wait(guard, [this] { return stopping || !pending.empty(); });
+        if (stopping) return;
+
+        int cell = pending.front();
+        pending.pop_front();
+
+        guard.unlock();
+        if (queue.empty()) queue.resize((size_t)width * height);
+
+        DistanceField* field = new DistanceField(width, height, {cell % width, cell / width});
+        field->compute(blocked, queue);
+        guard.lock();
+
+        Entry& entry = entries[cell];
+        entry.field.reset(field);
+        entry.ready = true;
+        lru.push_front(cell);
+        entry.lru = lru.begin();
+
+        computed++;
+        usedBytes += field->bytes();
+        if (usedBytes > peakBytes) peakBytes = usedBytes;
+        evict();
+
+        finished.notify_all();
+    }
+}
+
+// Adds a target to the work queue.
+
+void FlowFieldCache::enqueue(int cell) {
+    if (entries.count(cell) != 0) return;
+
+    Entry entry;
+    entry.ready = false;
+    entry.lru = lru.end();
+    entries[cell] = entry;
+
+    pending.push_back(cell);
+    wake.notify_one();
+}
+
+// Evicts from the back of the LRU list; the newest field always stays.
+
+void FlowFieldCache::evict() {
+    while (usedBytes > budgetBytes && lru.size() > 1) {
+        int cell = lru.back();
+        lru.pop_back();
+
+        unordered_map<int, Entry>::iterator it = entries.find(cell);
+        usedBytes -= it->second.field->bytes();
+        entries.erase(it);
+        evictions++;
+    }
+}
+
+// Queues a field so it is likely ready when a car reaches that part of its route.
+
+void FlowFieldCache::prefetch(Position target) {
+    if (target.x < 0 || target.x >= width || target.y < 0 || target.y >= height) return;
+
+    unique_lock<mutex> guard(lock);
+    enqueue(target.y * width + target.x);
+}
+
+// Returns a finished field, waiting for the worker if necessary.
+// A field evicted while waiting is simply queued again.
+
+shared_ptr<const DistanceField> FlowFieldCache::acquire(Position target) {
+    if (target.x < 0 || target.x >= width || target.y < 0 || target.y >= height) return nullptr;
+
+    int cell = target.y * width + target.x;
+    unique_lock<mutex> guard(lock);
+
+    // A hit is a target that was cached or already requested; whether the worker
+    // has finished it yet depends on timing and must not change the statistics
+
+    if (entries.count(cell) != 0) hits++;
+
+    while (true) {
+        unordered_map<int, Entry>::iterator it = entries.find(cell);
+
+        if (it == entries.end()) {
+            enqueue(cell);
+            continue;
+        }
+
+        if (it->second.ready) {
+            lru.splice(lru.begin(), lru, it->second.lru);
+            return it->second.field;
+        }
+
+        finished.wait(guard);
+    }
+}
+
+// Number of fields computed so far (recomputations after eviction included).
+
+size_t FlowFieldCache::getComputed() {
+    unique_lock<mutex> guard(lock);
+    return computed;
+}
+
+// Number of acquisitions of a target that was cached or already queued.
+
+size_t FlowFieldCache::getHits() {
+    unique_lock<mutex> guard(lock);
+    return hits;
+}
+
+// Number of fields dropped to stay within the budget.
+
+size_t FlowFieldCache::getEvictions() {
+    unique_lock<mutex> guard(lock);
+    return evictions;
+}
+
+// Highest memory held by finished fields at any time.
+
+size_t FlowFieldCache::getPeakBytes() {
+    unique_lock<mutex> guard(lock);
+    return peakBytes;
+}
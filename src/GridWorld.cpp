@@ -1,5 +1,7 @@
 #include <iostream>
 #include <cstdlib>
+#include <algorithm>
+#include <cstdint>
 
 #include "../include/GridWorld.h"
 
@@ -8,129 +10,625 @@ using namespace std;
 // Constructor for GridWorld. 
 // Initializes dimensions, tick count, and logs the creation.
 
-GridWorld::GridWorld(int dimX, int dimY):width(dimX), height(dimY), currentTick(0), car(NULL) {
-    simLog << "[+WORLD: GRID] World initialized " << width << "x" << height << endl;
+GridWorld::GridWorld(int dimX, int dimY):width(dimX), height(dimY), currentTick(0), spatialIndex(dimX, dimY), car(NULL), useActorStore(false), noise(nullptr), pool(nullptr), fields(nullptr), freeDrawn(0), drawFromFreeList(false), spawning(false), targetMovers(0), spawnSeed(0), spawnedMovers(0), departedMovers(0), recorder(nullptr), trackingChanges(false) {
+    SIM_EVENT(EV_WORLD_CREATED).at(width, height);
 }
 
 // Destructor for GridWorld.
-// Cleans up all dynamically allocated world objects and the car.
+// Destroys the world objects (their pool chunks are freed with objectPool) and the cars.
 
 GridWorld::~GridWorld() {
 
-    for(size_t i = 0; i < objects.size(); ++i) delete objects[i];
+    for(size_t i = 0; i < objects.size(); ++i) objectPool.destroy(objects[i]);
     objects.clear();
+    actors.clear();
+    spatialIndex.clear();
+    handles.clear();
+    freeHandles.clear();
 
-    if (car != nullptr) {
-        delete car;
-        car = nullptr;
-    }
+    for (size_t i = 0; i < fleet.size(); ++i) delete fleet[i];
+    fleet.clear();
+    car = nullptr;
+
+    delete fields;
+    fields = nullptr;
+
+    delete pool;
+    pool = nullptr;
 
-    simLog << "[-WORLD] World destroyed." << endl;
+    delete noise;
+    noise = nullptr;
+
+    SIM_EVENT(EV_WORLD_DESTROYED);
 }
 
-// Finds a random position on the grid that is not occupied by any object or the car.
+// Finds a random position on the grid that is not occupied by any object or car.
+// In shuffle mode the next cell of the partially shuffled free-cell list is returned,
+// otherwise random cells are sampled until the occupancy grid reports a free one.
 
 Position GridWorld::getRandomEmptyPosition() {
+    if (drawFromFreeList) {
+        if (freeDrawn >= freeCells.size()) return {-1, -1};
+
+        size_t pick = freeDrawn + (size_t)rng.below(freeCells.size() - freeDrawn);
+        swap(freeCells[freeDrawn], freeCells[pick]);
+        int cell = freeCells[freeDrawn++];
+
+        return {cell % width, cell / width};
+    }
+
     int x, y;
     bool occupied;
 
     do {
-        x = rand() % width;
-        y = rand() % height;
-        occupied = false;
- 
-        // Check against world objects
-     
-        for (size_t i = 0 ; i < objects.size(); ++i) {
-            Position objectPos = objects[i]->getPosition();
-            if(objectPos.x == x && objectPos.y == y) {
-                occupied = true;
-                break;
-            }
-        }
+        x = (int)rng.below(width);
+        y = (int)rng.below(height);
+        occupied = spatialIndex.isOccupied(x, y);
+    } while (occupied);
+    return {x, y};
+}
 
-        // Check against the car
-        
-        if (car != nullptr) {
-            Position carPos = car->getPosition();
-            if (carPos.x == x && carPos.y == y) occupied = true;
+// Collects every free cell into freeCells and resets the draw cursor.
+
+void GridWorld::buildFreeCellList() {
+    freeCells.clear();
+    freeCells.reserve((size_t)width * height - spatialIndex.getOccupiedCells());
+
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            if (spatialIndex.isOccupied(x, y)) continue;
+            freeCells.push_back(y * width + x);
         }
+    }
+    freeDrawn = 0;
+}
 
-    } while (occupied);
-    return {x, y};
+// Checks whether any cell is still available for placement.
+
+bool GridWorld::hasFreeCell() const {
+    return spatialIndex.getOccupiedCells() < (long long)width * height;
+}
+
+// Adds a self-driving car to the fleet and to the spatial index.
+
+void GridWorld::addCar(SelfDrivingCar* sdc) {
+    fleet.push_back(sdc);
+    acquireHandle(sdc);
+    spatialIndex.insert(sdc);
+    sdc->setIndex(&spatialIndex);
+}
+
+// Draws a route of random waypoints from the world's random stream.
+
+vector<Position> GridWorld::randomRoute(int waypoints) {
+    vector<Position> route;
+
+    for (int i = 0; i < waypoints; i++) {
+        Position target;
+        target.x = (int)rng.below(width);
+        target.y = (int)rng.below(height);
+        route.push_back(target);
+    }
+    return route;
+}
+
+// Adds an object to the world and to the spatial index.
+// Moving objects keep their bucket up to date themselves through move().
+
+void GridWorld::addObject(WorldObjects* obj) {
+    objects.push_back(obj);
+    acquireHandle(obj);
+    spatialIndex.insert(obj);
+    obj->setIndex(&spatialIndex);
+
+    if (trackingChanges) changes.push_back({-1, describeObject(obj)});
+}
+
+// Reuses the most recently released handle, or appends a new one to the table.
+
+void GridWorld::acquireHandle(WorldObjects* obj) {
+    int handle;
+
+    if (!freeHandles.empty()) {
+        handle = freeHandles.back();
+        freeHandles.pop_back();
+        handles[handle] = obj;
+    }
+
+    else {
+        handle = (int)handles.size();
+        handles.push_back(obj);
+    }
+    obj->setHandle(handle);
+}
+
+// Frees an object's handle so a later object can take it.
+
+void GridWorld::releaseHandle(WorldObjects* obj) {
+    int handle = obj->getHandle();
+    if (handle < 0) return;
+
+    handles[handle] = nullptr;
+    freeHandles.push_back(handle);
+    obj->setHandle(-1);
 }
 
 // Populates the world with objects based on the settings provided.
 
 void GridWorld::generateWorld(const SimSettings& settings) {
+
+        if (!hasFreeCell()) {
+            SIM_EVENT(EV_WORLD_NO_FREE_CELL);
+            return;
+        }
+
+        long long requested = (long long)settings.fleetSize + settings.numTrafficLights + settings.numStopSigns + settings.numParkedCars + settings.numMovingCars + settings.numMovingBikes;
+        long long available = (long long)width * height - spatialIndex.getOccupiedCells();
+
+        // The counts go into the event's 'a' and 'b', clamped to their 32 bits;
+        // 'c' flags the clamped ones (1 requested, 2 available)
+
+        if (requested > available)
+            SIM_EVENT(EV_WORLD_OVERFULL).values((int)min(requested, (long long)INT32_MAX), (int)min(available, (long long)INT32_MAX),
+                                                (requested > INT32_MAX ? 1 : 0) | (available > INT32_MAX ? 2 : 0));
+
+        rng.seed((uint64_t)settings.seed);
+
+        delete noise;
+        noise = createNoiseEngine(settings.noiseModel, (uint64_t)settings.seed);
+
+        drawFromFreeList = (settings.placement == PLACEMENT_SHUFFLE);
+        if (drawFromFreeList) buildFreeCellList();
+
+        // One chunk per kind holds all generated objects
+
+        objectPool.lights.reserve(max(settings.numTrafficLights, 0));
+        objectPool.signs.reserve(max(settings.numStopSigns, 0));
+        objectPool.parked.reserve(max(settings.numParkedCars, 0));
+        objectPool.cars.reserve(max(settings.numMovingCars, 0));
+        objectPool.bikes.reserve(max(settings.numMovingBikes, 0));
         
         // Initialize the self-driving car at a random empty position.
         
         Position carStart = getRandomEmptyPosition();
-        car = new SelfDrivingCar(carStart.x, carStart.y, this, settings);   
+        int routeLength = settings.gpsTargets.empty() ? 3 : (int)settings.gpsTargets.size();
+
+        if (settings.gpsTargets.empty()) car = new SelfDrivingCar("SDC", carStart.x, carStart.y, this, settings, randomRoute(routeLength));
+        else car = new SelfDrivingCar(carStart.x, carStart.y, this, settings);
+        addCar(car);
 
         // Generate Traffic Lights
 
-        for (int i = 0; i < settings.numTrafficLights; i++) {
+        for (int i = 0; i < settings.numTrafficLights && hasFreeCell(); i++) {
             Position lightPos = getRandomEmptyPosition();
             string id = "LIGHT:" + to_string(i+1);
-            objects.push_back(new TrafficLight(id, lightPos.x, lightPos.y));
+            addObject(objectPool.lights.create(id, lightPos.x, lightPos.y));
         }
 
         // Generate Stop Signs
     
-        for (int i = 0; i < settings.numStopSigns; i++) {
+        for (int i = 0; i < settings.numStopSigns && hasFreeCell(); i++) {
             Position signPos = getRandomEmptyPosition();
             string id = "STOP:" + to_string(i+1);
-            objects.push_back(new TrafficSign(id, signPos.x, signPos.y, "STOP"));
+            addObject(objectPool.signs.create(id, signPos.x, signPos.y, "STOP"));
         }
 
         // Generate Parked Cars
         
-        for (int i = 0; i < settings.numParkedCars; i++) {
+        for (int i = 0; i < settings.numParkedCars && hasFreeCell(); i++) {
             Position parkedCarPos = getRandomEmptyPosition();
             string id = "PARKED CAR:" + to_string(i+1);
-            objects.push_back(new StationaryVehicles(id, parkedCarPos.x, parkedCarPos.y));
+            addObject(objectPool.parked.create(id, parkedCarPos.x, parkedCarPos.y));
         }
 
         // Generate Moving Cars with random directions
     
-        for (int i = 0; i < settings.numMovingCars; i++) {
+        for (int i = 0; i < settings.numMovingCars && hasFreeCell(); i++) {
             Position movingCarPos = getRandomEmptyPosition();
             string id = "CAR:" + to_string(i+1);
-            Direction dir = (Direction)(rand() % 4);
-            objects.push_back(new Car(id, movingCarPos.x, movingCarPos.y, dir));
+            Direction dir = (Direction)rng.below(4);
+            addObject(objectPool.cars.create(id, movingCarPos.x, movingCarPos.y, dir));
         }
 
         // Generate Bikes with random directions
         
-        for (int i = 0; i < settings.numMovingBikes; i++) {
+        for (int i = 0; i < settings.numMovingBikes && hasFreeCell(); i++) {
             Position movingBikePos = getRandomEmptyPosition();
             string id = "BIKE:" + to_string(i+1);
-            Direction dir = (Direction)(rand() % 4);
-            objects.push_back(new Bike(id, movingBikePos.x, movingBikePos.y, dir));
+            Direction dir = (Direction)rng.below(4);
+            addObject(objectPool.bikes.create(id, movingBikePos.x, movingBikePos.y, dir));
+        }
+
+        // Generate the rest of the fleet with random routes
+
+        for (int i = 1; i < settings.fleetSize && hasFreeCell(); i++) {
+            Position sdcPos = getRandomEmptyPosition();
+            string id = "SDC:" + to_string(i+1);
+            addCar(new SelfDrivingCar(id, sdcPos.x, sdcPos.y, this, settings, randomRoute(routeLength)));
+        }
+
+        for (size_t i = 0; i < fleet.size(); ++i) fleet[i]->setFleetMode(fleet.size() > 1);
+
+        // Every object can be released at most once, so the free list never has to grow later
+
+        freeHandles.reserve(handles.size());
+
+        // The free-cell list is only valid during generation
+
+        drawFromFreeList = false;
+        vector<int>().swap(freeCells);
+        freeDrawn = 0;
+
+        // Static-obstacle map and distance field cache for --planner field.
+        // Every car's first targets are queued right away, so the worker computes
+        // them while the simulation starts.
+
+        if (settings.planner == PLANNER_FIELD) {
+            buildFlowFields(settings);
+            for (size_t i = 0; i < fleet.size(); ++i) fleet[i]->prefetchRoute();
         }
+
+        sortObjectsByCell();
+        setupTickMode(settings);
+        setupSpawning(settings);
+}
+
+// Marks the cells of parked cars, signs and lights and creates the distance field cache over them.
+
+void GridWorld::buildFlowFields(const SimSettings& settings) {
+    staticCells.assign((size_t)width * height, 0);
+
+    for (size_t i = 0; i < objects.size(); ++i) {
+        char glyph = objects[i]->getGlyph();
+
+        if (glyph == 'P' || glyph == 'S' || glyph == 'R' || glyph == 'G' || glyph == 'Y') {
+            Position p = objects[i]->getPosition();
+            staticCells[(size_t)p.y * width + p.x] = 1;
+        }
+    }
+
+    fields = new FlowFieldCache(width, height, staticCells, (size_t)settings.fieldBudgetMB * 1024 * 1024);
+}
+
+// Moves actor state into the structure-of-arrays store when it is used.
+// The log stays identical for any thread count, so the tick mode is not logged here.
+
+void GridWorld::setupTickMode(const SimSettings& settings) {
+    useActorStore = settings.useActorStore;
+
+    if (settings.threads > 1) {
+        pool = new ThreadPool(settings.threads);
+        useActorStore = true;
+    }
+
+    if (useActorStore) {
+        for (size_t i = 0; i < objects.size(); ++i) actors.add(objects[i]);
+    }
+}
+
+// Spawning is on when any edge has a rate or a target density is set. The pools
+// get room for the target population up front, so once it is reached new
+// traffic only reuses the slots of cars and bikes that left.
+
+void GridWorld::setupSpawning(const SimSettings& settings) {
+    spawning = settings.targetDensity > 0.0;
+
+    for (int e = 0; e < 4; ++e) {
+        spawnRates[e] = settings.spawnRates[e];
+        if (spawnRates[e] > 0.0) spawning = true;
+    }
+
+    targetMovers = (long long)(settings.targetDensity * width * height);
+    spawnSeed = mix64((uint64_t)settings.seed ^ 0x5350415748ULL);
+
+    long long missing = targetMovers - getMovers();
+
+    if (missing > 0) {
+        objectPool.cars.reserve((size_t)(missing / 2 + 1));
+        objectPool.bikes.reserve((size_t)(missing / 2 + 1));
+    }
+}
+
+// Each edge gets floor(rate) arrivals plus one more with the probability of the
+// fractional part; without rates the deficit to the target is split over the
+// four edges. Arrivals stop at the target. An arrival takes a random free cell
+// of its edge (a few tries, then it is dropped) and heads straight across.
+// The draws come from a stream seeded by the tick, and IDs carry the tick, so a
+// run continued from a snapshot spawns exactly the same traffic.
+
+void GridWorld::spawnTraffic() {
+    bool capped = targetMovers > 0;
+    long long room = capped ? targetMovers - getMovers() : 0;
+    if (capped && room <= 0) return;
+
+    static const Direction heading[4] = {SOUTH, NORTH, WEST, EAST};
+
+    Random draw(mix64(spawnSeed + (uint64_t)currentTick));
+    bool byRate = spawnRates[0] > 0.0 || spawnRates[1] > 0.0 || spawnRates[2] > 0.0 || spawnRates[3] > 0.0;
+    int serial = 0;
+
+    for (int e = 0; e < 4 && (!capped || room > 0); ++e) {
+        int length = (e < 2) ? width : height;
+        long long arrivals;
+
+        if (byRate) {
+            arrivals = (long long)spawnRates[e];
+            if (draw.uniform() < spawnRates[e] - (double)arrivals) arrivals++;
+        }
+
+        else arrivals = room / 4 + (e < room % 4 ? 1 : 0);
+
+        if (arrivals > length) arrivals = length;
+
+        for (long long k = 0; k < arrivals && (!capped || room > 0); ++k) {
+            Position p = {-1, -1};
+
+            for (int attempt = 0; attempt < 4; ++attempt) {
+                int along = (int)draw.below(length);
+                Position cell = {along, height - 1};
+
+                if (e == 1) cell = {along, 0};
+                else if (e == 2) cell = {width - 1, along};
+                else if (e == 3) cell = {0, along};
+
+                if (!spatialIndex.isOccupied(cell.x, cell.y)) {
+                    p = cell;
+                    break;
+                }
+            }
+
+            if (p.x < 0) continue;
+
+            bool bike = draw.below(2) == 1;
+            string id = string(bike ? "BIKE:" : "CAR:") + to_string(currentTick) + "." + to_string(++serial);
+            ObjectState state = {bike ? 'B' : 'C', id, -1, p, heading[e], 0, ""};
+
+            if (spawnObject(state) == nullptr) continue;
+
+            spawnedMovers++;
+            room--;
+        }
+    }
+}
+
+// Orders objects by grid cell (row-major) so the actor arrays are laid out
+// spatially and the per-tick index upkeep walks memory mostly sequentially.
+// Done for both tick paths so they visit objects in the same order.
+
+static bool cellOrder(WorldObjects* a, WorldObjects* b) {
+    Position pa = a->getPosition();
+    Position pb = b->getPosition();
+    if (pa.y != pb.y) return pa.y < pb.y;
+    return pa.x < pb.x;
+}
+
+void GridWorld::sortObjectsByCell() {
+    stable_sort(objects.begin(), objects.end(), cellOrder);
 }
 
 // Updates the state of the world by one tick.
-// Calls update on all objects and the car. Removes objects that go out of bounds.
+// Updates all objects (through the actor store when enabled), removes objects
+// that went out of bounds and finally updates the car.
 
 void GridWorld::update() {
+    PROFILE_SCOPE(PHASE_TICK);
+
+    currentTick++;
+    currentLog().setTick(currentTick);
+
+    {
+        PROFILE_SCOPE(PHASE_WORLD);
+
+        if (useActorStore) updateActors();
+        else updateObjects();
+
+        if (spawning) spawnTraffic();
+    }
+
+    updateFleet();
+}
+
+// Batched Sense -> Plan -> Act for the fleet.
+// All active cars first sense and plan against the same world state (in parallel
+// when a pool exists), then move one after another in fleet order.
+// Cars that leave the grid or arrive and stop are retired with their statistics.
+
+void GridWorld::updateFleet() {
+    activeCars.clear();
+    for (size_t i = 0; i < fleet.size(); ++i)
+        if (fleet[i]->isActive()) activeCars.push_back(fleet[i]);
+
+    if (pool != nullptr && activeCars.size() > 1) {
+        pool->parallelFor(activeCars.size(), [this](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) activeCars[i]->syncNavigationSystem();
+        });
+    }
+
+    else {
+        for (size_t i = 0; i < activeCars.size(); ++i) activeCars[i]->syncNavigationSystem();
+    }
+
+    if (recorder != nullptr) recorder->recordTick(currentTick, fleet);
+
+    moveFleet();
+}
+
+// Moves the active cars one after another and checks their end conditions.
+
+void GridWorld::moveFleet() {
+    PROFILE_SCOPE(PHASE_MOVE);
+
+    for (size_t i = 0; i < activeCars.size(); ++i) {
+        SelfDrivingCar* sdc = activeCars[i];
+        sdc->executeMovement();
+
+        Position p = sdc->getPosition();
+
+        if (p.x < 0 || p.x >= width || p.y < 0 || p.y >= height) {
+            sdc->markFinished(CAR_OUT_OF_BOUNDS, currentTick);
+            if (fleet.size() > 1) SIM_EVENT(EV_FLEET_OUT_OF_BOUNDS).name(sdc->getId());
+        }
+
+        else if (sdc->hasReachedDestination() && sdc->getSpeed() == 0) {
+            sdc->markFinished(CAR_ARRIVED, currentTick);
+
+            // A car that finished its route leaves the road so it does not block the others
+
+            if (fleet.size() > 1) {
+                spatialIndex.remove(sdc, p);
+                sdc->setIndex(nullptr);
+            }
+
+            if (fleet.size() > 1) SIM_EVENT(EV_FLEET_ARRIVED).name(sdc->getId());
+        }
+    }
+}
+
+// Fills the recorded cars' sensor buffers and runs navigation and movement like
+// updateFleet(). A car counts as diverged if it is not where it was when the batches
+// were recorded, if it is not active any more, or if an active car has no batches.
+
+int GridWorld::replayTick(const SensorReplay& replay) {
+    PROFILE_SCOPE(PHASE_TICK);
+
     currentTick++;
+    currentLog().setTick(currentTick);
+
+    activeCars.clear();
+    int diverged = 0;
 
+    for (size_t i = 0; i < replay.getCarCount(); ++i) {
+        int index = replay.getCar(i);
+
+        if (index < 0 || index >= (int)fleet.size() || !fleet[index]->isActive()) {
+            diverged++;
+            continue;
+        }
+
+        SelfDrivingCar* sdc = fleet[index];
+        Position p = sdc->getPosition();
+        Position recorded = replay.getPosition(i);
+
+        if (p.x != recorded.x || p.y != recorded.y) diverged++;
+
+        for (int sensor = 0; sensor < 3; ++sensor) replay.copyReadings(i, sensor, sdc->sensorBuffer(sensor));
+        activeCars.push_back(sdc);
+    }
+
+    for (size_t i = 0; i < fleet.size(); ++i)
+        if (fleet[i]->isActive() && find(activeCars.begin(), activeCars.end(), fleet[i]) == activeCars.end()) diverged++;
+
+    if (pool != nullptr && activeCars.size() > 1) {
+        pool->parallelFor(activeCars.size(), [this](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) activeCars[i]->navigate();
+        });
+    }
+
+    else {
+        for (size_t i = 0; i < activeCars.size(); ++i) activeCars[i]->navigate();
+    }
+
+    moveFleet();
+    return diverged;
+}
+
+// Validates the cell, builds the object in its pool and adds it like a generated
+// one. In SoA mode it also gets the next actor slot, so the kernels pick it up on
+// the following tick.
+
+WorldObjects* GridWorld::spawnObject(const ObjectState& state) {
+    Position p = state.pos;
+
+    if (p.x < 0 || p.x >= width || p.y < 0 || p.y >= height) return nullptr;
+    if (spatialIndex.isOccupied(p.x, p.y)) return nullptr;
+
+    WorldObjects* obj = createObject(state);
+    if (obj == nullptr) return nullptr;
+
+    addObject(obj);
+    if (useActorStore) actors.add(obj);
+
+    return obj;
+}
+
+// Sets the recorder that receives the sensor batches.
+
+void GridWorld::setRecorder(SensorRecorder* sensorRecorder) {
+    recorder = sensorRecorder;
+}
+
+// Object path: one virtual update() per object, then prune out-of-bounds objects.
+// Pruning uses the same highest-slot-first swap-and-pop as the SoA path, so both
+// paths keep objects in the same order and produce the same log.
+
+void GridWorld::updateObjects() {
     for (size_t i = 0; i < objects.size(); ++i) objects[i]->update();
 
-    auto objIndex = objects.begin();
-    while (objIndex != objects.end()) {
-        Position objPos = (*objIndex)->getPosition();
+    for (size_t i = objects.size(); i-- > 0;) {
+        Position objPos = objects[i]->getPosition();
 
         if (objPos.x < 0 || objPos.x >= width || objPos.y < 0 || objPos.y >= height) {
-            delete *objIndex;
-            objIndex = objects.erase(objIndex);
+            WorldObjects* gone = objects[i];
+            if (trackingChanges) changes.push_back({(int)i, ObjectState()});
+            spatialIndex.remove(gone, objPos);
+            releaseHandle(gone);
+            objects[i] = objects.back();
+            objects.pop_back();
+            objectPool.destroy(gone);
+            departedMovers++;
         }
-        else objIndex++;
     }
-    if (car != nullptr) car->update();
+}
+
+// Splits [0, n) across the worker pool, or runs it as a single chunk without one.
+
+void GridWorld::forEachChunk(size_t n, const function<void(size_t, size_t)>& fn) {
+    if (pool != nullptr) pool->parallelFor(n, fn);
+    else fn(0, n);
+}
+
+// SoA path: lights and movers advance in flat loops over the actor arrays, split
+// into chunks across the pool; each chunk also flags its out-of-bounds actors.
+// The spatial index upkeep and the removals then run serially in slot order, so
+// the result is identical for any number of threads.
+
+void GridWorld::updateActors() {
+    size_t n = actors.size();
+    leaving.assign(n, 0);
+
+    forEachChunk(n, [this](size_t begin, size_t end) {
+        actors.stepLights(begin, end);
+        actors.stepMovers(begin, end);
+
+        for (size_t i = begin; i < end; ++i) {
+            int x = actors.x[i];
+            int y = actors.y[i];
+            leaving[i] = (x < 0 || x >= width || y < 0 || y >= height);
+        }
+    });
+
+    for (size_t i = 0; i < n; ++i) {
+        if (actors.velX[i] == 0 && actors.velY[i] == 0) continue;
+
+        Position to = {actors.x[i], actors.y[i]};
+        Position from = {to.x - actors.velX[i], to.y - actors.velY[i]};
+        spatialIndex.relocate(objects[i], from, to);
+    }
+
+    // Remove from the highest slot down so swap-and-pop only pulls in surviving actors
+
+    for (size_t i = n; i-- > 0;) {
+        if (!leaving[i]) continue;
+
+        WorldObjects* gone = objects[i];
+        if (trackingChanges) changes.push_back({(int)i, ObjectState()});
+        actors.removeAt(i);
+        releaseHandle(gone);
+        objects[i] = objects.back();
+        objects.pop_back();
+        objectPool.destroy(gone);
+        departedMovers++;
+    }
 }
  
 // Checks if the car has moved outside the grid boundaries.
@@ -165,8 +663,260 @@ const vector<WorldObjects*>& GridWorld::getObjects() const {
     return objects;
 }
 
+// Returns true when no car of the fleet is still driving.
+
+bool GridWorld::isFleetDone() const {
+    for (size_t i = 0; i < fleet.size(); ++i)
+        if (fleet[i]->isActive()) return false;
+    return true;
+}
+
+// Checks the end conditions in the order the main loop reports them.
+
+RunEnd GridWorld::checkEnd() {
+    if (fleet.size() > 1) return isFleetDone() ? RUN_FLEET_DONE : RUN_ACTIVE;
+
+    if (isCarOutOfBounds()) return RUN_OUT_OF_BOUNDS;
+
+    if (car != nullptr && car->hasReachedDestination() && car->getSpeed() == 0) return RUN_DESTINATION;
+
+    if (car == nullptr) return RUN_CAR_GONE;
+
+    return RUN_ACTIVE;
+}
+
+// Accessor for all self-driving cars.
+
+const vector<SelfDrivingCar*>& GridWorld::getFleet() const {
+    return fleet;
+}
+
+// Accessor for the spatial index used by the sensors.
+
+const SpatialIndex& GridWorld::getSpatialIndex() const {
+    return spatialIndex;
+}
+
+// Accessor for the worker pool (nullptr when the tick is single-threaded).
+
+ThreadPool* GridWorld::getThreadPool() const {
+    return pool;
+}
+
+// Accessor for the sensor noise engine.
+
+const NoiseEngine* GridWorld::getNoiseEngine() const {
+    return noise;
+}
+
+// Resolves a handle from a sensor reading back to its object.
+
+WorldObjects* GridWorld::objectByHandle(int handle) const {
+    if (handle < 0 || handle >= (int)handles.size()) return nullptr;
+    return handles[handle];
+}
+
+// Accessor for the size of the handle table.
+
+int GridWorld::getHandleCount() const {
+    return (int)handles.size();
+}
+
+// Accessor for the object pools (slot and chunk counts).
+
+const WorldObjectPool& GridWorld::getObjectPool() const {
+    return objectPool;
+}
+
+// Cars and bikes currently in the world (live objects of their pools).
+
+long long GridWorld::getMovers() const {
+    return (long long)(objectPool.cars.getLive() + objectPool.bikes.getLive());
+}
+
+long long GridWorld::getSpawned() const {
+    return spawnedMovers;
+}
+
+long long GridWorld::getDeparted() const {
+    return departedMovers;
+}
+
+// Accessor for the distance field cache.
+
+FlowFieldCache* GridWorld::getFlowFields() const {
+    return fields;
+}
+
 // Accessor for the self-driving car.
 
 SelfDrivingCar* GridWorld::getCar() {
     return car;
-}
\ No newline at end of file
+}
+// Snapshot record of an object, read through the accessors so it also works
+// while the object is bound to the actor store.
+
+ObjectState GridWorld::describeObject(const WorldObjects* obj) {
+    ObjectState state = {obj->getGlyph(), obj->getId(), obj->getHandle(), obj->getPosition(), NORTH, 0, ""};
+
+    if (state.glyph == 'C' || state.glyph == 'B') state.direction = ((const MovingObject*)obj)->getDirection();
+    else if (state.glyph == 'R' || state.glyph == 'G' || state.glyph == 'Y') state.timer = ((const TrafficLight*)obj)->getTimer();
+    else if (state.glyph == 'S') state.text = ((const TrafficSign*)obj)->getText();
+
+    return state;
+}
+
+// Builds the object a snapshot record describes in its pool (nullptr for an unknown glyph).
+
+WorldObjects* GridWorld::createObject(const ObjectState& state) {
+    int x = state.pos.x;
+    int y = state.pos.y;
+
+    switch (state.glyph) {
+        case 'C': return objectPool.cars.create(state.id, x, y, state.direction);
+        case 'B': return objectPool.bikes.create(state.id, x, y, state.direction);
+        case 'P': return objectPool.parked.create(state.id, x, y);
+        case 'S': return objectPool.signs.create(state.id, x, y, state.text);
+    }
+
+    if (state.glyph == 'R' || state.glyph == 'G' || state.glyph == 'Y') {
+        TrafficLight* light = objectPool.lights.create(state.id, x, y);
+        light->setState(state.glyph == 'R' ? RED : (state.glyph == 'G' ? GREEN : YELLOW), state.timer);
+        return light;
+    }
+
+    return nullptr;
+}
+
+// Rebuilds the world from a snapshot: the objects in their saved order with their
+// handles, then the fleet. The spatial index, noise engine, distance fields and
+// actor store are derived state and built again like in generateWorld().
+
+void GridWorld::restoreState(const WorldState& state, const SimSettings& settings) {
+    currentTick = state.tick;
+    currentLog().setTick(currentTick);
+    rng.seed(state.rngState);
+
+    delete noise;
+    noise = createNoiseEngine(settings.noiseModel, (uint64_t)settings.seed);
+
+    handles.assign(state.handleCount, nullptr);
+    freeHandles = state.freeHandles;
+    freeHandles.reserve(handles.size());
+
+    objects.reserve(state.objects.size());
+
+    size_t kinds[5] = {0, 0, 0, 0, 0};
+
+    for (size_t i = 0; i < state.objects.size(); ++i) {
+        switch (state.objects[i].glyph) {
+            case 'C': kinds[0]++; break;
+            case 'B': kinds[1]++; break;
+            case 'P': kinds[2]++; break;
+            case 'S': kinds[3]++; break;
+            default: kinds[4]++; break;
+        }
+    }
+
+    objectPool.cars.reserve(kinds[0]);
+    objectPool.bikes.reserve(kinds[1]);
+    objectPool.parked.reserve(kinds[2]);
+    objectPool.signs.reserve(kinds[3]);
+    objectPool.lights.reserve(kinds[4]);
+
+    for (size_t i = 0; i < state.objects.size(); ++i) {
+        WorldObjects* obj = createObject(state.objects[i]);
+        if (obj == nullptr) continue;
+
+        objects.push_back(obj);
+        obj->setHandle(state.objects[i].handle);
+        handles[state.objects[i].handle] = obj;
+        spatialIndex.insert(obj);
+        obj->setIndex(&spatialIndex);
+    }
+
+    if (settings.planner == PLANNER_FIELD) buildFlowFields(settings);
+
+    // Cars that arrived in a fleet had left the road, so they stay out of the index
+
+    for (size_t i = 0; i < state.cars.size(); ++i) {
+        const CarState& saved = state.cars[i];
+        SelfDrivingCar* sdc = new SelfDrivingCar(saved.id, saved.pos.x, saved.pos.y, this, settings, saved.gpsTargets);
+
+        fleet.push_back(sdc);
+        sdc->setHandle(saved.handle);
+        handles[saved.handle] = sdc;
+        sdc->restoreState(saved);
+
+        if (state.cars.size() > 1 && saved.stats.outcome == CAR_ARRIVED) continue;
+
+        spatialIndex.insert(sdc);
+        sdc->setIndex(&spatialIndex);
+    }
+
+    car = fleet.empty() ? nullptr : fleet[0];
+    for (size_t i = 0; i < fleet.size(); ++i) fleet[i]->setFleetMode(fleet.size() > 1);
+
+    setupTickMode(settings);
+    setupSpawning(settings);
+}
+
+// Copies the complete world state.
+
+void GridWorld::saveState(WorldState& state) const {
+    state.tick = currentTick;
+    state.rngState = rng.getState();
+    state.handleCount = (int)handles.size();
+    state.freeHandles = freeHandles;
+
+    state.objects.clear();
+    state.objects.reserve(objects.size());
+    for (size_t i = 0; i < objects.size(); ++i) state.objects.push_back(describeObject(objects[i]));
+
+    state.cars.resize(fleet.size());
+    for (size_t i = 0; i < fleet.size(); ++i) fleet[i]->saveState(state.cars[i]);
+}
+
+// Turns the change journal on or off. Either way it starts empty.
+
+void GridWorld::trackChanges(bool enabled) {
+    trackingChanges = enabled;
+    changes.clear();
+}
+
+// Hands the journal to the delta and adds the state of everything that moves or
+// cycles. Only glyph, position, direction and timer of those records are filled,
+// so collecting them does not copy any IDs.
+
+void GridWorld::saveChanges(WorldDelta& delta) {
+    delta.tick = currentTick;
+    delta.rngState = rng.getState();
+    delta.changes.swap(changes);
+    changes.clear();
+
+    delta.moving.clear();
+
+    for (size_t i = 0; i < objects.size(); ++i) {
+        ObjectState state;
+        state.glyph = objects[i]->getGlyph();
+
+        if (state.glyph == 'C' || state.glyph == 'B') {
+            state.direction = ((const MovingObject*)objects[i])->getDirection();
+            state.timer = 0;
+        }
+
+        else if (state.glyph == 'R' || state.glyph == 'G' || state.glyph == 'Y') {
+            state.direction = NORTH;
+            state.timer = ((const TrafficLight*)objects[i])->getTimer();
+        }
+
+        else continue;
+
+        state.handle = objects[i]->getHandle();
+        state.pos = objects[i]->getPosition();
+        delta.moving.push_back(state);
+    }
+
+    delta.cars.resize(fleet.size());
+    for (size_t i = 0; i < fleet.size(); ++i) fleet[i]->saveState(delta.cars[i]);
+}
@@ -0,0 +1,341 @@
+#include <cstring>
+#include <chrono>
+
+#include "../include/Logger.h"
+
+using namespace std;
+
+// Capacity of each producer ring (a power of two)
+
+static const size_t RING_CAPACITY = 1 << 20;
+
+// Every open() gets a new instance number, so cached rings of an earlier run are never reused
+
+static atomic<unsigned long long> nextInstance(1);
+
+// Constructor for a ring of the given capacity.
+
+AsyncLog::Ring::Ring(size_t capacity) : data(capacity), mask(capacity - 1), head(0), tail(0), owner(this_thread::get_id()) {}
+
+// Constructor. The log stays closed (and every level disabled) until open().
+
+AsyncLog::AsyncLog() : file(nullptr), level(LOG_DEBUG), instance(0), tracing(false), tick(0), bytesWritten(0), packedTick(0), recordCount(0), stopping(false) {}
+
+// Destructor. Flushes and closes the file if still open.
+
+AsyncLog::~AsyncLog() {
+    close();
+}
+
+// Opens the file and starts the background writer.
+
+bool AsyncLog::open(const string& path) {
+    close();
+
+    file = fopen(path.c_str(), "w");
+    if (file == nullptr) return false;
+
+    tracing = false;
+    bytesWritten = 0;
+    instance = nextInstance++;
+    stopping = false;
+    writer = thread(&AsyncLog::writerLoop, this);
+    return true;
+}
+
+// Opens a binary trace. The header is a placeholder until close() knows the
+// record count and where the string table starts.
+
+bool AsyncLog::openTrace(const string& path) {
+    close();
+
+    file = fopen(path.c_str(), "wb");
+    if (file == nullptr) return false;
+
+    TraceHeader header;
+    memset(&header, 0, sizeof(header));
+    fwrite(&header, sizeof(header), 1, file);
+
+    tracing = true;
+    bytesWritten = 0;
+    packedTick = 0;
+    recordCount = 0;
+    nameIndex.clear();
+    names.clear();
+
+    instance = nextInstance++;
+    stopping = false;
+    writer = thread(&AsyncLog::writerLoop, this);
+    return true;
+}
+
+// Checks if the log file is open.
+
+bool AsyncLog::is_open() const {
+    return file != nullptr;
+}
+
+// Stops the writer, writes what is left and releases the rings.
+
+void AsyncLog::close() {
+    if (file == nullptr) return;
+
+    {
+        unique_lock<mutex> guard(lock);
+        stopping = true;
+    }
+    wake.notify_all();
+    writer.join();
+
+    vector<char> batch;
+    drain(batch);
+
+    if (tracing) finishTrace();
+
+    fclose(file);
+    file = nullptr;
+
+    for (size_t i = 0; i < rings.size(); ++i) delete rings[i];
+    rings.clear();
+}
+
+// Sets the runtime level.
+
+void AsyncLog::setLevel(LogLevel minimum) {
+    level.store((int)minimum, memory_order_relaxed);
+}
+
+// Returns the calling thread's ring. The first call of a thread registers a new
+// ring under the lock; later calls hit the thread-local cache.
+
+AsyncLog::Ring* AsyncLog::ringForThread() {
+    static thread_local unsigned long long cachedInstance = 0;
+    static thread_local Ring* cachedRing = nullptr;
+
+    if (cachedInstance == instance) return cachedRing;
+
+    unique_lock<mutex> guard(lock);
+    thread::id self = this_thread::get_id();
+    Ring* ring = nullptr;
+
+    for (size_t i = 0; i < rings.size() && ring == nullptr; ++i)
+        if (rings[i]->owner == self) ring = rings[i];
+
+    if (ring == nullptr) {
+        ring = new Ring(RING_CAPACITY);
+        rings.push_back(ring);
+    }
+
+    cachedInstance = instance;
+    cachedRing = ring;
+    return ring;
+}
+
+// Publishes text into the thread's ring. Lines are published whole so lines of
+// different threads never interleave; if the ring is full the producer waits
+// for the writer instead of dropping lines.
+
+void AsyncLog::write(const char* text, size_t length) {
+    if (file == nullptr) return;
+
+    Ring* ring = ringForThread();
+    size_t capacity = ring->data.size();
+
+    while (length > 0) {
+        size_t chunk = length < capacity ? length : capacity;
+        size_t head = ring->head.load(memory_order_relaxed);
+
+        while (capacity - (head - ring->tail.load(memory_order_acquire)) < chunk) {
+            wake.notify_one();
+            this_thread::yield();
+        }
+
+        size_t start = head & ring->mask;
+        size_t first = chunk < capacity - start ? chunk : capacity - start;
+        memcpy(&ring->data[start], text, first);
+        memcpy(&ring->data[0], text + first, chunk - first);
+
+        ring->head.store(head + chunk, memory_order_release);
+
+        if (head + chunk - ring->tail.load(memory_order_relaxed) > capacity / 2) wake.notify_one();
+
+        text += chunk;
+        length -= chunk;
+    }
+}
+
+// Moves everything published so far into one batch and writes it
+// (packing the records first when writing a trace).
+
+void AsyncLog::drain(vector<char>& batch) {
+    batch.clear();
+
+    for (size_t i = 0; i < rings.size(); ++i) {
+        Ring* ring = rings[i];
+        size_t tail = ring->tail.load(memory_order_relaxed);
+        size_t head = ring->head.load(memory_order_acquire);
+        size_t capacity = ring->data.size();
+
+        while (tail < head) {
+            size_t start = tail & ring->mask;
+            size_t chunk = head - tail < capacity - start ? head - tail : capacity - start;
+            batch.insert(batch.end(), &ring->data[start], &ring->data[start] + chunk);
+            tail += chunk;
+        }
+        ring->tail.store(tail, memory_order_release);
+    }
+
+    if (batch.empty()) return;
+
+    if (!tracing) {
+        fwrite(batch.data(), 1, batch.size(), file);
+        bytesWritten += batch.size();
+        return;
+    }
+
+    // Every ring holds whole records, so the batch is a plain array of them
+
+    size_t count = batch.size() / sizeof(TraceRecord);
+    packed.resize(count * TRACE_MAX_PACKED);
+    size_t length = 0;
+
+    for (size_t i = 0; i < count; ++i) {
+        TraceRecord record;
+        memcpy(&record, &batch[i * sizeof(TraceRecord)], sizeof(record));
+        length += packEvent(record, packedTick, &packed[length]);
+    }
+
+    fwrite(packed.data(), 1, length, file);
+    bytesWritten += length;
+    recordCount += count;
+}
+
+// Writer body: wakes every few milliseconds (or when a ring fills up) and drains.
+
+void AsyncLog::writerLoop() {
+    vector<char> batch;
+    unique_lock<mutex> guard(lock);
+
+    while (!stopping) {
+        wake.wait_for(guard, chrono::milliseconds(5));
+        drain(batch);
+    }
+}
+
+// Index of an ID in the string table. Under a lock, since events may come from any thread.
+
+int AsyncLog::intern(const string& name) {
+    unique_lock<mutex> guard(namesLock);
+    unordered_map<string, int>::iterator it = nameIndex.find(name);
+    if (it != nameIndex.end()) return it->second;
+
+    int index = (int)names.size();
+    names.push_back(name);
+    nameIndex[name] = index;
+    return index;
+}
+
+// Appends the string table after the records and rewrites the header.
+
+void AsyncLog::finishTrace() {
+    uint32_t count = (uint32_t)names.size();
+    fwrite(&count, sizeof(count), 1, file);
+
+    for (size_t i = 0; i < names.size(); ++i) {
+        uint32_t length = (uint32_t)names[i].size();
+        fwrite(&length, sizeof(length), 1, file);
+        fwrite(names[i].data(), 1, length, file);
+    }
+
+    TraceHeader header;
+    memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+    header.version = TRACE_VERSION;
+    header.reserved = 0;
+    header.recordCount = recordCount;
+    header.namesOffset = sizeof(TraceHeader) + bytesWritten;
+
+    fseek(file, 0, SEEK_SET);
+    fwrite(&header, sizeof(header), 1, file);
+}
+
+thread_local AsyncLog* boundLog = nullptr;
+
+// Binds a log to the calling thread, remembering the previous binding.
+
+LogBinding::LogBinding(AsyncLog& log) : previous(boundLog) {
+    boundLog = &log;
+}
+
+// Restores the previous binding.
+
+LogBinding::~LogBinding() {
+    boundLog = previous;
+}
+
+// Per-thread line buffer; keeps its capacity, so formatting a line does not allocate.
+
+static string& threadLineBuffer() {
+    static thread_local string text;
+    return text;
+}
+
+// Per-thread copy of an event's ID (the caller's string may be a temporary).
+
+static string& threadNameBuffer() {
+    static thread_local string text;
+    return text;
+}
+
+// Writes one event, as a record or as its formatted line.
+
+void AsyncLog::event(const TraceRecord& record, const string& name) {
+    if (file == nullptr) return;
+
+    if (tracing) {
+        TraceRecord stored = record;
+        stored.name = name.empty() ? -1 : intern(name);
+        write((const char*)&stored, sizeof(stored));
+        return;
+    }
+
+    string& text = threadLineBuffer();
+    text.clear();
+    formatEvent(record, name, text);
+    text += '\n';
+    write(text.data(), text.size());
+}
+
+// Starts an event stamped with the current tick.
+
+LogEvent::LogEvent(AsyncLog& target, EventKind kind) : log(target), record(makeEvent(kind, target.getTick())), nameText(threadNameBuffer()) {
+    nameText.clear();
+}
+
+// Ends the event and hands it to the log.
+
+LogEvent::~LogEvent() {
+    log.event(record, nameText);
+}
+
+LogEvent& LogEvent::name(const string& id) {
+    nameText = id;
+    return *this;
+}
+
+LogEvent& LogEvent::arg(int value) {
+    record.arg = (uint16_t)value;
+    return *this;
+}
+
+LogEvent& LogEvent::at(int x, int y) {
+    record.x = x;
+    record.y = y;
+    return *this;
+}
+
+LogEvent& LogEvent::values(int a, int b, int c) {
+    record.a = a;
+    record.b = b;
+    record.c = c;
+    return *this;
+}
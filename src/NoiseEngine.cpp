@@ -0,0 +1,81 @@
+#include "../include/NoiseEngine.h"
+#include "../include/Random.h"
+
+using namespace std;
+
+// Constructor for the abstract NoiseEngine. Stores the simulation seed.
+
+NoiseEngine::NoiseEngine(uint64_t seedValue) : seed(seedValue) {}
+
+// Virtual destructor for NoiseEngine.
+
+NoiseEngine::~NoiseEngine() {}
+
+// Maps raw samples onto the same discrete noise range the sensors always used.
+
+void NoiseEngine::toConfidenceNoise(const uint64_t* samples, size_t count, double* out) {
+    for (size_t i = 0; i < count; ++i) out[i] = (samples[i] % 100) / 1000.0 - 0.05;
+}
+
+// Constructor for HashNoise.
+
+HashNoise::HashNoise(uint64_t seedValue) : NoiseEngine(seedValue) {}
+
+// Chains mix64 over seed, tick and sensor once per batch, then over each object key.
+
+void HashNoise::generate(uint64_t tick, uint64_t sensorKey, const uint64_t* objectKeys, size_t count, uint64_t* out) const {
+    uint64_t base = mix64(mix64(mix64(seed) ^ tick) ^ sensorKey);
+
+    for (size_t i = 0; i < count; ++i) out[i] = mix64(base ^ objectKeys[i]);
+}
+
+// Constructor for PhiloxNoise.
+
+PhiloxNoise::PhiloxNoise(uint64_t seedValue) : NoiseEngine(seedValue) {}
+
+// Runs the 10 Philox4x32 rounds on one counter block and returns the first 64 output bits.
+
+static uint64_t philox4x32(uint32_t c0, uint32_t c1, uint32_t c2, uint32_t c3, uint32_t k0, uint32_t k1) {
+    const uint32_t M0 = 0xD2511F53u;
+    const uint32_t M1 = 0xCD9E8D57u;
+    const uint32_t W0 = 0x9E3779B9u;
+    const uint32_t W1 = 0xBB67AE85u;
+
+    for (int round = 0; round < 10; ++round) {
+        uint64_t p0 = (uint64_t)M0 * c0;
+        uint64_t p1 = (uint64_t)M1 * c2;
+
+        uint32_t n0 = (uint32_t)(p1 >> 32) ^ c1 ^ k0;
+        uint32_t n1 = (uint32_t)p1;
+        uint32_t n2 = (uint32_t)(p0 >> 32) ^ c3 ^ k1;
+        uint32_t n3 = (uint32_t)p0;
+
+        c0 = n0;
+        c1 = n1;
+        c2 = n2;
+        c3 = n3;
+        k0 += W0;
+        k1 += W1;
+    }
+    return ((uint64_t)c1 << 32) | c0;
+}
+
+// Counter = (object key, tick), key = seed mixed with the sensor key.
+
+void PhiloxNoise::generate(uint64_t tick, uint64_t sensorKey, const uint64_t* objectKeys, size_t count, uint64_t* out) const {
+    uint64_t key = mix64(seed) ^ sensorKey;
+    uint32_t k0 = (uint32_t)key;
+    uint32_t k1 = (uint32_t)(key >> 32);
+
+    for (size_t i = 0; i < count; ++i) {
+        uint64_t obj = objectKeys[i];
+        out[i] = philox4x32((uint32_t)obj, (uint32_t)(obj >> 32), (uint32_t)tick, (uint32_t)(tick >> 32), k0, k1);
+    }
+}
+
+// Factory for the configured noise model.
+
+NoiseEngine* createNoiseEngine(NoiseModel model, uint64_t seedValue) {
+    if (model == NOISE_PHILOX) return new PhiloxNoise(seedValue);
+    return new HashNoise(seedValue);
+}
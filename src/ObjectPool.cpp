@@ -0,0 +1,29 @@
+#include "../include/ObjectPool.h"
+
+using namespace std;
+
+// Hands the object back to the pool of its kind. Lights are found by any of their colors.
+
+void WorldObjectPool::destroy(WorldObjects* obj) {
+    switch (obj->getGlyph()) {
+        case 'C': cars.destroy(static_cast<Car*>(obj)); break;
+        case 'B': bikes.destroy(static_cast<Bike*>(obj)); break;
+        case 'P': parked.destroy(static_cast<StationaryVehicles*>(obj)); break;
+        case 'S': signs.destroy(static_cast<TrafficSign*>(obj)); break;
+        default: lights.destroy(static_cast<TrafficLight*>(obj)); break;
+    }
+}
+
+// Objects alive over all pools.
+
+size_t WorldObjectPool::getLive() const {
+    return lights.getLive() + signs.getLive() + parked.getLive() + cars.getLive() + bikes.getLive();
+}
+
+size_t WorldObjectPool::getCapacity() const {
+    return lights.getCapacity() + signs.getCapacity() + parked.getCapacity() + cars.getCapacity() + bikes.getCapacity();
+}
+
+size_t WorldObjectPool::getChunks() const {
+    return lights.getChunks() + signs.getChunks() + parked.getChunks() + cars.getChunks() + bikes.getChunks();
+}
@@ -0,0 +1,394 @@
+#include <cstdio>
+#include <cstdlib>
+#include <atomic>
+#include <new>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+
+#include "../include/Profiler.h"
+
+using namespace std;
+
+// Global profiler, enabled by --profile.
+
+Profiler simProfiler;
+
+// Allocation counter behind the replaced global operator new. It always counts,
+// so the benchmarks can use it as well; one relaxed add per allocation.
+// Every form of new and delete is replaced (plain, array, nothrow, sized and
+// over-aligned), so memory never passes between the replacements and the
+// runtime's own operators (std::stable_sort, for one, allocates with nothrow).
+
+static atomic<uint64_t> allocations(0);
+
+// Counts and allocates; nullptr when out of memory.
+
+static void* countedAlloc(size_t size) {
+    allocations.fetch_add(1, memory_order_relaxed);
+    return malloc(size > 0 ? size : 1);
+}
+
+// Same for over-aligned types; aligned_alloc wants the size rounded up to the alignment.
+
+static void* countedAlignedAlloc(size_t size, align_val_t align) {
+    allocations.fetch_add(1, memory_order_relaxed);
+
+    size_t alignment = (size_t)align;
+    size_t rounded = (size > 0 ? size + alignment - 1 : alignment) / alignment * alignment;
+    return aligned_alloc(alignment, rounded);
+}
+
+void* operator new(size_t size) {
+    void* p = countedAlloc(size);
+    if (p == nullptr) throw bad_alloc();
+    return p;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void* operator new(size_t size, const nothrow_t&) noexcept {
+    return countedAlloc(size);
+}
+
+void* operator new[](size_t size, const nothrow_t&) noexcept {
+    return countedAlloc(size);
+}
+
+void* operator new(size_t size, align_val_t align) {
+    void* p = countedAlignedAlloc(size, align);
+    if (p == nullptr) throw bad_alloc();
+    return p;
+}
+
+void* operator new[](size_t size, align_val_t align) {
+    return operator new(size, align);
+}
+
+void* operator new(size_t size, align_val_t align, const nothrow_t&) noexcept {
+    return countedAlignedAlloc(size, align);
+}
+
+void* operator new[](size_t size, align_val_t align, const nothrow_t&) noexcept {
+    return countedAlignedAlloc(size, align);
+}
+
+// malloc and aligned_alloc memory are both released with free(), so every delete is the same
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, const nothrow_t&) noexcept {
+    free(p);
+}
+
+void operator delete[](void* p, const nothrow_t&) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, align_val_t) noexcept {
+    free(p);
+}
+
+void operator delete[](void* p, align_val_t) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t, align_val_t) noexcept {
+    free(p);
+}
+
+void operator delete[](void* p, size_t, align_val_t) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, align_val_t, const nothrow_t&) noexcept {
+    free(p);
+}
+
+void operator delete[](void* p, align_val_t, const nothrow_t&) noexcept {
+    free(p);
+}
+
+uint64_t allocationCount() {
+    return allocations.load(memory_order_relaxed);
+}
+
+// Names of the phases and counters, as printed and used as CSV columns.
+
+const char* profilePhaseName(ProfilePhase phase) {
+    static const char* const names[] = {"tick", "world", "lidar", "radar", "camera", "sensors", "fuse", "plan", "move", "render"};
+    return names[phase];
+}
+
+const char* profileCounterName(ProfileCounter counter) {
+    static const char* const names[] = {"objects_scanned", "readings_produced", "readings_fused", "allocations"};
+    return names[counter];
+}
+
+// Histogram bucket of a duration: b holds durations in [2^b, 2^(b+1)) ns.
+
+static int bucketOf(int64_t nanos) {
+    int bucket = 0;
+    while (nanos > 1 && bucket < Profiler::BUCKETS - 1) {
+        nanos >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+// The calling thread's buffer (owned by simProfiler)
+
+static thread_local void* threadBuffer = nullptr;
+
+Profiler::ThreadBuffer::ThreadBuffer(int index) : thread(index) {
+    reset();
+}
+
+void Profiler::ThreadBuffer::reset() {
+    for (int p = 0; p < PHASE_COUNT; ++p) {
+        phaseNanos[p] = 0;
+        phaseCalls[p] = 0;
+        maxNanos[p] = 0;
+        for (int b = 0; b < BUCKETS; ++b) histogram[p][b] = 0;
+    }
+
+    for (int c = 0; c < COUNTER_COUNT; ++c) counters[c] = 0;
+    spans.clear();
+}
+
+// Constructor; the profiler starts disabled.
+
+Profiler::Profiler() : enabled(false), keepRows(false), keepSpans(false), origin(chrono::steady_clock::now()), allocationsAtTick(0), ticks(0) {
+    for (int p = 0; p < PHASE_COUNT; ++p) {
+        totalNanos[p] = 0;
+        totalCalls[p] = 0;
+        maxNanos[p] = 0;
+        for (int b = 0; b < BUCKETS; ++b) histogram[p][b] = 0;
+    }
+
+    for (int c = 0; c < COUNTER_COUNT; ++c) totalCounters[c] = 0;
+}
+
+Profiler::~Profiler() {
+    for (size_t i = 0; i < buffers.size(); ++i) delete buffers[i];
+}
+
+// Starts profiling; times are measured from here. The trace needs the rows for
+// its counter events.
+
+void Profiler::enable(bool rows, bool spans) {
+    keepRows = rows || spans;
+    keepSpans = spans;
+    origin = chrono::steady_clock::now();
+    allocationsAtTick = allocationCount();
+    enabled = true;
+
+    bufferForThread();
+}
+
+// Threads get a buffer on their first timed call; the thread that called enable()
+// (the tick thread) is thread 0.
+
+Profiler::ThreadBuffer* Profiler::bufferForThread() {
+    ThreadBuffer* buffer = static_cast<ThreadBuffer*>(threadBuffer);
+    if (buffer != nullptr) return buffer;
+
+    lock_guard<mutex> guard(lock);
+    buffer = new ThreadBuffer((int)buffers.size());
+    buffers.push_back(buffer);
+    threadBuffer = buffer;
+    return buffer;
+}
+
+void Profiler::record(ProfilePhase phase, int64_t start, int64_t duration) {
+    ThreadBuffer* buffer = bufferForThread();
+
+    buffer->phaseNanos[phase] += duration;
+    buffer->phaseCalls[phase]++;
+    buffer->histogram[phase][bucketOf(duration)]++;
+    if (duration > buffer->maxNanos[phase]) buffer->maxNanos[phase] = duration;
+
+    if (keepSpans) buffer->spans.push_back({phase, buffer->thread, 0, start, duration});
+}
+
+void Profiler::count(ProfileCounter counter, uint64_t amount) {
+    bufferForThread()->counters[counter] += amount;
+}
+
+// Only called from the tick thread between ticks; the lock keeps out threads
+// that are registering a buffer.
+
+void Profiler::endTick(int tick) {
+    if (!enabled) return;
+
+    TickRow row;
+    row.tick = tick;
+    for (int p = 0; p < PHASE_COUNT; ++p) row.phaseNanos[p] = 0;
+    for (int c = 0; c < COUNTER_COUNT; ++c) row.counters[c] = 0;
+
+    uint64_t allocated = allocationCount();
+    row.counters[COUNTER_ALLOCATIONS] = allocated - allocationsAtTick;
+    allocationsAtTick = allocated;
+
+    lock_guard<mutex> guard(lock);
+
+    for (size_t i = 0; i < buffers.size(); ++i) {
+        ThreadBuffer* buffer = buffers[i];
+
+        for (int p = 0; p < PHASE_COUNT; ++p) {
+            row.phaseNanos[p] += buffer->phaseNanos[p];
+            totalCalls[p] += buffer->phaseCalls[p];
+            if (buffer->maxNanos[p] > maxNanos[p]) maxNanos[p] = buffer->maxNanos[p];
+            for (int b = 0; b < BUCKETS; ++b) histogram[p][b] += buffer->histogram[p][b];
+        }
+
+        for (int c = 0; c < COUNTER_COUNT; ++c) row.counters[c] += buffer->counters[c];
+
+        for (size_t s = 0; s < buffer->spans.size(); ++s) {
+            spans.push_back(buffer->spans[s]);
+            spans.back().tick = tick;
+        }
+
+        buffer->reset();
+    }
+
+    for (int p = 0; p < PHASE_COUNT; ++p) totalNanos[p] += row.phaseNanos[p];
+    for (int c = 0; c < COUNTER_COUNT; ++c) totalCounters[c] += row.counters[c];
+
+    if (keepRows) rows.push_back(row);
+    ticks++;
+}
+
+int Profiler::getTicks() const {
+    return ticks;
+}
+
+// Per phase: calls, total time, share of the profiled time (tick plus render),
+// mean and maximum per call. Then the counters per tick and a histogram of the
+// tick durations, one row per power of two.
+
+void Profiler::printReport() const {
+    ios::fmtflags flags = cout.flags();
+    streamsize precision = cout.precision();
+
+    double profiled = (double)(totalNanos[PHASE_TICK] + totalNanos[PHASE_RENDER]);
+
+    cout << "Profile of " << ticks << " ticks (" << fixed << setprecision(3) << profiled / 1e6 << " ms in ticks and rendering):" << endl;
+    cout << left << setw(8) << "phase" << right << setw(10) << "calls" << setw(13) << "total ms" << setw(9) << "share"
+         << setw(12) << "mean us" << setw(12) << "max us" << endl;
+
+    for (int p = 0; p < PHASE_COUNT; ++p) {
+        if (totalCalls[p] == 0) continue;
+
+        double share = profiled > 0.0 ? 100.0 * totalNanos[p] / profiled : 0.0;
+
+        cout << left << setw(8) << profilePhaseName((ProfilePhase)p) << right << setw(10) << totalCalls[p]
+             << setw(13) << setprecision(3) << totalNanos[p] / 1e6
+             << setw(8) << setprecision(1) << share << "%"
+             << setw(12) << setprecision(2) << (double)totalNanos[p] / totalCalls[p] / 1e3
+             << setw(12) << maxNanos[p] / 1e3 << endl;
+    }
+
+    cout << "Counters:";
+    for (int c = 0; c < COUNTER_COUNT; ++c) {
+        cout << (c > 0 ? "," : "") << " " << profileCounterName((ProfileCounter)c) << " " << totalCounters[c];
+        if (ticks > 0) cout << " (" << setprecision(1) << (double)totalCounters[c] / ticks << "/tick)";
+    }
+    cout << endl;
+
+    int first = BUCKETS, last = -1;
+    uint64_t peak = 0;
+
+    for (int b = 0; b < BUCKETS; ++b) {
+        if (histogram[PHASE_TICK][b] == 0) continue;
+        if (b < first) first = b;
+        last = b;
+        if (histogram[PHASE_TICK][b] > peak) peak = histogram[PHASE_TICK][b];
+    }
+
+    if (last >= 0) cout << "Tick time histogram (us):" << endl;
+
+    for (int b = first; b <= last; ++b) {
+        uint64_t n = histogram[PHASE_TICK][b];
+        int bar = (int)((n * 40 + peak - 1) / peak);
+
+        cout << setw(12) << setprecision(3) << (double)((int64_t)1 << b) / 1e3 << " - " << left << setw(12)
+             << (double)((int64_t)1 << (b + 1)) / 1e3 << right << "|" << string(bar, '#') << " " << n << endl;
+    }
+
+    cout.flags(flags);
+    cout.precision(precision);
+}
+
+bool Profiler::writeCsv(const string& path) const {
+    ofstream out(path.c_str());
+    if (!out) return false;
+
+    out << "tick";
+    for (int p = 0; p < PHASE_COUNT; ++p) out << "," << profilePhaseName((ProfilePhase)p) << "_us";
+    for (int c = 0; c < COUNTER_COUNT; ++c) out << "," << profileCounterName((ProfileCounter)c);
+    out << "\n" << fixed << setprecision(3);
+
+    for (size_t i = 0; i < rows.size(); ++i) {
+        out << rows[i].tick;
+        for (int p = 0; p < PHASE_COUNT; ++p) out << "," << rows[i].phaseNanos[p] / 1e3;
+        for (int c = 0; c < COUNTER_COUNT; ++c) out << "," << rows[i].counters[c];
+        out << "\n";
+    }
+
+    return (bool)out;
+}
+
+// Timestamps are microseconds since enable(); each thread is one track.
+// The counters of a tick are placed at the end of its last span.
+
+bool Profiler::writeChromeTrace(const string& path) const {
+    ofstream out(path.c_str());
+    if (!out) return false;
+
+    out << fixed << setprecision(3);
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+    out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"avs\"}}";
+
+    for (size_t i = 0; i < buffers.size(); ++i) {
+        out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << i << ",\"args\":{\"name\":\""
+            << (i == 0 ? "tick" : "worker " + to_string(i)) << "\"}}";
+    }
+
+    size_t next = 0;
+
+    for (size_t r = 0; r < rows.size(); ++r) {
+        int64_t end = 0;
+
+        for (; next < spans.size() && spans[next].tick == rows[r].tick; ++next) {
+            const Span& s = spans[next];
+            out << ",\n{\"name\":\"" << profilePhaseName((ProfilePhase)s.phase) << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << s.thread
+                << ",\"ts\":" << s.start / 1e3 << ",\"dur\":" << s.duration / 1e3 << ",\"args\":{\"tick\":" << s.tick << "}}";
+            if (s.start + s.duration > end) end = s.start + s.duration;
+        }
+
+        out << ",\n{\"name\":\"counters\",\"ph\":\"C\",\"pid\":1,\"tid\":0,\"ts\":" << end / 1e3 << ",\"args\":{";
+        for (int c = 0; c < COUNTER_COUNT; ++c)
+            out << (c > 0 ? "," : "") << "\"" << profileCounterName((ProfileCounter)c) << "\":" << rows[r].counters[c];
+        out << "}}";
+    }
+
+    out << "\n]}\n";
+    return (bool)out;
+}
@@ -0,0 +1,200 @@
+#include <iostream>
+#include <cstring>
+
+#include "../include/Renderer.h"
+#include "../include/GridWorld.h"
+#include "../include/VehicleSystem.h"
+#include "../include/WorldObjects.h"
+
+using namespace std;
+
+// Glyphs from lowest to highest display priority. '?' stands for glyphs the table does not know.
+
+static const char GLYPH_ORDER[] = "?PGCBSYR@";
+
+// Radius of the POV view
+
+static const int POV_RADIUS = 5;
+
+// Constructor. Builds the priority table and an empty framebuffer (none when nothing is drawn).
+
+Renderer::Renderer(int dimX, int dimY, RenderMode renderMode, int renderEvery) : mode(renderMode), every(renderEvery > 0 ? renderEvery : 1), width(dimX), height(dimY), screenDrawn(false) {
+    if (mode != RENDER_NONE) cells.assign((size_t)width * height, '.');
+    if (mode == RENDER_ANSI) shown.assign((size_t)width * height, '.');
+
+    memset(priority, 0, sizeof(priority));
+
+    for (int i = 0; GLYPH_ORDER[i] != '\0'; ++i)
+        priority[(unsigned char)GLYPH_ORDER[i]] = (unsigned char)(i + 1);
+}
+
+// Draws a glyph into a cell unless the cell already shows one of higher priority.
+
+void Renderer::paint(int x, int y, char glyph) {
+    if (x < 0 || x >= width || y < 0 || y >= height) return;
+
+    if (priority[(unsigned char)glyph] == 0) glyph = '?';
+
+    char& cell = cells[(size_t)y * width + x];
+
+    if (cell == '.') painted.push_back(y * width + x);
+    if (priority[(unsigned char)glyph] > priority[(unsigned char)cell]) cell = glyph;
+}
+
+// Clears the cells of the previous frame, then paints every object and car once.
+
+void Renderer::rasterize(GridWorld& world) {
+    for (size_t i = 0; i < painted.size(); ++i) cells[painted[i]] = '.';
+    painted.clear();
+
+    const vector<WorldObjects*>& objects = world.getObjects();
+
+    for (size_t i = 0; i < objects.size(); ++i) {
+        Position pos = objects[i]->getPosition();
+        paint(pos.x, pos.y, objects[i]->getGlyph());
+    }
+
+    const vector<SelfDrivingCar*>& fleet = world.getFleet();
+
+    for (size_t i = 0; i < fleet.size(); ++i) {
+        Position pos = fleet[i]->getPosition();
+        paint(pos.x, pos.y, '@');
+    }
+}
+
+// Appends one map row (glyphs separated by spaces); cells outside the grid show as X.
+
+void Renderer::appendRow(int y, int fromX, int toX) {
+    bool rowInside = (y >= 0 && y < height);
+
+    for (int x = fromX; x <= toX; ++x) {
+        if (rowInside && x >= 0 && x < width) frame += cells[(size_t)y * width + x];
+        else frame += 'X';
+        frame += ' ';
+    }
+    frame += '\n';
+}
+
+// Appends the full map with its header and footer lines.
+
+void Renderer::appendFullMap(int tick) {
+    frame += "--- FULL MAP (Tick: ";
+    frame += to_string(tick);
+    frame += ") ---\n";
+
+    for (int y = height - 1; y >= 0; --y) appendRow(y, 0, width - 1);
+
+    frame += "-----------------------------------\n";
+}
+
+// Writes the assembled frame in one call.
+
+void Renderer::flush() {
+    cout.write(frame.data(), frame.size());
+    cout.flush();
+}
+
+// Prints the entire grid, top row first.
+
+void Renderer::showFull(GridWorld& world) {
+    rasterize(world);
+
+    frame.clear();
+    appendFullMap(world.getTicks());
+    flush();
+}
+
+// Prints the square of cells around the car.
+
+void Renderer::showPov(GridWorld& world, int radius) {
+    SelfDrivingCar* car = world.getCar();
+    if (car == nullptr) return;
+
+    rasterize(world);
+
+    Position carPos = car->getPosition();
+
+    frame.clear();
+    frame += "--- POV MAP (Radius: ";
+    frame += to_string(radius);
+    frame += ") ---\n";
+
+    for (int y = carPos.y + radius; y >= carPos.y - radius; --y) appendRow(y, carPos.x - radius, carPos.x + radius);
+
+    frame += "-----------------------------------\n";
+    flush();
+}
+
+// The first ANSI frame clears the screen and prints the map like showFull. Later
+// frames rewrite the tick in the header and move the cursor only to cells whose
+// glyph changed; those can only be cells painted in this frame or the one before.
+// The cursor is left below the map, so other output appears underneath.
+
+void Renderer::showAnsi(GridWorld& world) {
+    previous.assign(painted.begin(), painted.end());
+    rasterize(world);
+
+    frame.clear();
+
+    if (!screenDrawn) {
+        frame += "\x1b[2J\x1b[H";
+        appendFullMap(world.getTicks());
+        shown = cells;
+        screenDrawn = true;
+        flush();
+        return;
+    }
+
+    frame += "\x1b[1;1H--- FULL MAP (Tick: ";
+    frame += to_string(world.getTicks());
+    frame += ") ---\x1b[K";
+
+    const vector<int>* lists[2] = {&previous, &painted};
+
+    for (int l = 0; l < 2; ++l) {
+        const vector<int>& list = *lists[l];
+
+        for (size_t i = 0; i < list.size(); ++i) {
+            int cell = list[i];
+            if (cells[cell] == shown[cell]) continue;
+
+            shown[cell] = cells[cell];
+
+            frame += "\x1b[";
+            frame += to_string(2 + (height - 1 - cell / width));
+            frame += ';';
+            frame += to_string(2 * (cell % width) + 1);
+            frame += 'H';
+            frame += cells[cell];
+        }
+    }
+
+    frame += "\x1b[";
+    frame += to_string(height + 3);
+    frame += ";1H";
+    flush();
+}
+
+// Map before the first tick.
+
+void Renderer::showStart(GridWorld& world) {
+    if (mode == RENDER_POV || mode == RENDER_FULL) showFull(world);
+    else if (mode == RENDER_ANSI) showAnsi(world);
+}
+
+// Map after a tick, every n-th tick only.
+
+void Renderer::showTick(GridWorld& world) {
+    if (mode == RENDER_NONE || world.getTicks() % every != 0) return;
+
+    if (mode == RENDER_POV) showPov(world, POV_RADIUS);
+    else if (mode == RENDER_FULL) showFull(world);
+    else showAnsi(world);
+}
+
+// Map after the last tick.
+
+void Renderer::showEnd(GridWorld& world) {
+    if (mode == RENDER_POV || mode == RENDER_FULL) showFull(world);
+    else if (mode == RENDER_ANSI) showAnsi(world);
+}
@@ -0,0 +1,381 @@
+#include <cstdlib>
+#include <algorithm>
+
+#include "../include/RoutePlanner.h"
+
+using namespace std;
+
+// Step and turn costs. A turn costs a tenth of a step, so it only breaks ties
+// between paths of equal length and never makes a path longer by a full step
+// unless that saves more than ten turns.
+
+static const int STEP_COST = 10;
+static const int TURN_COST = 1;
+
+// Cell offsets for NORTH, SOUTH, EAST, WEST (same convention as MovingObject::move)
+
+static const int DIR_X[4] = {0, 0, 1, -1};
+static const int DIR_Y[4] = {1, -1, 0, 0};
+
+// Heading of a single step between two neighbouring cells.
+
+static Direction stepDirection(Position from, Position to) {
+    if (to.y > from.y) return NORTH;
+    if (to.y < from.y) return SOUTH;
+    if (to.x > from.x) return EAST;
+    return WEST;
+}
+
+static int manhattan(Position a, Position b) {
+    return abs(a.x - b.x) + abs(a.y - b.y);
+}
+
+// Expansion budget for a search between two cells. Generous enough for detours
+// around clusters of blockers, small enough that an unreachable target does not
+// flood a 2000x2000 grid.
+
+static int searchBudget(Position from, Position to) {
+    return 64 * (manhattan(from, to) + 8) + 4096;
+}
+
+// Node table slots sized up front, at most (a power of two; 6 MB per thread).
+// Searches on huge grids that reach more nodes than half of it grow the table.
+
+static const size_t MAX_PRESIZED_SLOTS = (size_t)1 << 18;
+
+// Constructor. The planner starts without any known blockers.
+
+RoutePlanner::RoutePlanner(int dimX, int dimY) : width(dimX), height(dimY), cursor(0), scratch(nullptr) {
+    size_t cells = (width > 0 && height > 0) ? (size_t)width * height : 0;
+    blocked.assign((cells + 63) / 64, 0);
+
+    // Room for a path across the grid and back, detours included, so routes
+    // rarely grow a buffer
+
+    size_t span = 2 * (size_t)(max(width, 0) + max(height, 0));
+    path.reserve(span);
+    spliced.reserve(span);
+    detour.reserve(span);
+}
+
+// Checks if a cell lies on the grid.
+
+bool RoutePlanner::inBounds(int x, int y) const {
+    return x >= 0 && x < width && y >= 0 && y < height;
+}
+
+// Adds a sensed static object to the blocker set.
+
+bool RoutePlanner::addBlocker(Position p) {
+    if (!inBounds(p.x, p.y)) return false;
+
+    size_t cell = (size_t)p.y * width + p.x;
+    uint64_t bit = (uint64_t)1 << (cell % 64);
+    if (blocked[cell / 64] & bit) return false;
+
+    blocked[cell / 64] |= bit;
+    return true;
+}
+
+// Checks if a cell holds a known static object.
+
+bool RoutePlanner::isBlocked(int x, int y) const {
+    size_t cell = (size_t)y * width + x;
+    return (blocked[cell / 64] >> (cell % 64)) & 1;
+}
+
+// Home slot of a state in a table of 'mask' + 1 slots (Fibonacci hashing).
+
+static size_t homeSlot(long long state, size_t mask) {
+    return (size_t)(((uint64_t)state * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+}
+
+// Probes from the state's home slot to the state or the first slot not used by
+// the current search.
+
+RoutePlanner::Node* RoutePlanner::findNode(long long state) {
+    vector<NodeSlot>& nodes = scratch->nodes;
+    size_t mask = nodes.size() - 1;
+
+    for (size_t i = homeSlot(state, mask);; i = (i + 1) & mask) {
+        NodeSlot& slot = nodes[i];
+        if (slot.generation != scratch->generation) return nullptr;
+        if (slot.state == state) return &slot.node;
+    }
+}
+
+// Doubles the table first if it is half full, moving over the current search's nodes.
+
+RoutePlanner::Node& RoutePlanner::insertNode(long long state) {
+    vector<NodeSlot>& nodes = scratch->nodes;
+    uint32_t generation = scratch->generation;
+
+    if (2 * (scratch->nodeCount + 1) > nodes.size()) {
+        vector<NodeSlot> old(nodes.size() * 2, NodeSlot{0, 0, {0, -1}});
+        old.swap(nodes);
+        size_t mask = nodes.size() - 1;
+
+        for (size_t k = 0; k < old.size(); ++k) {
+            if (old[k].generation != generation) continue;
+
+            size_t i = homeSlot(old[k].state, mask);
+            while (nodes[i].generation == generation) i = (i + 1) & mask;
+            nodes[i] = old[k];
+        }
+    }
+
+    size_t mask = nodes.size() - 1;
+
+    for (size_t i = homeSlot(state, mask);; i = (i + 1) & mask) {
+        NodeSlot& slot = nodes[i];
+
+        if (slot.generation != generation) {
+            slot.state = state;
+            slot.generation = generation;
+            slot.node = {0, -1};
+            scratch->nodeCount++;
+            return slot.node;
+        }
+
+        if (slot.state == state) return slot.node;
+    }
+}
+
+// One scratch per thread, created on the thread's first search.
+
+RoutePlanner::SearchScratch& RoutePlanner::threadScratch() {
+    static thread_local SearchScratch threadLocal = {{}, 0, 1, {}};
+    return threadLocal;
+}
+
+// Takes the thread's scratch, sizes it for this grid's largest search, and bumps
+// the generation; on wrap-around every slot is marked stale explicitly.
+
+void RoutePlanner::resetNodes() {
+    scratch = &threadScratch();
+
+    size_t wanted = maxSearchNodes();
+    size_t slots = 64;
+    while (slots < 2 * wanted && slots < MAX_PRESIZED_SLOTS) slots *= 2;
+
+    if (scratch->nodes.size() < slots) {
+        scratch->nodes.assign(slots, NodeSlot{0, 0, {0, -1}});
+        scratch->generation = 1;
+    }
+    if (scratch->open.capacity() < slots / 2) scratch->open.reserve(slots / 2);
+
+    scratch->nodeCount = 0;
+
+    if (++scratch->generation == 0) {
+        for (size_t i = 0; i < scratch->nodes.size(); ++i) scratch->nodes[i].generation = 0;
+        scratch->generation = 1;
+    }
+}
+
+// Each expansion reaches at most four new states.
+
+size_t RoutePlanner::maxSearchNodes() const {
+    size_t states = 4 * (size_t)max(width, 0) * max(height, 0);
+    size_t reachable = 4 * (size_t)searchBudget({0, 0}, {width - 1, height - 1}) + 1;
+    return min(states, reachable);
+}
+
+// Orders the open list as a min-heap on f, preferring deeper nodes (larger g) on
+// ties so straight-line searches head for the goal; the state key makes it total.
+
+bool RoutePlanner::worseEntry(const OpenEntry& a, const OpenEntry& b) {
+    if (a.f != b.f) return a.f > b.f;
+    if (a.g != b.g) return a.g < b.g;
+    return a.state > b.state;
+}
+
+// A* over (cell, heading) states with a Manhattan heuristic.
+// Writes the cells from 'from' to 'to' (both included) into out.
+
+bool RoutePlanner::search(Position from, Direction heading, Position to, int budget, vector<Position>& out) {
+    out.clear();
+    if (!inBounds(from.x, from.y) || !inBounds(to.x, to.y) || isBlocked(to.x, to.y)) return false;
+
+    resetNodes();
+    vector<OpenEntry>& open = scratch->open;
+    open.clear();
+
+    long long start = ((long long)from.y * width + from.x) * 4 + heading;
+    insertNode(start) = {0, -1};
+    open.push_back({STEP_COST * manhattan(from, to), 0, start});
+
+    long long goal = -1;
+    int expansions = 0;
+
+    while (!open.empty() && expansions < budget) {
+        pop_heap(open.begin(), open.end(), worseEntry);
+        OpenEntry current = open.back();
+        open.pop_back();
+
+        if (current.g > findNode(current.state)->g) continue;
+
+        long long cell = current.state / 4;
+        int dir = (int)(current.state % 4);
+        int x = (int)(cell % width);
+        int y = (int)(cell / width);
+
+        if (x == to.x && y == to.y) {
+            goal = current.state;
+            break;
+        }
+        expansions++;
+
+        for (int d = 0; d < 4; ++d) {
+            int nx = x + DIR_X[d];
+            int ny = y + DIR_Y[d];
+            if (!inBounds(nx, ny) || isBlocked(nx, ny)) continue;
+
+            int g = current.g + STEP_COST + (d != dir ? TURN_COST : 0);
+            long long next = ((long long)ny * width + nx) * 4 + d;
+
+            Node* known = findNode(next);
+            if (known != nullptr && known->g <= g) continue;
+
+            if (known != nullptr) *known = {g, current.state};
+            else insertNode(next) = {g, current.state};
+            open.push_back({g + STEP_COST * (abs(nx - to.x) + abs(ny - to.y)), g, next});
+            push_heap(open.begin(), open.end(), worseEntry);
+        }
+    }
+
+    if (goal < 0) return false;
+
+    for (long long state = goal; state >= 0; state = findNode(state)->parent) {
+        long long cell = state / 4;
+        out.push_back({(int)(cell % width), (int)(cell / width)});
+    }
+    reverse(out.begin(), out.end());
+    return true;
+}
+
+// Plans a fresh path and resets the cursor to its start.
+
+bool RoutePlanner::plan(Position from, Direction heading, Position to) {
+    cursor = 0;
+    return search(from, heading, to, searchBudget(from, to), path);
+}
+
+// Scans the remaining path for known blockers.
+
+bool RoutePlanner::isPathBlocked() const {
+    for (size_t i = cursor + 1; i < path.size(); ++i)
+        if (isBlocked(path[i].x, path[i].y)) return true;
+    return false;
+}
+
+// Local repair: for each blocked stretch ahead, search from the last free cell
+// before it to the first free cell after it and splice the detour into the path.
+// The rest of the cached path is kept. Falls back to a full plan if a detour
+// cannot be found within its budget.
+
+bool RoutePlanner::repair(Position from, Direction heading) {
+    if (path.empty()) return false;
+    Position target = path.back();
+
+    size_t i = cursor + 1;
+
+    while (i < path.size()) {
+        if (!isBlocked(path[i].x, path[i].y)) {
+            i++;
+            continue;
+        }
+
+        size_t before = i - 1;
+        size_t after = i + 1;
+        while (after < path.size() && isBlocked(path[after].x, path[after].y)) after++;
+
+        if (after >= path.size()) {
+            path.clear();
+            return false;
+        }
+
+        Direction arrive = (before > cursor) ? stepDirection(path[before - 1], path[before]) : heading;
+
+        if (!search(path[before], arrive, path[after], searchBudget(path[before], path[after]), detour))
+            return plan(from, heading, target);
+
+        // detour runs from path[before] to path[after], both included
+
+        spliced.clear();
+        spliced.insert(spliced.end(), path.begin(), path.begin() + before);
+        spliced.insert(spliced.end(), detour.begin(), detour.end());
+        spliced.insert(spliced.end(), path.begin() + after + 1, path.end());
+        path.swap(spliced);
+
+        i = before + detour.size();
+    }
+    return true;
+}
+
+// Finds the car on the path (it moves at most two cells per tick) and reports
+// the heading of the next step and the length of the straight run ahead.
+
+bool RoutePlanner::follow(Position at, Direction& dir, int& runLength) {
+    bool found = false;
+
+    for (size_t k = cursor; k < path.size() && k <= cursor + 2; ++k) {
+        if (path[k].x == at.x && path[k].y == at.y) {
+            cursor = k;
+            found = true;
+            break;
+        }
+    }
+
+    if (!found || cursor + 1 >= path.size()) return false;
+
+    dir = stepDirection(path[cursor], path[cursor + 1]);
+    runLength = 1;
+
+    while (runLength < 2 && cursor + runLength + 1 < path.size() &&
+           stepDirection(path[cursor + runLength], path[cursor + runLength + 1]) == dir)
+        runLength++;
+
+    return true;
+}
+
+// Accessor for the number of steps on the cached path.
+
+int RoutePlanner::getPathLength() const {
+    return path.empty() ? -1 : (int)path.size() - 1;
+}
+
+// Drops the cached path (e.g. when no route to the target exists).
+
+void RoutePlanner::clearPath() {
+    path.clear();
+    cursor = 0;
+}
+
+// Copies the planner's state out for a snapshot. Blockers come out in cell order, so equal
+// states always give equal bytes.
+
+void RoutePlanner::saveState(vector<int>& blockedCells, vector<Position>& pathCells, int& pathCursor) const {
+    blockedCells.clear();
+
+    for (size_t w = 0; w < blocked.size(); ++w) {
+        for (uint64_t bits = blocked[w]; bits != 0; bits &= bits - 1)
+            blockedCells.push_back((int)(w * 64 + __builtin_ctzll(bits)));
+    }
+
+    pathCells = path;
+    pathCursor = (int)cursor;
+}
+
+// Replaces the planner's state with one taken from a snapshot.
+
+void RoutePlanner::restoreState(const vector<int>& blockedCells, const vector<Position>& pathCells, int pathCursor) {
+    fill(blocked.begin(), blocked.end(), 0);
+
+    for (size_t i = 0; i < blockedCells.size(); ++i) {
+        int cell = blockedCells[i];
+        if (cell >= 0 && (size_t)cell / 64 < blocked.size()) blocked[cell / 64] |= (uint64_t)1 << (cell % 64);
+    }
+
+    path = pathCells;
+    cursor = (pathCursor >= 0 && pathCursor < (int)path.size()) ? (size_t)pathCursor : 0;
+}
@@ -0,0 +1,455 @@
+#include <cstdlib>
+#include <cstring>
+
+#include "../include/SensorKernels.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define AVS_X86_KERNELS 1
+#include <immintrin.h>
+#else
+#define AVS_X86_KERNELS 0
+#endif
+
+using namespace std;
+
+// Unit step of a heading: NORTH is +y, EAST is +x.
+
+static void headingStep(Direction dir, int& fx, int& fy) {
+    fx = 0;
+    fy = 0;
+
+    switch (dir) {
+        case NORTH: fy = 1; break;
+        case SOUTH: fy = -1; break;
+        case EAST: fx = 1; break;
+        case WEST: fx = -1; break;
+    }
+}
+
+// Maps the corners of the footprint to world offsets (dx = ahead*fx + side*fy,
+// dy = ahead*fy - side*fx) and takes their bounds.
+
+void footprintBox(const SensorFootprint& footprint, Position origin, Direction dir, int& minX, int& minY, int& maxX, int& maxY) {
+    int fx, fy;
+    headingStep(dir, fx, fy);
+
+    int aheads[2] = {footprint.minAhead, footprint.maxAhead};
+    int sides[2] = {footprint.minSide, footprint.maxSide};
+
+    minX = minY = 0;
+    maxX = maxY = 0;
+
+    for (int a = 0; a < 2; ++a) {
+        for (int s = 0; s < 2; ++s) {
+            int dx = aheads[a] * fx + sides[s] * fy;
+            int dy = aheads[a] * fy - sides[s] * fx;
+
+            if ((a == 0 && s == 0) || dx < minX) minX = dx;
+            if ((a == 0 && s == 0) || dx > maxX) maxX = dx;
+            if ((a == 0 && s == 0) || dy < minY) minY = dy;
+            if ((a == 0 && s == 0) || dy > maxY) maxY = dy;
+        }
+    }
+
+    minX += origin.x;
+    maxX += origin.x;
+    minY += origin.y;
+    maxY += origin.y;
+}
+
+// Slack past the last hit for the whole-register stores of the vector kernels
+
+static const size_t HIT_SLACK = 8;
+
+void SensorHits::reserve(size_t objects) {
+    if (index.size() < objects + HIT_SLACK) {
+        index.resize(objects + HIT_SLACK);
+        distance.resize(objects + HIT_SLACK);
+        confidence.resize(objects + HIT_SLACK);
+    }
+}
+
+// Footprint parameters as the kernels see them. RuntimeShape reads them from the
+// footprint; FixedShape has them as template arguments, so a kernel instantiated
+// for it tests against constants and drops the filters it does not need.
+
+struct RuntimeShape {
+    static int minAhead(const SensorFootprint& f) { return f.minAhead; }
+    static int maxAhead(const SensorFootprint& f) { return f.maxAhead; }
+    static int minSide(const SensorFootprint& f) { return f.minSide; }
+    static int maxSide(const SensorFootprint& f) { return f.maxSide; }
+    static bool skipOrigin(const SensorFootprint& f) { return f.skipOrigin; }
+    static bool moversOnly(const SensorFootprint& f) { return f.moversOnly; }
+    static double falloff(const SensorFootprint& f) { return f.falloff; }
+};
+
+template <int MinAhead, int MaxAhead, int MinSide, int MaxSide, bool SkipOrigin, bool MoversOnly, int Falloff>
+struct FixedShape {
+    static int minAhead(const SensorFootprint&) { return MinAhead; }
+    static int maxAhead(const SensorFootprint&) { return MaxAhead; }
+    static int minSide(const SensorFootprint&) { return MinSide; }
+    static int maxSide(const SensorFootprint&) { return MaxSide; }
+    static bool skipOrigin(const SensorFootprint&) { return SkipOrigin; }
+    static bool moversOnly(const SensorFootprint&) { return MoversOnly; }
+    static double falloff(const SensorFootprint&) { return Falloff; }
+
+    static bool matches(const SensorFootprint& f) {
+        return f.minAhead == MinAhead && f.maxAhead == MaxAhead && f.minSide == MinSide && f.maxSide == MaxSide
+            && f.skipOrigin == SkipOrigin && f.moversOnly == MoversOnly && f.falloff == (double)Falloff;
+    }
+};
+
+// The fixed cases: the default Lidar, Radar and Camera footprints (see Sensors.cpp)
+
+typedef FixedShape<-4, 4, -4, 4, true, false, 9> LidarShape;
+typedef FixedShape<1, 12, 0, 0, false, true, 12> RadarShape;
+typedef FixedShape<1, 7, -3, 3, false, false, 8> CameraShape;
+
+// Confidence before noise of a reading at the given distance. Written exactly as
+// the sensors always computed it, so every kernel rounds the same way.
+
+template <class Shape>
+static double confidenceAt(const SensorFootprint& footprint, int distance) {
+    double distFactor = 1.0 - ((double)distance / Shape::falloff(footprint));
+    if (distFactor < 0.0) distFactor = 0.0;
+    return footprint.accuracy * distFactor;
+}
+
+// Scalar test of objects [begin, end), appending to the hits from 'count' on.
+// The test itself has no branches; only storing a hit does, and hits are rare
+// enough for that branch to be predicted. Also finishes the tails of the vector kernels.
+
+template <class Shape>
+static size_t rangeTestRange(const SensorFootprint& footprint, Position origin, int fx, int fy,
+    const int* x, const int* y, const unsigned char* mover, size_t begin, size_t end, SensorHits& hits, size_t count) {
+
+    unsigned aheadSpan = (unsigned)(Shape::maxAhead(footprint) - Shape::minAhead(footprint));
+    unsigned sideSpan = (unsigned)(Shape::maxSide(footprint) - Shape::minSide(footprint));
+    int anyCell = Shape::skipOrigin(footprint) ? 0 : 1;
+    int anyKind = Shape::moversOnly(footprint) ? 0 : 1;
+
+    for (size_t i = begin; i < end; ++i) {
+        int dx = x[i] - origin.x;
+        int dy = y[i] - origin.y;
+        int ahead = dx * fx + dy * fy;
+        int side = dx * fy - dy * fx;
+        int dist = abs(dx) + abs(dy);
+
+        int hit = ((unsigned)(ahead - Shape::minAhead(footprint)) <= aheadSpan) & ((unsigned)(side - Shape::minSide(footprint)) <= sideSpan)
+                & (anyCell | (dist != 0)) & (anyKind | (mover[i] != 0));
+
+        if (hit) {
+            hits.index[count] = (int)i;
+            hits.distance[count] = dist;
+            count++;
+        }
+    }
+
+    return count;
+}
+
+template <class Shape>
+static void scalarKernel(const SensorFootprint& footprint, Position origin, Direction dir,
+    const int* x, const int* y, const unsigned char* mover, size_t count, SensorHits& hits) {
+
+    int fx, fy;
+    headingStep(dir, fx, fy);
+    hits.reserve(count);
+
+    hits.count = rangeTestRange<Shape>(footprint, origin, fx, fy, x, y, mover, 0, count, hits, 0);
+
+    for (size_t h = 0; h < hits.count; ++h) hits.confidence[h] = confidenceAt<Shape>(footprint, hits.distance[h]);
+}
+
+#if AVS_X86_KERNELS
+
+// Left-packing shuffles: for a mask of hit lanes, the control that moves those
+// lanes (in order) to the front of a register. 4-lane byte shuffles for SSE4,
+// 8-lane dword permutes for AVX2.
+
+struct PackTables {
+    unsigned char sse[16][16];
+    int avx[256][8];
+
+    PackTables() {
+        for (int mask = 0; mask < 16; ++mask) {
+            int out = 0;
+            memset(sse[mask], 0x80, sizeof(sse[mask]));
+
+            for (int lane = 0; lane < 4; ++lane) {
+                if (!(mask & (1 << lane))) continue;
+                for (int b = 0; b < 4; ++b) sse[mask][out * 4 + b] = (unsigned char)(lane * 4 + b);
+                out++;
+            }
+        }
+
+        for (int mask = 0; mask < 256; ++mask) {
+            int out = 0;
+            for (int lane = 0; lane < 8; ++lane) avx[mask][lane] = 0;
+            for (int lane = 0; lane < 8; ++lane) if (mask & (1 << lane)) avx[mask][out++] = lane;
+        }
+    }
+};
+
+static const PackTables packTables;
+
+// 4 objects per step: the footprint test as compares on the car-frame offsets,
+// then the hit lanes' indices and distances are packed to the front and stored,
+// and their confidences computed two at a time from the packed distances.
+
+template <class Shape>
+__attribute__((target("sse4.1")))
+static void sse4Kernel(const SensorFootprint& footprint, Position origin, Direction dir,
+    const int* x, const int* y, const unsigned char* mover, size_t count, SensorHits& hits) {
+
+    int fx, fy;
+    headingStep(dir, fx, fy);
+    hits.reserve(count);
+
+    const __m128i originX = _mm_set1_epi32(origin.x);
+    const __m128i originY = _mm_set1_epi32(origin.y);
+    const __m128i stepX = _mm_set1_epi32(fx);
+    const __m128i stepY = _mm_set1_epi32(fy);
+    const __m128i minAhead = _mm_set1_epi32(Shape::minAhead(footprint));
+    const __m128i maxAhead = _mm_set1_epi32(Shape::maxAhead(footprint));
+    const __m128i minSide = _mm_set1_epi32(Shape::minSide(footprint));
+    const __m128i maxSide = _mm_set1_epi32(Shape::maxSide(footprint));
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i lanes = _mm_setr_epi32(0, 1, 2, 3);
+    const __m128d one = _mm_set1_pd(1.0);
+    const __m128d zeroPd = _mm_setzero_pd();
+    const __m128d falloff = _mm_set1_pd(Shape::falloff(footprint));
+    const __m128d accuracy = _mm_set1_pd(footprint.accuracy);
+
+    size_t n = 0;
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        __m128i dx = _mm_sub_epi32(_mm_loadu_si128((const __m128i*)(x + i)), originX);
+        __m128i dy = _mm_sub_epi32(_mm_loadu_si128((const __m128i*)(y + i)), originY);
+        __m128i ahead = _mm_add_epi32(_mm_mullo_epi32(dx, stepX), _mm_mullo_epi32(dy, stepY));
+        __m128i side = _mm_sub_epi32(_mm_mullo_epi32(dx, stepY), _mm_mullo_epi32(dy, stepX));
+        __m128i dist = _mm_add_epi32(_mm_abs_epi32(dx), _mm_abs_epi32(dy));
+
+        __m128i miss = _mm_or_si128(_mm_cmpgt_epi32(minAhead, ahead), _mm_cmpgt_epi32(ahead, maxAhead));
+        miss = _mm_or_si128(miss, _mm_or_si128(_mm_cmpgt_epi32(minSide, side), _mm_cmpgt_epi32(side, maxSide)));
+
+        if (Shape::skipOrigin(footprint)) miss = _mm_or_si128(miss, _mm_cmpeq_epi32(dist, zero));
+
+        if (Shape::moversOnly(footprint)) {
+            int movers;
+            memcpy(&movers, mover + i, sizeof(movers));
+            miss = _mm_or_si128(miss, _mm_cmpeq_epi32(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(movers)), zero));
+        }
+
+        int mask = ~_mm_movemask_ps(_mm_castsi128_ps(miss)) & 0xF;
+        if (mask == 0) continue;
+
+        __m128i pack = _mm_loadu_si128((const __m128i*)packTables.sse[mask]);
+        __m128i index = _mm_add_epi32(_mm_set1_epi32((int)i), lanes);
+        __m128i packedDist = _mm_shuffle_epi8(dist, pack);
+
+        _mm_storeu_si128((__m128i*)(hits.index.data() + n), _mm_shuffle_epi8(index, pack));
+        _mm_storeu_si128((__m128i*)(hits.distance.data() + n), packedDist);
+
+        __m128d low = _mm_cvtepi32_pd(packedDist);
+        __m128d high = _mm_cvtepi32_pd(_mm_unpackhi_epi64(packedDist, packedDist));
+        low = _mm_mul_pd(accuracy, _mm_max_pd(_mm_sub_pd(one, _mm_div_pd(low, falloff)), zeroPd));
+        high = _mm_mul_pd(accuracy, _mm_max_pd(_mm_sub_pd(one, _mm_div_pd(high, falloff)), zeroPd));
+
+        _mm_storeu_pd(hits.confidence.data() + n, low);
+        _mm_storeu_pd(hits.confidence.data() + n + 2, high);
+
+        n += __builtin_popcount(mask);
+    }
+
+    size_t tail = n;
+    n = rangeTestRange<Shape>(footprint, origin, fx, fy, x, y, mover, i, count, hits, n);
+
+    for (size_t h = tail; h < n; ++h) hits.confidence[h] = confidenceAt<Shape>(footprint, hits.distance[h]);
+    hits.count = n;
+}
+
+// Same as the SSE4 kernel with 8 objects per step; the confidences are computed
+// four at a time.
+
+template <class Shape>
+__attribute__((target("avx2")))
+static void avx2Kernel(const SensorFootprint& footprint, Position origin, Direction dir,
+    const int* x, const int* y, const unsigned char* mover, size_t count, SensorHits& hits) {
+
+    int fx, fy;
+    headingStep(dir, fx, fy);
+    hits.reserve(count);
+
+    const __m256i originX = _mm256_set1_epi32(origin.x);
+    const __m256i originY = _mm256_set1_epi32(origin.y);
+    const __m256i stepX = _mm256_set1_epi32(fx);
+    const __m256i stepY = _mm256_set1_epi32(fy);
+    const __m256i minAhead = _mm256_set1_epi32(Shape::minAhead(footprint));
+    const __m256i maxAhead = _mm256_set1_epi32(Shape::maxAhead(footprint));
+    const __m256i minSide = _mm256_set1_epi32(Shape::minSide(footprint));
+    const __m256i maxSide = _mm256_set1_epi32(Shape::maxSide(footprint));
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d zeroPd = _mm256_setzero_pd();
+    const __m256d falloff = _mm256_set1_pd(Shape::falloff(footprint));
+    const __m256d accuracy = _mm256_set1_pd(footprint.accuracy);
+
+    size_t n = 0;
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        __m256i dx = _mm256_sub_epi32(_mm256_loadu_si256((const __m256i*)(x + i)), originX);
+        __m256i dy = _mm256_sub_epi32(_mm256_loadu_si256((const __m256i*)(y + i)), originY);
+        __m256i ahead = _mm256_add_epi32(_mm256_mullo_epi32(dx, stepX), _mm256_mullo_epi32(dy, stepY));
+        __m256i side = _mm256_sub_epi32(_mm256_mullo_epi32(dx, stepY), _mm256_mullo_epi32(dy, stepX));
+        __m256i dist = _mm256_add_epi32(_mm256_abs_epi32(dx), _mm256_abs_epi32(dy));
+
+        __m256i miss = _mm256_or_si256(_mm256_cmpgt_epi32(minAhead, ahead), _mm256_cmpgt_epi32(ahead, maxAhead));
+        miss = _mm256_or_si256(miss, _mm256_or_si256(_mm256_cmpgt_epi32(minSide, side), _mm256_cmpgt_epi32(side, maxSide)));
+
+        if (Shape::skipOrigin(footprint)) miss = _mm256_or_si256(miss, _mm256_cmpeq_epi32(dist, zero));
+
+        if (Shape::moversOnly(footprint)) {
+            __m128i movers = _mm_loadl_epi64((const __m128i*)(mover + i));
+            miss = _mm256_or_si256(miss, _mm256_cmpeq_epi32(_mm256_cvtepu8_epi32(movers), zero));
+        }
+
+        int mask = ~_mm256_movemask_ps(_mm256_castsi256_ps(miss)) & 0xFF;
+        if (mask == 0) continue;
+
+        __m256i pack = _mm256_loadu_si256((const __m256i*)packTables.avx[mask]);
+        __m256i index = _mm256_add_epi32(_mm256_set1_epi32((int)i), lanes);
+        __m256i packedDist = _mm256_permutevar8x32_epi32(dist, pack);
+
+        _mm256_storeu_si256((__m256i*)(hits.index.data() + n), _mm256_permutevar8x32_epi32(index, pack));
+        _mm256_storeu_si256((__m256i*)(hits.distance.data() + n), packedDist);
+
+        __m256d low = _mm256_cvtepi32_pd(_mm256_castsi256_si128(packedDist));
+        low = _mm256_mul_pd(accuracy, _mm256_max_pd(_mm256_sub_pd(one, _mm256_div_pd(low, falloff)), zeroPd));
+        _mm256_storeu_pd(hits.confidence.data() + n, low);
+
+        int found = __builtin_popcount(mask);
+
+        if (found > 4) {
+            __m256d high = _mm256_cvtepi32_pd(_mm256_extracti128_si256(packedDist, 1));
+            high = _mm256_mul_pd(accuracy, _mm256_max_pd(_mm256_sub_pd(one, _mm256_div_pd(high, falloff)), zeroPd));
+            _mm256_storeu_pd(hits.confidence.data() + n + 4, high);
+        }
+
+        n += found;
+    }
+
+    size_t tail = n;
+    n = rangeTestRange<Shape>(footprint, origin, fx, fy, x, y, mover, i, count, hits, n);
+
+    for (size_t h = tail; h < n; ++h) hits.confidence[h] = confidenceAt<Shape>(footprint, hits.distance[h]);
+    hits.count = n;
+}
+
+bool sensorKernelSupported(SensorKernelMode mode) {
+    __builtin_cpu_init();
+
+    if (mode == KERNEL_AVX2) return __builtin_cpu_supports("avx2");
+    if (mode == KERNEL_SSE4) return __builtin_cpu_supports("sse4.1");
+    return true;
+}
+
+#else
+
+// Without x86 vector instructions the vector kernels are the scalar one
+
+template <class Shape>
+static void sse4Kernel(const SensorFootprint& footprint, Position origin, Direction dir,
+    const int* x, const int* y, const unsigned char* mover, size_t count, SensorHits& hits) {
+    scalarKernel<Shape>(footprint, origin, dir, x, y, mover, count, hits);
+}
+
+template <class Shape>
+static void avx2Kernel(const SensorFootprint& footprint, Position origin, Direction dir,
+    const int* x, const int* y, const unsigned char* mover, size_t count, SensorHits& hits) {
+    scalarKernel<Shape>(footprint, origin, dir, x, y, mover, count, hits);
+}
+
+bool sensorKernelSupported(SensorKernelMode mode) {
+    return mode == KERNEL_AUTO || mode == KERNEL_SCALAR;
+}
+
+#endif
+
+// Kernels for footprints given at run time
+
+void rangeTestScalar(const SensorFootprint& footprint, Position origin, Direction dir,
+    const int* x, const int* y, const unsigned char* mover, size_t count, SensorHits& hits) {
+    scalarKernel<RuntimeShape>(footprint, origin, dir, x, y, mover, count, hits);
+}
+
+void rangeTestSse4(const SensorFootprint& footprint, Position origin, Direction dir,
+    const int* x, const int* y, const unsigned char* mover, size_t count, SensorHits& hits) {
+    sse4Kernel<RuntimeShape>(footprint, origin, dir, x, y, mover, count, hits);
+}
+
+void rangeTestAvx2(const SensorFootprint& footprint, Position origin, Direction dir,
+    const int* x, const int* y, const unsigned char* mover, size_t count, SensorHits& hits) {
+    avx2Kernel<RuntimeShape>(footprint, origin, dir, x, y, mover, count, hits);
+}
+
+// Kernels by footprint shape (FOOTPRINT_*) and instruction set (scalar, SSE4, AVX2)
+
+static const RangeTestKernel shapeKernels[FOOTPRINT_SHAPES][3] = {
+    {rangeTestScalar, rangeTestSse4, rangeTestAvx2},
+    {scalarKernel<LidarShape>, sse4Kernel<LidarShape>, avx2Kernel<LidarShape>},
+    {scalarKernel<RadarShape>, sse4Kernel<RadarShape>, avx2Kernel<RadarShape>},
+    {scalarKernel<CameraShape>, sse4Kernel<CameraShape>, avx2Kernel<CameraShape>}
+};
+
+int footprintShape(const SensorFootprint& footprint) {
+    if (LidarShape::matches(footprint)) return FOOTPRINT_LIDAR;
+    if (RadarShape::matches(footprint)) return FOOTPRINT_RADAR;
+    if (CameraShape::matches(footprint)) return FOOTPRINT_CAMERA;
+    return FOOTPRINT_GENERIC;
+}
+
+// Widest supported kernel at or below the requested one
+
+static SensorKernelMode supportedKernel(SensorKernelMode mode) {
+    if (mode == KERNEL_AUTO) mode = KERNEL_AVX2;
+
+    if (mode == KERNEL_AVX2 && !sensorKernelSupported(KERNEL_AVX2)) mode = KERNEL_SSE4;
+    if (mode == KERNEL_SSE4 && !sensorKernelSupported(KERNEL_SSE4)) mode = KERNEL_SCALAR;
+    return mode;
+}
+
+// Column of shapeKernels for an instruction set
+
+static int kernelColumn(SensorKernelMode mode) {
+    if (mode == KERNEL_AVX2) return 2;
+    if (mode == KERNEL_SSE4) return 1;
+    return 0;
+}
+
+static SensorKernelMode activeMode = supportedKernel(KERNEL_AUTO);
+static int activeColumn = kernelColumn(activeMode);
+
+SensorKernelMode selectSensorKernel(SensorKernelMode mode) {
+    activeMode = supportedKernel(mode);
+    activeColumn = kernelColumn(activeMode);
+    return activeMode;
+}
+
+SensorKernelMode activeSensorKernel() {
+    return activeMode;
+}
+
+const char* sensorKernelName(SensorKernelMode mode) {
+    static const char* const names[] = {"auto", "scalar", "sse4", "avx2"};
+    return names[mode];
+}
+
+void rangeTest(const SensorFootprint& footprint, Position origin, Direction dir,
+    const int* x, const int* y, const unsigned char* mover, size_t count, SensorHits& hits) {
+    int shape = (footprint.shape >= 0 && footprint.shape < FOOTPRINT_SHAPES) ? footprint.shape : FOOTPRINT_GENERIC;
+    shapeKernels[shape][activeColumn](footprint, origin, dir, x, y, mover, count, hits);
+}
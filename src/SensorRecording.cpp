@@ -0,0 +1,358 @@
+#include <cstring>
+
+#include "../include/SensorRecording.h"
+#include "../include/VehicleSystem.h"
+#include "../include/ByteCodec.h"
+
+using namespace std;
+
+// Identifies sensor recordings
+
+static const char RECORDING_MAGIC[8] = {'A', 'V', 'S', 'S', 'E', 'N', 'S', '1'};
+
+// Header at the start of a recording
+
+struct RecordingHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+};
+
+// Largest block a reader accepts (a sanity limit against damaged size prefixes)
+
+static const uint64_t MAX_BLOCK_BYTES = (uint64_t)1 << 32;
+
+// Writes a payload with its varint size in front.
+
+static void writeSized(FILE* file, const vector<unsigned char>& payload, uint64_t& bytes) {
+    vector<unsigned char> size;
+    putVarint(size, payload.size());
+
+    fwrite(size.data(), 1, size.size(), file);
+    fwrite(payload.data(), 1, payload.size(), file);
+    bytes += size.size() + payload.size();
+}
+
+// Constructor. Nothing is open yet.
+
+SensorRecorder::SensorRecorder() : file(nullptr), ticks(0), readings(0), bytes(0) {}
+
+SensorRecorder::~SensorRecorder() {
+    close();
+}
+
+// Creates the file with its header and every setting that shapes the generated world.
+
+bool SensorRecorder::open(const string& path, const SimSettings& settings) {
+    close();
+
+    file = fopen(path.c_str(), "wb");
+    if (file == nullptr) return false;
+
+    RecordingHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, RECORDING_MAGIC, sizeof(header.magic));
+    header.version = SENSOR_RECORDING_VERSION;
+
+    block.clear();
+    putSigned(block, settings.seed);
+    putVarint(block, settings.dimX);
+    putVarint(block, settings.dimY);
+    putVarint(block, settings.numMovingCars);
+    putVarint(block, settings.numMovingBikes);
+    putVarint(block, settings.numParkedCars);
+    putVarint(block, settings.numStopSigns);
+    putVarint(block, settings.numTrafficLights);
+    putRaw(block, &settings.minConfidenceThreshold, sizeof(settings.minConfidenceThreshold));
+    block.push_back((unsigned char)settings.placement);
+    block.push_back((unsigned char)settings.noiseModel);
+    putVarint(block, settings.fleetSize);
+    block.push_back((unsigned char)settings.planner);
+    putVarint(block, settings.fieldBudgetMB);
+
+    putVarint(block, settings.gpsTargets.size());
+    for (size_t i = 0; i < settings.gpsTargets.size(); ++i) putPosition(block, settings.gpsTargets[i]);
+
+    ticks = 0;
+    readings = 0;
+    bytes = sizeof(header);
+
+    fwrite(&header, sizeof(header), 1, file);
+    writeSized(file, block, bytes);
+    return ferror(file) == 0;
+}
+
+// Encodes one tick as a columnar block: the per-car columns, then one column per
+// reading field running over all batches of the tick.
+
+bool SensorRecorder::recordTick(int tick, const vector<SelfDrivingCar*>& fleet) {
+    if (file == nullptr) return false;
+
+    block.clear();
+    batches.clear();
+    active.clear();
+
+    for (size_t i = 0; i < fleet.size(); ++i)
+        if (fleet[i]->isActive()) active.push_back((int)i);
+
+    putVarint(block, tick);
+    putVarint(block, active.size());
+
+    for (size_t i = 0; i < active.size(); ++i) putVarint(block, active[i]);
+    for (size_t i = 0; i < active.size(); ++i) putSigned(block, fleet[active[i]]->getPosition().x);
+    for (size_t i = 0; i < active.size(); ++i) putSigned(block, fleet[active[i]]->getPosition().y);
+
+    for (int sensor = 0; sensor < 3; ++sensor)
+        for (size_t i = 0; i < active.size(); ++i) putVarint(block, fleet[active[i]]->sensorBuffer(sensor).size());
+
+    for (size_t i = 0; i < active.size(); ++i)
+        for (int sensor = 0; sensor < 3; ++sensor) batches.push_back(&fleet[active[i]]->sensorBuffer(sensor));
+
+    // One pass per column keeps equal fields next to each other in the file
+
+    for (size_t b = 0; b < batches.size(); ++b)
+        for (size_t r = 0; r < batches[b]->size(); ++r) putVarint(block, (*batches[b])[r].objectHandle);
+
+    for (size_t b = 0; b < batches.size(); ++b)
+        for (size_t r = 0; r < batches[b]->size(); ++r) block.push_back((unsigned char)(*batches[b])[r].type);
+
+    for (size_t b = 0; b < batches.size(); ++b)
+        for (size_t r = 0; r < batches[b]->size(); ++r) putSigned(block, (*batches[b])[r].pos.x);
+
+    for (size_t b = 0; b < batches.size(); ++b)
+        for (size_t r = 0; r < batches[b]->size(); ++r) putSigned(block, (*batches[b])[r].pos.y);
+
+    for (size_t b = 0; b < batches.size(); ++b)
+        for (size_t r = 0; r < batches[b]->size(); ++r) putSigned(block, (*batches[b])[r].speed);
+
+    for (size_t b = 0; b < batches.size(); ++b)
+        for (size_t r = 0; r < batches[b]->size(); ++r) block.push_back((unsigned char)(*batches[b])[r].direction);
+
+    for (size_t b = 0; b < batches.size(); ++b)
+        for (size_t r = 0; r < batches[b]->size(); ++r) block.push_back((unsigned char)(*batches[b])[r].sign);
+
+    for (size_t b = 0; b < batches.size(); ++b)
+        for (size_t r = 0; r < batches[b]->size(); ++r) block.push_back((unsigned char)(*batches[b])[r].lightState);
+
+    size_t count = 0;
+
+    for (size_t b = 0; b < batches.size(); ++b) {
+        for (size_t r = 0; r < batches[b]->size(); ++r) putRaw(block, &(*batches[b])[r].distance, sizeof(double));
+        count += batches[b]->size();
+    }
+
+    for (size_t b = 0; b < batches.size(); ++b)
+        for (size_t r = 0; r < batches[b]->size(); ++r) putRaw(block, &(*batches[b])[r].confidence, sizeof(double));
+
+    writeSized(file, block, bytes);
+
+    ticks++;
+    readings += count;
+    return ferror(file) == 0;
+}
+
+void SensorRecorder::close() {
+    if (file != nullptr) fclose(file);
+    file = nullptr;
+}
+
+int SensorRecorder::getTicks() const {
+    return ticks;
+}
+
+uint64_t SensorRecorder::getReadings() const {
+    return readings;
+}
+
+uint64_t SensorRecorder::getBytes() const {
+    return bytes;
+}
+
+// Constructor. Nothing is open yet.
+
+SensorReplay::SensorReplay() : file(nullptr), tick(0) {}
+
+SensorReplay::~SensorReplay() {
+    close();
+}
+
+// Reads a size prefix and the block behind it. Returns false at the end of the file.
+
+static bool readSized(FILE* file, vector<unsigned char>& payload, bool& damaged) {
+    uint64_t size = 0;
+
+    int c = fgetc(file);
+    if (c == EOF) return false;
+    ungetc(c, file);
+
+    if (!readFileVarint(file, size) || size > MAX_BLOCK_BYTES) {
+        damaged = true;
+        return false;
+    }
+
+    payload.resize((size_t)size);
+
+    if (size > 0 && fread(payload.data(), 1, (size_t)size, file) != size) {
+        damaged = true;
+        return false;
+    }
+    return true;
+}
+
+// Opens a recording and reads the settings its world was generated with.
+
+bool SensorReplay::open(const string& path, SimSettings& settings, string& error) {
+    close();
+
+    file = fopen(path.c_str(), "rb");
+
+    if (file == nullptr) {
+        error = "Could not open sensor recording '" + path + "'!";
+        return false;
+    }
+
+    RecordingHeader header;
+
+    if (fread(&header, sizeof(header), 1, file) != 1 || memcmp(header.magic, RECORDING_MAGIC, sizeof(header.magic)) != 0) {
+        error = "'" + path + "' is not a sensor recording.";
+        close();
+        return false;
+    }
+
+    if (header.version != SENSOR_RECORDING_VERSION) {
+        error = "Unsupported sensor recording version " + to_string(header.version) + ".";
+        close();
+        return false;
+    }
+
+    bool damaged = false;
+
+    if (!readSized(file, block, damaged)) {
+        error = "The sensor recording '" + path + "' is damaged.";
+        close();
+        return false;
+    }
+
+    ByteReader in = {block.data(), block.size(), 0, false};
+    SimSettings saved = settings;
+
+    saved.seed = in.integer();
+    saved.dimX = (int)in.varint();
+    saved.dimY = (int)in.varint();
+    saved.numMovingCars = (int)in.varint();
+    saved.numMovingBikes = (int)in.varint();
+    saved.numParkedCars = (int)in.varint();
+    saved.numStopSigns = (int)in.varint();
+    saved.numTrafficLights = (int)in.varint();
+    in.raw(&saved.minConfidenceThreshold, sizeof(saved.minConfidenceThreshold));
+    saved.placement = (PlacementMode)in.byte();
+    saved.noiseModel = (NoiseModel)in.byte();
+    saved.fleetSize = (int)in.varint();
+    saved.planner = (PlannerMode)in.byte();
+    saved.fieldBudgetMB = (int)in.varint();
+
+    saved.gpsTargets.resize(in.count(2));
+    for (size_t i = 0; i < saved.gpsTargets.size(); ++i) saved.gpsTargets[i] = in.position();
+
+    if (in.failed || saved.dimX <= 0 || saved.dimY <= 0 || saved.fleetSize < 1 || saved.placement > PLACEMENT_SHUFFLE || saved.noiseModel > NOISE_PHILOX || saved.planner > PLANNER_FIELD) {
+        error = "The sensor recording '" + path + "' is damaged.";
+        close();
+        return false;
+    }
+
+    settings = saved;
+    return true;
+}
+
+// Reads and decodes the next block back into readings, car by car.
+
+bool SensorReplay::nextTick(bool& damaged) {
+    damaged = false;
+    if (file == nullptr || !readSized(file, block, damaged)) return false;
+
+    ByteReader in = {block.data(), block.size(), 0, false};
+
+    tick = (int)in.varint();
+    size_t carCount = in.count(6);
+
+    cars.resize(carCount);
+    positions.resize(carCount);
+    offsets.assign(carCount * 3 + 1, 0);
+
+    for (size_t i = 0; i < carCount; ++i) cars[i] = (int)in.varint();
+    for (size_t i = 0; i < carCount; ++i) positions[i].x = in.integer();
+    for (size_t i = 0; i < carCount; ++i) positions[i].y = in.integer();
+
+    // Counts are stored per sensor; offsets run per car, then per sensor
+
+    vector<size_t> counts(carCount * 3);
+
+    for (int sensor = 0; sensor < 3; ++sensor)
+        for (size_t i = 0; i < carCount; ++i) counts[i * 3 + sensor] = in.count(1);
+
+    size_t total = 0;
+
+    for (size_t b = 0; b < counts.size(); ++b) {
+        offsets[b] = total;
+        total += counts[b];
+    }
+    offsets[counts.size()] = total;
+
+    // Every reading takes at least 24 bytes: eight one-byte fields and two doubles
+
+    if (in.failed || total > (in.size - in.offset) / 24) {
+        damaged = true;
+        return false;
+    }
+
+    readings.assign(total, createEmptyReading());
+
+    for (size_t r = 0; r < total; ++r) readings[r].objectHandle = (int)in.varint();
+    for (size_t r = 0; r < total; ++r) readings[r].type = (ObjectType)in.byte();
+    for (size_t r = 0; r < total; ++r) readings[r].pos.x = in.integer();
+    for (size_t r = 0; r < total; ++r) readings[r].pos.y = in.integer();
+    for (size_t r = 0; r < total; ++r) readings[r].speed = in.integer();
+    for (size_t r = 0; r < total; ++r) readings[r].direction = (Direction)(in.byte() & 3);
+    for (size_t r = 0; r < total; ++r) readings[r].sign = (SignType)in.byte();
+    for (size_t r = 0; r < total; ++r) readings[r].lightState = (LightState)in.byte();
+    for (size_t r = 0; r < total; ++r) in.raw(&readings[r].distance, sizeof(double));
+    for (size_t r = 0; r < total; ++r) in.raw(&readings[r].confidence, sizeof(double));
+
+    if (in.failed) {
+        damaged = true;
+        return false;
+    }
+    return true;
+}
+
+int SensorReplay::getTick() const {
+    return tick;
+}
+
+size_t SensorReplay::getCarCount() const {
+    return cars.size();
+}
+
+int SensorReplay::getCar(size_t i) const {
+    return cars[i];
+}
+
+Position SensorReplay::getPosition(size_t i) const {
+    return positions[i];
+}
+
+// Copies one batch of the current tick into a car's sensor buffer.
+
+void SensorReplay::copyReadings(size_t i, int sensor, vector<SensorReading>& out) const {
+    size_t b = i * 3 + sensor;
+    out.assign(readings.begin() + offsets[b], readings.begin() + offsets[b + 1]);
+}
+
+size_t SensorReplay::getReadingCount() const {
+    return readings.size();
+}
+
+void SensorReplay::close() {
+    if (file != nullptr) fclose(file);
+    file = nullptr;
+}
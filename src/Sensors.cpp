@@ -1,6 +1,9 @@
 #include <iostream>
+#include <fstream>
+#include <sstream>
 #include <cstdlib>
 #include <cmath>
+#include <set>
 
 #include "../include/Sensors.h"
 
@@ -13,23 +16,88 @@ using namespace std;
 SensorReading createEmptyReading() {
     SensorReading readings;
 
-    readings.objectID = "";
-    readings.type = "UNKNOWN";
+    readings.objectHandle = -1;
+    readings.type = TYPE_UNKNOWN;
     readings.pos = {-1, -1};
     readings.distance = -1.0;
     readings.confidence = 0.0;
     readings.speed = 0;
     readings.direction = NORTH;
-    readings.signText = "N/A";
+    readings.sign = SIGN_NONE;
     readings.lightState = RED;
 
     return readings;
 }
 
-// Constructor for the abstract base Sensor class.
-// Initializes the sensor ID and its base accuracy.
+// Log names of the object types, indexed by ObjectType.
 
-Sensor::Sensor(const string& sensorID, double accuracy):id(sensorID), baseAccuracy(accuracy) {};
+const char* objectTypeName(ObjectType type) {
+    static const char* const names[] = {"UNKNOWN", "CAR", "BIKE", "TRAFFIC_SIGN", "PARKED_CAR", "TRAFFIC_LIGHT"};
+    return names[type];
+}
+
+// Reading type and detail kind of every glyph, so a candidate is classified with
+// one table lookup. The types are the ones the three sensors report.
+
+enum GlyphKind {KIND_OTHER, KIND_MOVER, KIND_LIGHT, KIND_SIGN};
+
+struct GlyphClass {
+    ObjectType type;
+    GlyphKind kind;
+};
+
+struct GlyphTable {
+    GlyphClass entries[256];
+
+    GlyphTable() {
+        for (int i = 0; i < 256; ++i) entries[i] = {TYPE_UNKNOWN, KIND_OTHER};
+
+        entries['C'] = {TYPE_CAR, KIND_MOVER};
+        entries['@'] = {TYPE_CAR, KIND_MOVER};
+        entries['B'] = {TYPE_BIKE, KIND_MOVER};
+        entries['S'] = {TYPE_TRAFFIC_SIGN, KIND_SIGN};
+        entries['P'] = {TYPE_PARKED_CAR, KIND_OTHER};
+        entries['R'] = {TYPE_TRAFFIC_LIGHT, KIND_LIGHT};
+        entries['G'] = {TYPE_TRAFFIC_LIGHT, KIND_LIGHT};
+        entries['Y'] = {TYPE_TRAFFIC_LIGHT, KIND_LIGHT};
+    }
+};
+
+static const GlyphTable glyphTable;
+
+// Walks the index once over the box and appends every object to the arrays.
+
+void SensorCandidates::gather(const SpatialIndex& index, int minX, int minY, int maxX, int maxY) {
+    objects.clear();
+    x.clear();
+    y.clear();
+    mover.clear();
+    type.clear();
+    kind.clear();
+
+    index.forEachIn(minX, minY, maxX, maxY, [this](WorldObjects* obj, Position p) {
+        const GlyphClass& cls = glyphTable.entries[(unsigned char)obj->getGlyph()];
+
+        objects.push_back(obj);
+        x.push_back(p.x);
+        y.push_back(p.y);
+        mover.push_back(cls.kind == KIND_MOVER);
+        type.push_back((unsigned char)cls.type);
+        kind.push_back((unsigned char)cls.kind);
+    });
+}
+
+size_t SensorCandidates::size() const {
+    return objects.size();
+}
+
+// Constructor for the base Sensor class.
+// Initializes the sensor ID, kind, footprint and the details it reports, and
+// picks the kernel specialization of the footprint.
+
+Sensor::Sensor(const string& sensorID, SensorKind sensorKind, const SensorFootprint& sensorFootprint, SensorDetail sensorDetail) : id(sensorID), kind(sensorKind), footprint(sensorFootprint), detail(sensorDetail), noise(nullptr), noiseKey(0), owner(nullptr) {
+    footprint.shape = footprintShape(footprint);
+};
 
 // Virtual destructor for Sensor.
 
@@ -41,284 +109,337 @@ string Sensor::getId() const {
     return id;
 }
 
-// Helper function to calculate the Manhattan distance between two points.
-// Used by all sensors to determine range and proximity.
+SensorKind Sensor::getKind() const {
+    return kind;
+}
+
+const SensorFootprint& Sensor::getFootprint() const {
+    return footprint;
+}
+
+// Attaches a noise engine. The key should be unique per sensor instance.
 
-double Sensor::calculateDistance(Position p1, Position p2) const {
-    return (double)(abs(p1.x - p2.x) + abs(p1.y - p2.y));
+void Sensor::setNoiseEngine(const NoiseEngine* engine, uint64_t sensorKey) {
+    noise = engine;
+    noiseKey = sensorKey;
 }
 
-// Simulates sensor noise by applying a random value to the confidence level.
+// Sets the car carrying the sensor. Footprints from a sensor package may cover
+// the car's own cell, and the car must not detect itself there.
+
+void Sensor::setOwner(const WorldObjects* car) {
+    owner = car;
+}
+
+// Simulates sensor noise by applying a random value to the confidence level of each reading.
+// All samples of the scan are generated in one batch from the noise engine.
 // Ensures that the confidence stays within the [0.0, 1.0] range.
 
-double Sensor::applyNoise(double conf) const {
-    double noise = ((rand() % 100) / 1000.0) - 0.05;
-    double finalConf = conf + noise;
+void Sensor::applyNoise(vector<SensorReading>& readings, size_t first, int tick) {
+    size_t count = readings.size() - first;
+    noiseValues.assign(count, 0.0);
+
+    if (noise != nullptr && count > 0) {
+        noiseSamples.resize(count);
+        noise->generate((uint64_t)tick, noiseKey, noiseObjects.data(), count, noiseSamples.data());
+        NoiseEngine::toConfidenceNoise(noiseSamples.data(), count, noiseValues.data());
+    }
 
-    if (finalConf > 1.0) return 1.0;
-    if (finalConf < 0.0) return 0.0;
+    for (size_t i = 0; i < count; ++i) {
+        double finalConf = readings[first + i].confidence + noiseValues[i];
 
-    return finalConf;
-}
+        if (finalConf > 1.0) finalConf = 1.0;
+        if (finalConf < 0.0) finalConf = 0.0;
 
-// Constructor for Lidar.
-// Lidar has high accuracy (0.99) and logs its activation.
+        readings[first + i].confidence = finalConf;
+    }
+}
 
-Lidar::Lidar(const string& sensorId) : Sensor(sensorId, 0.99) {
-    simLog << "[+LIDAR: " << id << "] Lidar sensor ready Sensing with pew pews!" << endl;
+void Sensor::getReadings(const SpatialIndex& index, Position carPos, Direction carDir, int tick, vector<SensorReading>& readings) {
+    readings.clear();
+    addReadings(index, carPos, carDir, tick, readings);
 }
 
-// Destructor for Lidar. Logs deactivation.
+// Gathers the objects in the footprint's bounding box and scans them.
 
-Lidar::~Lidar() {
-    simLog << "[-LIDAR: " << id << "] Lidar offline" << endl;
+void Sensor::addReadings(const SpatialIndex& index, Position carPos, Direction carDir, int tick, vector<SensorReading>& readings) {
+    int minX, minY, maxX, maxY;
+    footprintBox(footprint, carPos, carDir, minX, minY, maxX, maxY);
+
+    candidates.gather(index, minX, minY, maxX, maxY);
+    scanCandidates(candidates, carPos, carDir, tick, readings);
+
+    PROFILE_COUNT(COUNTER_OBJECTS_SCANNED, candidates.size());
 }
 
-// Scans the environment for objects within a 4x4 box around the car.
-// Detects all types of objects and provides type-specific details.
-
-vector<SensorReading> Lidar::getReadings(const vector<WorldObjects*>& allObjects, Position carPos, Direction carDir) {
-    vector<SensorReading> readings;
-
-    for (size_t i = 0; i < allObjects.size(); i++) {
-        WorldObjects* obj = allObjects[i];
-        Position objPos = obj->getPosition();
-        double dist = calculateDistance(carPos, objPos);
-        
-        // Check if object is within Lidar range (Manhattan distance <= 4 on both axes)
-        
-        if (abs(objPos.x - carPos.x) <= 4 && abs(objPos.y - carPos.y) <= 4) {
-            
-            if (objPos.x == carPos.x && objPos.y == carPos.y) continue;
-            
-            SensorReading r = createEmptyReading();
-            r.objectID = obj->getId();
-            r.pos = objPos;
-            r.distance = dist;
-
-            char objSymbol = obj->getGlyph();
-
-            switch (objSymbol) {
-                case 'C':
-                    r.type = "CAR";
-                    break;
-                
-                case 'B':
-                    r.type = "BIKE";
-                    break;
-
-                case 'S':
-                    r.type = "TRAFFIC_SIGN";
-                    break;
-                
-                case 'P':
-                    r.type = "PARKED_CAR";
-                    break;
-
-                case 'R':
-                    r.type = "TRAFFIC_LIGHT";
-                    break;
-
-                case 'G':
-                    r.type = "TRAFFIC_LIGHT";
-                    break;
-
-                case 'Y':
-                    r.type = "TRAFFIC_LIGHT";
-                    break;
-
-                default:
-                    r.type = "UNKNOWN";
-                    break;
-            }
+// Runs the range-test kernel over the candidates and builds a reading for every
+// hit, in candidate order. Distance and confidence come from the kernel; the
+// details are read from the object as far as the sensor reports them.
+
+void Sensor::scanCandidates(const SensorCandidates& batch, Position carPos, Direction carDir, int tick, vector<SensorReading>& readings) {
+    size_t first = readings.size();
+    noiseObjects.clear();
 
-            // Calculate confidence based on distance and base accuracy.
-            
-            double distFactor = 1.0 - (dist / 9.0);
-            if (distFactor < 0.0) distFactor = 0.0;
+    rangeTest(footprint, carPos, carDir, batch.x.data(), batch.y.data(), batch.mover.data(), batch.size(), hits);
 
-            r.confidence = applyNoise(baseAccuracy * distFactor);
-            readings.push_back(r);
+    for (size_t h = 0; h < hits.count; ++h) {
+        int c = hits.index[h];
+        WorldObjects* obj = batch.objects[c];
+        if (obj == owner) continue;
+
+        SensorReading r = createEmptyReading();
+        r.objectHandle = obj->getHandle();
+        r.type = (ObjectType)batch.type[c];
+        r.pos = {batch.x[c], batch.y[c]};
+        r.distance = (double)hits.distance[h];
+        r.confidence = hits.confidence[h];
+
+        if (detail != DETAIL_NONE && batch.kind[c] == KIND_MOVER) {
+            MovingObject* movObj = (MovingObject*)obj;
+            r.speed = movObj->getSpeed();
+            r.direction = movObj->getDirection();
         }
+
+        else if (detail == DETAIL_ALL && batch.kind[c] == KIND_LIGHT) r.lightState = ((TrafficLight*)obj)->getState();
+
+        else if (detail == DETAIL_ALL && batch.kind[c] == KIND_SIGN) r.sign = ((TrafficSign*)obj)->getSignType();
+
+        readings.push_back(r);
+        noiseObjects.push_back(obj->getKey());
     }
-    return readings;
+    applyNoise(readings, first, tick);
+
+    PROFILE_COUNT(COUNTER_READINGS_PRODUCED, readings.size() - first);
+}
+
+// Constructor for Lidar.
+// Lidar sees everything in a 9x9 box around the car except its own cell,
+// with high accuracy (0.99), and logs its activation.
+
+static const SensorFootprint LIDAR_FOOTPRINT = {-4, 4, -4, 4, true, false, 0.99, 9.0};
+
+Lidar::Lidar(const string& sensorId) : Lidar(sensorId, LIDAR_FOOTPRINT) {}
+
+Lidar::Lidar(const string& sensorId, const SensorFootprint& sensorFootprint) : Sensor(sensorId, SENSOR_LIDAR, sensorFootprint, DETAIL_NONE) {
+    SIM_EVENT(EV_SENSOR_READY).name(id).arg(SENSOR_LIDAR);
+}
+
+// Destructor for Lidar. Logs deactivation.
+
+Lidar::~Lidar() {
+    SIM_EVENT(EV_SENSOR_OFFLINE).name(id).arg(SENSOR_LIDAR);
 }
 
 // Constructor for Radar.
-// Radar has high accuracy (0.99) and logs its activation.
+// Radar detects only moving objects (cars, bikes, other self-driving cars) in a
+// 12-cell beam straight ahead, with high accuracy (0.99), and reports their motion.
 
-Radar::Radar(const string& sensorId) : Sensor(sensorId, 0.99) {
-    simLog << "[+RADAR: " << id << "] Radar sensor ready I'm a Radio star!" << endl;
+static const SensorFootprint RADAR_FOOTPRINT = {1, 12, 0, 0, false, true, 0.99, 12.0};
+
+Radar::Radar(const string& sensorId) : Radar(sensorId, RADAR_FOOTPRINT) {}
+
+Radar::Radar(const string& sensorId, const SensorFootprint& sensorFootprint) : Sensor(sensorId, SENSOR_RADAR, sensorFootprint, DETAIL_MOTION) {
+    SIM_EVENT(EV_SENSOR_READY).name(id).arg(SENSOR_RADAR);
 }
 
 // Destructor for Radar. Logs deactivation.
 
 Radar::~Radar() {
-    simLog << "[-RADAR: " << id << "] Radar offline" << endl;
+    SIM_EVENT(EV_SENSOR_OFFLINE).name(id).arg(SENSOR_RADAR);
 }
 
-// Scans for MOVING objects (Cars, Bikes) in a long range ahead of the car.
-// The range depends on the car's orientation (up to 12 units ahead).
-
-vector<SensorReading> Radar::getReadings(const vector<WorldObjects*>& allObjects, Position carPos, Direction carDir) {
-    vector<SensorReading> readings;
+// Constructor for Camera.
+// Camera sees a 7x7 field of view in front of the car and identifies traffic
+// light states and signs. It has lower accuracy (0.95) than Lidar/Radar and logs its activation.
 
-    for (size_t i = 0; i < allObjects.size(); i++) {
-        WorldObjects* obj = allObjects[i];
-        char objSymbol = obj->getGlyph();
+static const SensorFootprint CAMERA_FOOTPRINT = {1, 7, -3, 3, false, false, 0.95, 8.0};
 
-        // Radar only detects moving vehicles
-        
-        if (objSymbol != 'C' && objSymbol != 'B') continue;
+Camera::Camera(const string& sensorId) : Camera(sensorId, CAMERA_FOOTPRINT) {}
 
-        MovingObject* movObj = (MovingObject*)obj;
-        Position movObjPos = movObj->getPosition();
-        bool inRange = false;
+Camera::Camera(const string& sensorId, const SensorFootprint& sensorFootprint) : Sensor(sensorId, SENSOR_CAMERA, sensorFootprint, DETAIL_ALL) {
+    SIM_EVENT(EV_SENSOR_READY).name(id).arg(SENSOR_CAMERA);
+}
 
-        // Detection logic based on car direction: straightforward beam
-    
-        if (carDir == NORTH) {
-            if (movObjPos.x == carPos.x && movObjPos.y > carPos.y && movObjPos.y <= carPos.y + 12) inRange = true;
-        }
+// Destructor for Camera. Logs deactivation.
 
-        else if (carDir == SOUTH) {
-            if (movObjPos.x == carPos.x && movObjPos.y < carPos.y && movObjPos.y >= carPos.y - 12) inRange = true;
-        }
+Camera::~Camera() {
+    SIM_EVENT(EV_SENSOR_OFFLINE).name(id).arg(SENSOR_CAMERA);
+}
 
-        else if (carDir == EAST) {
-            if (movObjPos.y == carPos.y && movObjPos.x > carPos.x && movObjPos.x <= carPos.x + 12) inRange = true;
-        }
+// Footprint of the standard sensor of a kind (the constants above).
 
-        else if (carDir == WEST) {
-            if (movObjPos.y == carPos.y && movObjPos.x < carPos.x && movObjPos.x >= carPos.x - 12) inRange = true;
-        }
+SensorFootprint defaultFootprint(SensorKind kind) {
+    if (kind == SENSOR_RADAR) return RADAR_FOOTPRINT;
+    if (kind == SENSOR_CAMERA) return CAMERA_FOOTPRINT;
+    return LIDAR_FOOTPRINT;
+}
 
-        if (inRange) {
-            SensorReading r = createEmptyReading();
-            r.objectID = movObj->getId();
+// Package entry with the default footprint of a kind
 
-            if (objSymbol == 'B') r.type = "BIKE";
-            else r.type = "CAR";
+static SensorSpec defaultSpec(SensorKind kind, const string& sensorId) {
+    SensorFootprint fp = defaultFootprint(kind);
+    return {kind, sensorId, fp.minAhead, fp.maxAhead, fp.minSide, fp.maxSide, fp.accuracy, fp.falloff};
+}
 
-            r.pos = movObjPos;
-            r.distance = calculateDistance(carPos, movObjPos);
-            r.speed = movObj->getSpeed();
-            r.direction = movObj->getDirection();
+// Lidar, Radar and Camera; the order the cars have always built them in.
 
-            // Calculate confidence based on distance and base accuracy.
-            
-            double distFactor = 1.0 - (r.distance / 12.0);
-            if (distFactor < 0.0) distFactor = 0.0;
+vector<SensorSpec> defaultSensorPackage() {
+    return {defaultSpec(SENSOR_LIDAR, "LIDAR"), defaultSpec(SENSOR_RADAR, "RADAR"), defaultSpec(SENSOR_CAMERA, "CAMERA")};
+}
 
-            r.confidence = applyNoise(baseAccuracy * distFactor);
-            readings.push_back(r);
-        }
-    }
-    return readings;
+// The spec replaces the ranges, accuracy and falloff; the origin and mover
+// filters stay those of the kind.
+
+Sensor* createSensor(const SensorSpec& spec) {
+    SensorFootprint fp = defaultFootprint(spec.kind);
+    fp.minAhead = spec.minAhead;
+    fp.maxAhead = spec.maxAhead;
+    fp.minSide = spec.minSide;
+    fp.maxSide = spec.maxSide;
+    fp.accuracy = spec.accuracy;
+    fp.falloff = spec.falloff;
+
+    if (spec.kind == SENSOR_RADAR) return new Radar(spec.id, fp);
+    if (spec.kind == SENSOR_CAMERA) return new Camera(spec.id, fp);
+    return new Lidar(spec.id, fp);
 }
 
-// Constructor for Camera.
-// Camera has lower accuracy (0.95) than Lidar/Radar and logs its activation.
+// Largest offset a package may give a footprint, in cells
+
+static const int MAX_SENSOR_RANGE = 1000;
+
+// Parses 'a..b' or a single number 'a' into an inclusive range.
+
+static bool parseRange(const string& text, int& from, int& to) {
+    size_t dots = text.find("..");
+    string first = text.substr(0, dots);
+    string last = (dots == string::npos) ? first : text.substr(dots + 2);
 
-Camera::Camera(const string& sensorId) : Sensor(sensorId, 0.95) {
-    simLog << "[+CAMERA: " << id << "] Camera sensor ready Say cheese!" << endl;
+    char* end = nullptr;
+    long a = strtol(first.c_str(), &end, 10);
+    if (first.empty() || *end != '\0') return false;
+    long b = strtol(last.c_str(), &end, 10);
+    if (last.empty() || *end != '\0') return false;
+
+    if (a < -MAX_SENSOR_RANGE || b > MAX_SENSOR_RANGE || a > b) return false;
+
+    from = (int)a;
+    to = (int)b;
+    return true;
 }
 
-// Destructor for Camera. Logs deactivation.
+// Parses a plain decimal number.
 
-Camera::~Camera() {
-    simLog << "[-CAMERA: " << id << "] Camera offline" << endl;
+static bool parseNumber(const string& text, double& value) {
+    char* end = nullptr;
+    value = strtod(text.c_str(), &end);
+    return !text.empty() && *end == '\0';
 }
 
-// Scans a rectangular area in front of the car.
-// Capable of identifying Traffic Lights states and Sign text.
-
-vector<SensorReading> Camera:: getReadings(const vector<WorldObjects*>& allObjects, Position carPos, Direction carDir) {
-    vector<SensorReading> readings;
-    int minX = 0, maxX = 0, minY = 0, maxY = 0;
-    
-    // Define Field of View (FOV) based on car direction
-    
-    switch (carDir) {
-        case NORTH:
-            minX = carPos.x - 3;
-            maxX = carPos.x + 3;
-            minY = carPos.y + 1;
-            maxY = carPos.y + 7;
-            break;
-
-        case SOUTH:
-            minX = carPos.x - 3;
-            maxX = carPos.x + 3;
-            minY = carPos.y - 7;
-            maxY = carPos.y - 1;
-            break;
-        
-        case EAST:
-            minX = carPos.x + 1;
-            maxX = carPos.x + 7;
-            minY = carPos.y - 3;
-            maxY = carPos.y + 3;
-            break;
-
-        case WEST:
-            minX = carPos.x - 7;
-            maxX = carPos.x - 1;
-            minY = carPos.y - 3;
-            maxY = carPos.y + 3;
-            break;
+// Reads the package line by line; the first bad line ends the load.
+
+bool loadSensorPackage(const string& path, vector<SensorSpec>& sensors, string& error) {
+    ifstream in(path.c_str());
+    if (!in.is_open()) {
+        error = "Could not open sensor package '" + path + "'!";
+        return false;
     }
 
-    for (size_t i = 0; i < allObjects.size(); i++) {
-        WorldObjects* obj = allObjects[i];
-        Position objPos = obj->getPosition();
-        
-        // Check if object is within FOV
-        
-        if (objPos.x >= minX && objPos.x <= maxX && objPos.y >= minY && objPos.y <= maxY) {
-
-            SensorReading r = createEmptyReading();
-            r.objectID = obj->getId();
-            r.pos = objPos;
-            r.distance = calculateDistance(carPos, objPos);
-
-            char objSymbol = obj->getGlyph();
-
-            // Identify object and extract specific details (light state, sign text, etc.)
-        
-            if (objSymbol == 'R' || objSymbol == 'G' ||objSymbol == 'Y') {
-                r.type = "TRAFFIC_LIGHT";
-                TrafficLight* tl = (TrafficLight*)obj;
-                r.lightState = tl->getState();
-            }
+    sensors.clear();
+    set<string> ids;
+    string line;
+    int lineNumber = 0;
 
-            else if (objSymbol == 'S') {
-                r.type = "TRAFFIC_SIGN";
-                TrafficSign* ts = (TrafficSign*)obj;
-                r.signText = ts->getText();
-            }
+    while (getline(in, line)) {
+        lineNumber++;
+
+        size_t hash = line.find('#');
+        if (hash != string::npos) line = line.substr(0, hash);
+
+        istringstream tokens(line);
+        string kindName, sensorId;
+        if (!(tokens >> kindName)) continue;
+
+        string where = "Line " + to_string(lineNumber) + " of the sensor package";
+        SensorKind kind;
+
+        if (kindName == "lidar") kind = SENSOR_LIDAR;
+        else if (kindName == "radar") kind = SENSOR_RADAR;
+        else if (kindName == "camera") kind = SENSOR_CAMERA;
+        else {
+            error = where + " has an unknown sensor kind '" + kindName + "'.";
+            return false;
+        }
+
+        if (!(tokens >> sensorId)) {
+            error = where + " has no sensor ID.";
+            return false;
+        }
 
-            else if (objSymbol == 'C' || objSymbol == 'B') {
-                if (objSymbol == 'B') r.type = "BIKE";
-                else r.type = "CAR";
+        if (!ids.insert(sensorId).second) {
+            error = where + " repeats the sensor ID '" + sensorId + "'.";
+            return false;
+        }
 
-                MovingObject* movObj = (MovingObject*)obj;
-                r.speed = movObj->getSpeed();
-                r.direction = movObj->getDirection();
+        SensorSpec spec = defaultSpec(kind, sensorId);
+        string token;
+
+        while (tokens >> token) {
+            size_t equals = token.find('=');
+            string key = token.substr(0, equals);
+            string value = (equals == string::npos) ? "" : token.substr(equals + 1);
+            bool valid;
+
+            if (key == "ahead") valid = parseRange(value, spec.minAhead, spec.maxAhead);
+            else if (key == "side") valid = parseRange(value, spec.minSide, spec.maxSide);
+            else if (key == "accuracy") valid = parseNumber(value, spec.accuracy) && spec.accuracy >= 0.0 && spec.accuracy <= 1.0;
+            else if (key == "falloff") valid = parseNumber(value, spec.falloff) && spec.falloff > 0.0;
+            else {
+                error = where + " has an unknown key '" + key + "'.";
+                return false;
             }
 
-            else if (objSymbol == 'P') r.type = "PARKED_CAR";
-            
-            else r.type = "UNKNOWN";
-            
-            // Calculate confidence based on distance and base accuracy.
-            
-            double distFactor = 1.0 - (r.distance / 8.0);
-            if (distFactor < 0.0) distFactor = 0.0;
-
-            r.confidence = applyNoise(baseAccuracy * distFactor);
-            readings.push_back(r);
+            if (!valid) {
+                error = where + " has a bad value in '" + token + "'.";
+                return false;
+            }
         }
+
+        sensors.push_back(spec);
     }
-    return readings;
-}
\ No newline at end of file
+
+    if (sensors.empty()) {
+        error = "The sensor package '" + path + "' has no sensors.";
+        return false;
+    }
+
+    return true;
+}
+
+// Constructor for SensorSuite. The sensors stay owned by the car.
+
+SensorSuite::SensorSuite(const vector<Sensor*>& suiteSensors) : sensors(suiteSensors) {}
+
+// Gathers the bounding box of all footprints once, then lets every sensor scan
+// the shared candidates into the buffer of its kind.
+
+void SensorSuite::getReadings(const SpatialIndex& index, Position carPos, Direction carDir, int tick, vector<SensorReading>* const out[3]) {
+    int minX = 0, minY = 0, maxX = 0, maxY = 0;
+
+    for (size_t s = 0; s < sensors.size(); ++s) {
+        int x0, y0, x1, y1;
+        footprintBox(sensors[s]->getFootprint(), carPos, carDir, x0, y0, x1, y1);
+
+        if (s == 0 || x0 < minX) minX = x0;
+        if (s == 0 || y0 < minY) minY = y0;
+        if (s == 0 || x1 > maxX) maxX = x1;
+        if (s == 0 || y1 > maxY) maxY = y1;
+    }
+
+    candidates.gather(index, minX, minY, maxX, maxY);
+
+    for (int k = 0; k < 3; ++k) out[k]->clear();
+    for (size_t s = 0; s < sensors.size(); ++s) sensors[s]->scanCandidates(candidates, carPos, carDir, tick, *out[sensors[s]->getKind()]);
+
+    PROFILE_COUNT(COUNTER_OBJECTS_SCANNED, candidates.size());
+}
@@ -24,7 +24,38 @@ void printHelp() {
     cout << " --numTrafficLights <n> Number of traffic lights (default : 2)" << endl;
     cout << " --simulationTicks <n> Maximum simulation ticks (default : 100)" << endl;
     cout << " --minConfidenceThreshold <n> Minimum confidence cutoff (default : 0.4)" << endl;
-    cout << " --gps <x1> <y1> [x2 y2 ...] GPS target coordinates (required)" << endl;
+    cout << " --placement <rejection|shuffle> World generation strategy (default : rejection)" << endl;
+    cout << " --spawn-rate <r> Cars and bikes entering at each grid edge per tick, may be fractional (default : 0)" << endl;
+    cout << " --spawn-rates <n> <s> <e> <w> Entry rate per edge: north, south, east, west (default : 0 0 0 0)" << endl;
+    cout << " --target-density <d> Moving objects per cell to keep; without rates the deficit is spawned every tick (default : off)" << endl;
+    cout << " --soa Tick actors from a structure-of-arrays store (default : off)" << endl;
+    cout << " --threads <n> Worker threads for the world tick, implies --soa (default : 1)" << endl;
+    cout << " --noise <hash|philox> Counter-based sensor noise generator (default : hash)" << endl;
+    cout << " --sensor-kernel <auto|avx2|sse4|scalar> Instructions for the sensor range tests (default : auto)" << endl;
+    cout << " --sensors <file> Sensor package of the self-driving cars (format in Sensors.h; default : Lidar, Radar, Camera)" << endl;
+    cout << " --fleet <n> Number of self-driving cars; extra cars get random routes (default : 1)" << endl;
+    cout << " --planner <astar|field|greedy> Route planning for the self-driving cars (default : astar)" << endl;
+    cout << " --field-budget <MB> Memory for cached distance fields with --planner field (default : 256)" << endl;
+    cout << " --log-level <debug|info|warn|error|off> Lowest level written to the log (default : debug)" << endl;
+    cout << " --trace <file> Write a binary trace instead of the text log (decode with avs-trace)" << endl;
+    cout << " --render <none|pov|full|ansi> Map output; ansi redraws only changed cells (default : pov)" << endl;
+    cout << " --render-every <n> Draw the map every n ticks (default : 1)" << endl;
+    cout << " --save-at <tick> Write a snapshot of the world after that tick (default : none)" << endl;
+    cout << " --checkpoint-every <n> Append a delta checkpoint every n ticks after the first snapshot (default : off)" << endl;
+    cout << " --snapshot-file <file> File for --save-at and --checkpoint-every (default : avs.snap)" << endl;
+    cout << " --load <file> Continue from a snapshot instead of generating a world" << endl;
+    cout << " --load-tick <tick> Checkpoint to continue from (default : last in the file)" << endl;
+    cout << " --record-sensors <file> Record every car's sensor batches of every tick to file" << endl;
+    cout << " --replay <file> Run fusion and navigation on a sensor recording and report tick latencies" << endl;
+    cout << " --profile Time the phases of every tick and print a profile at the end (default : off)" << endl;
+    cout << " --profile-csv <file> Write the phase times and counters of every tick to file, implies --profile" << endl;
+    cout << " --profile-trace <file> Write every timed phase to file as a Chrome trace, implies --profile" << endl;
+    cout << " --batch <spec> Run the parameter sweep in the spec file in-process (format in BatchRunner.h)" << endl;
+    cout << " --jobs <n> Concurrent runs of a batch (default : number of cores)" << endl;
+    cout << " --csv <file> Write one row per batch run to file" << endl;
+    cout << " --json <file> Write the batch runs to file as JSON" << endl;
+    cout << " --batch-log-dir <dir> Write a log per batch run into dir (default : no logs)" << endl;
+    cout << " --gps <x1> <y1> [x2 y2 ...] GPS target coordinates (required unless --fleet > 1)" << endl;
     cout << " --help Show this help message" << endl << endl;
     cout << "Example usage:" << endl;
     cout << " ./ oopproj_2025 --seed 12 --dimY 50 --gps 10 20 32 15" << endl;
@@ -47,6 +78,24 @@ SimSettings parseArguments(int argc, char**argv) {
     settings.numTrafficLights = 2;
     settings.simulationTicks = 100;
     settings.minConfidenceThreshold = 0.4;
+    settings.placement = PLACEMENT_REJECTION;
+    settings.useActorStore = false;
+    settings.threads = 1;
+    settings.noiseModel = NOISE_HASH;
+    settings.sensorKernel = KERNEL_AUTO;
+    settings.fleetSize = 1;
+    settings.planner = PLANNER_ASTAR;
+    settings.fieldBudgetMB = 256;
+    settings.logLevel = LOG_DEBUG;
+    settings.render = RENDER_POV;
+    settings.renderEvery = 1;
+    settings.saveAt = -1;
+    settings.checkpointEvery = 0;
+    settings.snapshotPath = "avs.snap";
+    settings.loadTick = -1;
+    settings.profile = false;
+    for (int e = 0; e < 4; ++e) settings.spawnRates[e] = 0.0;
+    settings.targetDensity = 0.0;
 
     settings.helpRequested = false;
 
@@ -99,6 +148,163 @@ SimSettings parseArguments(int argc, char**argv) {
             if ((i + 1) < argc) settings.minConfidenceThreshold = atof(argv[++i]);
         }
 
+        else if (arg == "--placement") {
+            if ((i + 1) < argc) {
+                string mode = argv[++i];
+                if (mode == "shuffle") settings.placement = PLACEMENT_SHUFFLE;
+                else if (mode == "rejection") settings.placement = PLACEMENT_REJECTION;
+                else cout << "Unknown placement mode '" << mode << "'. Using rejection." << endl;
+            }
+        }
+
+        else if (arg == "--spawn-rate") {
+            if ((i + 1) < argc) {
+                double rate = atof(argv[++i]);
+                for (int e = 0; e < 4; ++e) settings.spawnRates[e] = rate < 0.0 ? 0.0 : rate;
+            }
+        }
+
+        else if (arg == "--spawn-rates") {
+            for (int e = 0; e < 4 && (i + 1) < argc; ++e) {
+                double rate = atof(argv[++i]);
+                settings.spawnRates[e] = rate < 0.0 ? 0.0 : rate;
+            }
+        }
+
+        else if (arg == "--target-density") {
+            if ((i + 1) < argc) settings.targetDensity = atof(argv[++i]);
+            if (settings.targetDensity < 0.0) settings.targetDensity = 0.0;
+            if (settings.targetDensity > 1.0) settings.targetDensity = 1.0;
+        }
+
+        else if (arg == "--soa") {
+            settings.useActorStore = true;
+        }
+
+        else if (arg == "--threads") {
+            if ((i + 1) < argc) settings.threads = atoi(argv[++i]);
+            if (settings.threads < 1) settings.threads = 1;
+        }
+
+        else if (arg == "--noise") {
+            if ((i + 1) < argc) {
+                string model = argv[++i];
+                if (model == "philox") settings.noiseModel = NOISE_PHILOX;
+                else if (model == "hash") settings.noiseModel = NOISE_HASH;
+                else cout << "Unknown noise model '" << model << "'. Using hash." << endl;
+            }
+        }
+
+        else if (arg == "--sensor-kernel") {
+            if ((i + 1) < argc) {
+                string kernel = argv[++i];
+                if (kernel == "auto") settings.sensorKernel = KERNEL_AUTO;
+                else if (kernel == "avx2") settings.sensorKernel = KERNEL_AVX2;
+                else if (kernel == "sse4") settings.sensorKernel = KERNEL_SSE4;
+                else if (kernel == "scalar") settings.sensorKernel = KERNEL_SCALAR;
+                else cout << "Unknown sensor kernel '" << kernel << "'. Using auto." << endl;
+            }
+        }
+
+        else if (arg == "--sensors") {
+            if ((i + 1) < argc) settings.sensorPath = argv[++i];
+        }
+
+        else if (arg == "--fleet") {
+            if ((i + 1) < argc) settings.fleetSize = atoi(argv[++i]);
+            if (settings.fleetSize < 1) settings.fleetSize = 1;
+        }
+
+        else if (arg == "--planner") {
+            if ((i + 1) < argc) {
+                string mode = argv[++i];
+                if (mode == "astar") settings.planner = PLANNER_ASTAR;
+                else if (mode == "field") settings.planner = PLANNER_FIELD;
+                else if (mode == "greedy") settings.planner = PLANNER_GREEDY;
+                else cout << "Unknown planner '" << mode << "'. Using astar." << endl;
+            }
+        }
+
+        else if (arg == "--field-budget") {
+            if ((i + 1) < argc) settings.fieldBudgetMB = atoi(argv[++i]);
+            if (settings.fieldBudgetMB < 0) settings.fieldBudgetMB = 0;
+        }
+
+        else if (arg == "--log-level") {
+            if ((i + 1) < argc) {
+                string name = argv[++i];
+                if (name == "debug") settings.logLevel = LOG_DEBUG;
+                else if (name == "info") settings.logLevel = LOG_INFO;
+                else if (name == "warn") settings.logLevel = LOG_WARN;
+                else if (name == "error") settings.logLevel = LOG_ERROR;
+                else if (name == "off") settings.logLevel = LOG_OFF;
+                else cout << "Unknown log level '" << name << "'. Using debug." << endl;
+            }
+        }
+
+        else if (arg == "--trace") {
+            if ((i + 1) < argc) settings.tracePath = argv[++i];
+        }
+
+        else if (arg == "--render") {
+            if ((i + 1) < argc) {
+                string mode = argv[++i];
+                if (mode == "none") settings.render = RENDER_NONE;
+                else if (mode == "pov") settings.render = RENDER_POV;
+                else if (mode == "full") settings.render = RENDER_FULL;
+                else if (mode == "ansi") settings.render = RENDER_ANSI;
+                else cout << "Unknown render mode '" << mode << "'. Using pov." << endl;
+            }
+        }
+
+        else if (arg == "--render-every") {
+            if ((i + 1) < argc) settings.renderEvery = atoi(argv[++i]);
+            if (settings.renderEvery < 1) settings.renderEvery = 1;
+        }
+
+        else if (arg == "--save-at") {
+            if ((i + 1) < argc) settings.saveAt = atoi(argv[++i]);
+        }
+
+        else if (arg == "--checkpoint-every") {
+            if ((i + 1) < argc) settings.checkpointEvery = atoi(argv[++i]);
+            if (settings.checkpointEvery < 0) settings.checkpointEvery = 0;
+        }
+
+        else if (arg == "--snapshot-file") {
+            if ((i + 1) < argc) settings.snapshotPath = argv[++i];
+        }
+
+        else if (arg == "--load") {
+            if ((i + 1) < argc) settings.loadPath = argv[++i];
+        }
+
+        else if (arg == "--load-tick") {
+            if ((i + 1) < argc) settings.loadTick = atoi(argv[++i]);
+        }
+
+        else if (arg == "--record-sensors") {
+            if ((i + 1) < argc) settings.recordPath = argv[++i];
+        }
+
+        else if (arg == "--replay") {
+            if ((i + 1) < argc) settings.replayPath = argv[++i];
+        }
+
+        else if (arg == "--profile") {
+            settings.profile = true;
+        }
+
+        else if (arg == "--profile-csv") {
+            if ((i + 1) < argc) settings.profileCsvPath = argv[++i];
+            settings.profile = true;
+        }
+
+        else if (arg == "--profile-trace") {
+            if ((i + 1) < argc) settings.profileTracePath = argv[++i];
+            settings.profile = true;
+        }
+
         else if (arg == "--gps") {
             while ((i + 2) < argc) {
                 string nextCheck = argv[i + 1];
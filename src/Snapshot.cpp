@@ -0,0 +1,538 @@
+#include <cstring>
+
+#include "../include/Snapshot.h"
+#include "../include/ByteCodec.h"
+
+using namespace std;
+
+// Identifies snapshot files
+
+static const char SNAPSHOT_MAGIC[8] = {'A', 'V', 'S', 'S', 'N', 'A', 'P', '1'};
+
+// Frame kinds
+
+static const unsigned char FRAME_FULL = 0;
+static const unsigned char FRAME_DELTA = 1;
+
+// Header at the start of a snapshot file
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+};
+
+// Full object record.
+
+static void putObject(vector<unsigned char>& out, const ObjectState& obj) {
+    out.push_back((unsigned char)obj.glyph);
+    putString(out, obj.id);
+    putVarint(out, obj.handle);
+    putPosition(out, obj.pos);
+
+    if (obj.glyph == 'C' || obj.glyph == 'B') out.push_back((unsigned char)obj.direction);
+    else if (obj.glyph == 'R' || obj.glyph == 'G' || obj.glyph == 'Y') putVarint(out, obj.timer);
+    else if (obj.glyph == 'S') putString(out, obj.text);
+}
+
+static bool isMover(char glyph) {
+    return glyph == 'C' || glyph == 'B';
+}
+
+static bool isLight(char glyph) {
+    return glyph == 'R' || glyph == 'G' || glyph == 'Y';
+}
+
+static bool readObject(ByteReader& in, ObjectState& obj) {
+    obj.glyph = (char)in.byte();
+    obj.id = in.text();
+    obj.handle = (int)in.varint();
+    obj.pos = in.position();
+    obj.direction = NORTH;
+    obj.timer = 0;
+    obj.text.clear();
+
+    if (isMover(obj.glyph)) obj.direction = (Direction)(in.byte() & 3);
+    else if (isLight(obj.glyph)) obj.timer = (int)in.varint();
+    else if (obj.glyph == 'S') obj.text = in.text();
+    else if (obj.glyph != 'P') return false;
+
+    return !in.failed;
+}
+
+// Car record. Blockers are sorted, so they are stored as gaps.
+
+static void putCar(vector<unsigned char>& out, const CarState& car) {
+    putString(out, car.id);
+    putVarint(out, car.handle);
+    putPosition(out, car.pos);
+    out.push_back((unsigned char)car.direction);
+    out.push_back((unsigned char)car.speedState);
+
+    putVarint(out, car.gpsTargets.size());
+    for (size_t i = 0; i < car.gpsTargets.size(); ++i) putPosition(out, car.gpsTargets[i]);
+
+    putSigned(out, car.currentTargetIndex);
+
+    out.push_back((unsigned char)car.stats.outcome);
+    putSigned(out, car.stats.finishTick);
+    putSigned(out, car.stats.targetsReached);
+    putSigned(out, car.stats.safetyStops);
+    putSigned(out, car.stats.nearMisses);
+    putSigned(out, car.stats.cellsTravelled);
+
+    putVarint(out, car.routeStats.size());
+
+    for (size_t i = 0; i < car.routeStats.size(); ++i) {
+        const RouteStats& route = car.routeStats[i];
+        putPosition(out, route.target);
+        putSigned(out, route.pathLength);
+        putSigned(out, route.repairs);
+        putRaw(out, &route.planMillis, sizeof(route.planMillis));
+    }
+
+    putSigned(out, car.plannedTarget);
+    putSigned(out, car.lastStopSign);
+
+    putVarint(out, car.blockedCells.size());
+    int last = 0;
+
+    for (size_t i = 0; i < car.blockedCells.size(); ++i) {
+        putVarint(out, car.blockedCells[i] - last);
+        last = car.blockedCells[i];
+    }
+
+    putVarint(out, car.path.size());
+    for (size_t i = 0; i < car.path.size(); ++i) putPosition(out, car.path[i]);
+    putVarint(out, car.pathCursor);
+}
+
+static bool readCar(ByteReader& in, CarState& car) {
+    car.id = in.text();
+    car.handle = (int)in.varint();
+    car.pos = in.position();
+    car.direction = (Direction)(in.byte() & 3);
+    car.speedState = (SpeedState)in.byte();
+
+    car.gpsTargets.resize(in.count(2));
+    for (size_t i = 0; i < car.gpsTargets.size(); ++i) car.gpsTargets[i] = in.position();
+
+    car.currentTargetIndex = in.integer();
+
+    car.stats.outcome = (CarOutcome)in.byte();
+    car.stats.finishTick = in.integer();
+    car.stats.targetsReached = in.integer();
+    car.stats.safetyStops = in.integer();
+    car.stats.nearMisses = in.integer();
+    car.stats.cellsTravelled = in.integer();
+
+    car.routeStats.resize(in.count(12));
+
+    for (size_t i = 0; i < car.routeStats.size(); ++i) {
+        RouteStats& route = car.routeStats[i];
+        route.target = in.position();
+        route.pathLength = in.integer();
+        route.repairs = in.integer();
+        in.raw(&route.planMillis, sizeof(route.planMillis));
+    }
+
+    car.plannedTarget = in.integer();
+    car.lastStopSign = in.integer();
+
+    car.blockedCells.resize(in.count(1));
+    int last = 0;
+
+    for (size_t i = 0; i < car.blockedCells.size(); ++i) {
+        last += (int)in.varint();
+        car.blockedCells[i] = last;
+    }
+
+    car.path.resize(in.count(2));
+    for (size_t i = 0; i < car.path.size(); ++i) car.path[i] = in.position();
+    car.pathCursor = (int)in.varint();
+
+    if (car.speedState > FULL_SPEED || car.stats.outcome > CAR_OUT_OF_BOUNDS) return false;
+    if (car.currentTargetIndex < 0 || car.currentTargetIndex > (int)car.gpsTargets.size()) return false;
+    if (car.routeStats.size() != car.gpsTargets.size()) return false;
+    return !in.failed;
+}
+
+static void putCars(vector<unsigned char>& out, const vector<CarState>& cars) {
+    putVarint(out, cars.size());
+    for (size_t i = 0; i < cars.size(); ++i) putCar(out, cars[i]);
+}
+
+static bool readCars(ByteReader& in, vector<CarState>& cars) {
+    cars.resize(in.count(16));
+
+    for (size_t i = 0; i < cars.size(); ++i)
+        if (!readCar(in, cars[i])) return false;
+
+    return !in.failed;
+}
+
+// Constructor. Nothing is open yet.
+
+SnapshotWriter::SnapshotWriter() : file(nullptr), baseWritten(false), frames(0), bytes(0) {}
+
+SnapshotWriter::~SnapshotWriter() {
+    close();
+}
+
+// Creates the file with its header and the world settings.
+
+bool SnapshotWriter::open(const string& path, const SimSettings& settings) {
+    close();
+
+    file = fopen(path.c_str(), "wb");
+    if (file == nullptr) return false;
+
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+
+    buffer.clear();
+    putSigned(buffer, settings.seed);
+    putVarint(buffer, settings.dimX);
+    putVarint(buffer, settings.dimY);
+    buffer.push_back((unsigned char)settings.noiseModel);
+    buffer.push_back((unsigned char)settings.planner);
+    putVarint(buffer, settings.fieldBudgetMB);
+    putRaw(buffer, &settings.minConfidenceThreshold, sizeof(settings.minConfidenceThreshold));
+
+    vector<unsigned char> size;
+    putVarint(size, buffer.size());
+
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(size.data(), 1, size.size(), file);
+    fwrite(buffer.data(), 1, buffer.size(), file);
+
+    baseWritten = false;
+    frames = 0;
+    bytes = sizeof(header) + size.size() + buffer.size();
+    return ferror(file) == 0;
+}
+
+// Writes the encoded payload in 'buffer' as one frame.
+
+bool SnapshotWriter::writeFrame(unsigned char kind) {
+    vector<unsigned char> prefix;
+    prefix.push_back(kind);
+    putVarint(prefix, buffer.size());
+
+    fwrite(prefix.data(), 1, prefix.size(), file);
+    fwrite(buffer.data(), 1, buffer.size(), file);
+    fflush(file);
+
+    frames++;
+    bytes += prefix.size() + buffer.size();
+    return ferror(file) == 0;
+}
+
+// Full frame: every object in list order, then the fleet.
+
+bool SnapshotWriter::writeFull(GridWorld& world) {
+    if (file == nullptr) return false;
+
+    world.saveState(state);
+    world.trackChanges(true);
+
+    buffer.clear();
+    putVarint(buffer, state.tick);
+    putRaw(buffer, &state.rngState, sizeof(state.rngState));
+    putVarint(buffer, state.handleCount);
+
+    putVarint(buffer, state.freeHandles.size());
+    for (size_t i = 0; i < state.freeHandles.size(); ++i) putVarint(buffer, state.freeHandles[i]);
+
+    putVarint(buffer, state.objects.size());
+    for (size_t i = 0; i < state.objects.size(); ++i) putObject(buffer, state.objects[i]);
+
+    putCars(buffer, state.cars);
+
+    // The objects are not needed again; a large world should not keep a second copy
+
+    vector<ObjectState>().swap(state.objects);
+
+    baseWritten = true;
+    return writeFrame(FRAME_FULL);
+}
+
+// Delta frame: the journal, then the moving objects without IDs or handles.
+
+bool SnapshotWriter::writeDelta(GridWorld& world) {
+    if (file == nullptr || !baseWritten) return false;
+
+    world.saveChanges(delta);
+
+    buffer.clear();
+    putVarint(buffer, delta.tick);
+    putRaw(buffer, &delta.rngState, sizeof(delta.rngState));
+
+    putVarint(buffer, delta.changes.size());
+
+    for (size_t i = 0; i < delta.changes.size(); ++i) {
+        const WorldChange& change = delta.changes[i];
+        putSigned(buffer, change.removedSlot);
+        if (change.removedSlot < 0) putObject(buffer, change.added);
+    }
+
+    putVarint(buffer, delta.moving.size());
+
+    for (size_t i = 0; i < delta.moving.size(); ++i) {
+        const ObjectState& obj = delta.moving[i];
+        buffer.push_back((unsigned char)obj.glyph);
+        putPosition(buffer, obj.pos);
+
+        if (isMover(obj.glyph)) buffer.push_back((unsigned char)obj.direction);
+        else putVarint(buffer, obj.timer);
+    }
+
+    putCars(buffer, delta.cars);
+    return writeFrame(FRAME_DELTA);
+}
+
+// Closes the file. Journaling stays on in the world; it is cleared with every delta.
+
+void SnapshotWriter::close() {
+    if (file != nullptr) fclose(file);
+    file = nullptr;
+}
+
+bool SnapshotWriter::isOpen() const {
+    return file != nullptr;
+}
+
+int SnapshotWriter::getFrames() const {
+    return frames;
+}
+
+uint64_t SnapshotWriter::getBytes() const {
+    return bytes;
+}
+
+// Reads the next frame into 'payload'. Returns false at the end of the file.
+
+static bool readFrame(FILE* file, unsigned char& kind, vector<unsigned char>& payload, bool& damaged) {
+    int c = fgetc(file);
+    if (c == EOF) return false;
+
+    uint64_t size = 0;
+    kind = (unsigned char)c;
+
+    if (!readFileVarint(file, size) || size > ((uint64_t)1 << 40)) {
+        damaged = true;
+        return false;
+    }
+
+    payload.resize((size_t)size);
+
+    if (size > 0 && fread(payload.data(), 1, (size_t)size, file) != size) {
+        damaged = true;
+        return false;
+    }
+    return true;
+}
+
+// Decodes a full frame and checks that handles are in range and used once.
+
+static bool readFull(ByteReader& in, WorldState& state) {
+    state.tick = (int)in.varint();
+    in.raw(&state.rngState, sizeof(state.rngState));
+    state.handleCount = (int)in.varint();
+
+    state.freeHandles.resize(in.count(1));
+    for (size_t i = 0; i < state.freeHandles.size(); ++i) state.freeHandles[i] = (int)in.varint();
+
+    state.objects.resize(in.count(5));
+
+    for (size_t i = 0; i < state.objects.size(); ++i)
+        if (!readObject(in, state.objects[i])) return false;
+
+    if (!readCars(in, state.cars) || in.failed || state.handleCount < 0) return false;
+
+    vector<unsigned char> used(state.handleCount, 0);
+
+    for (size_t i = 0; i < state.freeHandles.size(); ++i) {
+        int h = state.freeHandles[i];
+        if (h < 0 || h >= state.handleCount || used[h]) return false;
+        used[h] = 1;
+    }
+
+    for (size_t i = 0; i < state.objects.size(); ++i) {
+        int h = state.objects[i].handle;
+        if (h < 0 || h >= state.handleCount || used[h]) return false;
+        used[h] = 1;
+    }
+
+    for (size_t i = 0; i < state.cars.size(); ++i) {
+        int h = state.cars[i].handle;
+        if (h < 0 || h >= state.handleCount || used[h]) return false;
+        used[h] = 1;
+    }
+
+    return true;
+}
+
+// Decodes a delta frame and applies it: the journal replays the removals
+// (swap-and-pop, freeing the handle) and additions (taking a handle the way
+// GridWorld does), then the moving records overwrite the movers and lights in order.
+
+static bool applyDelta(ByteReader& in, WorldState& state) {
+    state.tick = (int)in.varint();
+    in.raw(&state.rngState, sizeof(state.rngState));
+
+    size_t changeCount = in.count(1);
+
+    for (size_t i = 0; i < changeCount; ++i) {
+        int slot = in.integer();
+
+        if (slot >= 0) {
+            if (slot >= (int)state.objects.size()) return false;
+
+            state.freeHandles.push_back(state.objects[slot].handle);
+            state.objects[slot] = state.objects.back();
+            state.objects.pop_back();
+            continue;
+        }
+
+        ObjectState added;
+        if (!readObject(in, added)) return false;
+
+        int handle = state.handleCount;
+
+        if (!state.freeHandles.empty()) {
+            handle = state.freeHandles.back();
+            state.freeHandles.pop_back();
+        }
+
+        else state.handleCount++;
+
+        if (added.handle != handle) return false;
+        state.objects.push_back(added);
+    }
+
+    size_t movingCount = in.count(4);
+    size_t next = 0;
+
+    for (size_t i = 0; i < state.objects.size(); ++i) {
+        ObjectState& obj = state.objects[i];
+        if (!isMover(obj.glyph) && !isLight(obj.glyph)) continue;
+        if (next++ >= movingCount) return false;
+
+        char glyph = (char)in.byte();
+        if (isMover(glyph) != isMover(obj.glyph)) return false;
+
+        obj.glyph = glyph;
+        obj.pos = in.position();
+
+        if (isMover(glyph)) obj.direction = (Direction)(in.byte() & 3);
+        else obj.timer = (int)in.varint();
+    }
+
+    if (next != movingCount) return false;
+
+    return readCars(in, state.cars) && !in.failed;
+}
+
+// Reads the header, the settings and the frames up to the requested tick.
+
+bool loadSnapshot(const string& path, int tick, SimSettings& settings, WorldState& state, string& error) {
+    FILE* file = fopen(path.c_str(), "rb");
+
+    if (file == nullptr) {
+        error = "Could not open snapshot file '" + path + "'!";
+        return false;
+    }
+
+    SnapshotHeader header;
+
+    if (fread(&header, sizeof(header), 1, file) != 1 || memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0) {
+        error = "'" + path + "' is not a snapshot file.";
+        fclose(file);
+        return false;
+    }
+
+    if (header.version != SNAPSHOT_VERSION) {
+        error = "Unsupported snapshot version " + to_string(header.version) + ".";
+        fclose(file);
+        return false;
+    }
+
+    vector<unsigned char> payload;
+    uint64_t size = 0;
+    bool damaged = !readFileVarint(file, size) || size > 4096;
+
+    if (!damaged) {
+        payload.resize((size_t)size);
+        damaged = fread(payload.data(), 1, (size_t)size, file) != size;
+    }
+
+    ByteReader in = {payload.data(), payload.size(), 0, false};
+    SimSettings saved = settings;
+
+    if (!damaged) {
+        saved.seed = in.integer();
+        saved.dimX = (int)in.varint();
+        saved.dimY = (int)in.varint();
+        saved.noiseModel = (NoiseModel)in.byte();
+        saved.planner = (PlannerMode)in.byte();
+        saved.fieldBudgetMB = (int)in.varint();
+        in.raw(&saved.minConfidenceThreshold, sizeof(saved.minConfidenceThreshold));
+
+        damaged = in.failed || saved.dimX <= 0 || saved.dimY <= 0 || saved.noiseModel > NOISE_PHILOX || saved.planner > PLANNER_FIELD;
+    }
+
+    // The first frame must be complete; deltas are applied until the next frame is past 'tick'
+
+    unsigned char kind = 0;
+    bool haveState = false;
+
+    while (!damaged && readFrame(file, kind, payload, damaged)) {
+        ByteReader frame = {payload.data(), payload.size(), 0, false};
+
+        if (!haveState) {
+            if (kind != FRAME_FULL || !readFull(frame, state)) damaged = true;
+            haveState = true;
+            continue;
+        }
+
+        if (kind != FRAME_DELTA) {
+            damaged = true;
+            break;
+        }
+
+        // Peek at the frame's tick before touching the state
+
+        ByteReader peek = frame;
+        if (tick >= 0 && (int)peek.varint() > tick) break;
+
+        if (!applyDelta(frame, state)) damaged = true;
+    }
+
+    fclose(file);
+
+    if (damaged) {
+        error = "The snapshot file '" + path + "' is damaged.";
+        return false;
+    }
+
+    if (!haveState) {
+        error = "The snapshot file '" + path + "' holds no world.";
+        return false;
+    }
+
+    if (tick >= 0 && state.tick > tick) {
+        error = "The snapshot file '" + path + "' starts at tick " + to_string(state.tick) + ", after tick " + to_string(tick) + ".";
+        return false;
+    }
+
+    // The saved route of the primary car stands in for --gps
+
+    saved.fleetSize = state.cars.empty() ? 1 : (int)state.cars.size();
+    if (!state.cars.empty()) saved.gpsTargets = state.cars[0].gpsTargets;
+
+    settings = saved;
+    return true;
+}
@@ -0,0 +1,120 @@
+#include <algorithm>
+
+#include "../include/SpatialIndex.h"
+#include "../include/WorldObjects.h"
+
+using namespace std;
+
+// Constructor for SpatialIndex.
+// Splits the world into tilesX x tilesY buckets of tileSize x tileSize cells.
+
+SpatialIndex::SpatialIndex(int dimX, int dimY, int tile) : width(dimX), height(dimY), tileSize(tile > 0 ? tile : 1), occupiedCells(0) {
+    tilesX = (width + tileSize - 1) / tileSize;
+    tilesY = (height + tileSize - 1) / tileSize;
+    if (tilesX < 1) tilesX = 1;
+    if (tilesY < 1) tilesY = 1;
+    buckets.resize((size_t)tilesX * tilesY);
+
+    if (width > 0 && height > 0) occupancy.assign((size_t)width * height, 0);
+}
+
+// Returns true if the position lies on the grid.
+
+bool SpatialIndex::inBounds(Position p) const {
+    return p.x >= 0 && p.x < width && p.y >= 0 && p.y < height;
+}
+
+// Maps an in-bounds position to the index of its bucket.
+
+int SpatialIndex::bucketOf(Position p) const {
+    return (p.y / tileSize) * tilesX + (p.x / tileSize);
+}
+
+// Removes an object from a bucket. Order inside a bucket is irrelevant, so swap-and-pop is used.
+
+void SpatialIndex::removeFromBucket(WorldObjects* obj, int bucket) {
+    vector<WorldObjects*>& cell = buckets[bucket];
+
+    for (size_t i = 0; i < cell.size(); ++i) {
+        if (cell[i] == obj) {
+            cell[i] = cell.back();
+            cell.pop_back();
+            return;
+        }
+    }
+}
+
+// Increments the occupancy count of an in-bounds cell.
+
+void SpatialIndex::occupy(Position p) {
+    unsigned short& count = occupancy[(size_t)p.y * width + p.x];
+    if (count++ == 0) occupiedCells++;
+}
+
+// Decrements the occupancy count of an in-bounds cell.
+
+void SpatialIndex::vacate(Position p) {
+    unsigned short& count = occupancy[(size_t)p.y * width + p.x];
+    if (count > 0 && --count == 0) occupiedCells--;
+}
+
+// Adds an object to the bucket of its current position.
+
+void SpatialIndex::insert(WorldObjects* obj) {
+    Position p = obj->getPosition();
+    if (!inBounds(p)) return;
+    buckets[bucketOf(p)].push_back(obj);
+    occupy(p);
+}
+
+// Removes an object indexed at the given position.
+
+void SpatialIndex::remove(WorldObjects* obj, Position at) {
+    if (!inBounds(at)) return;
+    removeFromBucket(obj, bucketOf(at));
+    vacate(at);
+}
+
+// Keeps the index consistent after an object moved.
+// Objects leaving the grid are dropped from the index; they are pruned by GridWorld afterwards.
+
+void SpatialIndex::relocate(WorldObjects* obj, Position from, Position to) {
+    bool wasIn = inBounds(from);
+    bool isIn = inBounds(to);
+
+    if (wasIn) vacate(from);
+    if (isIn) occupy(to);
+
+    if (wasIn && isIn && bucketOf(from) == bucketOf(to)) return;
+
+    if (wasIn) removeFromBucket(obj, bucketOf(from));
+    if (isIn) buckets[bucketOf(to)].push_back(obj);
+}
+
+// Collects every object inside the inclusive box [minX, maxX] x [minY, maxY].
+// Only the buckets overlapping the box are visited.
+
+void SpatialIndex::query(int minX, int minY, int maxX, int maxY, vector<WorldObjects*>& out) const {
+    forEachIn(minX, minY, maxX, maxY, [&out](WorldObjects* obj, Position) { out.push_back(obj); });
+}
+
+// Returns true if at least one object stands on the cell.
+
+bool SpatialIndex::isOccupied(int x, int y) const {
+    if (x < 0 || x >= width || y < 0 || y >= height) return true;
+    return occupancy[(size_t)y * width + x] != 0;
+}
+
+// Accessor for the number of occupied cells.
+
+long long SpatialIndex::getOccupiedCells() const {
+    return occupiedCells;
+}
+
+// Empties all buckets and the occupancy grid.
+
+void SpatialIndex::clear() {
+    for (size_t i = 0; i < buckets.size(); ++i) buckets[i].clear();
+    fill(occupancy.begin(), occupancy.end(), 0);
+    occupiedCells = 0;
+}
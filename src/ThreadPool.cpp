@@ -0,0 +1,100 @@
+#include "../include/ThreadPool.h"
+
+using namespace std;
+
+// Constructor. Starts threads - 1 workers; the caller of run() is the last thread.
+
+ThreadPool::ThreadPool(int threads) : job(nullptr), taskCount(0), nextTask(0), finishedTasks(0), generation(0), stopping(false) {
+    for (int i = 1; i < threads; ++i) workers.push_back(thread(&ThreadPool::workerLoop, this));
+}
+
+// Destructor. Wakes all workers and waits for them to exit.
+
+ThreadPool::~ThreadPool() {
+    {
+        unique_lock<mutex> guard(lock);
+        stopping = true;
+    }
+    wake.notify_all();
+
+    for (size_t i = 0; i < workers.size(); ++i) workers[i].join();
+}
+
+// Number of threads that share a job.
+
+int ThreadPool::size() const {
+    return (int)workers.size() + 1;
+}
+
+// Claims and runs tasks one by one. The lock is released while a task runs.
+
+void ThreadPool::drainTasks(unique_lock<mutex>& guard) {
+    while (nextTask < taskCount) {
+        size_t task = nextTask++;
+
+        guard.unlock();
+        (*job)(task);
+        guard.lock();
+
+        if (++finishedTasks == taskCount) done.notify_all();
+    }
+}
+
+// Worker body: sleeps until a new job generation is published, then helps draining it.
+
+void ThreadPool::workerLoop() {
+    unique_lock<mutex> guard(lock);
+    unsigned long long seen = generation;
+
+    while (true) {
+        wake.wait(guard, [&] { return stopping || generation != seen; });
+        if (stopping) return;
+
+        seen = generation;
+        drainTasks(guard);
+    }
+}
+
+// Publishes a job, helps running it and blocks until every task has finished.
+
+void ThreadPool::run(size_t tasks, const function<void(size_t)>& fn) {
+    if (tasks == 0) return;
+
+    if (workers.empty() || tasks == 1) {
+        for (size_t i = 0; i < tasks; ++i) fn(i);
+        return;
+    }
+
+    unique_lock<mutex> guard(lock);
+    job = &fn;
+    taskCount = tasks;
+    nextTask = 0;
+    finishedTasks = 0;
+    generation++;
+    wake.notify_all();
+
+    drainTasks(guard);
+    done.wait(guard, [&] { return finishedTasks == taskCount; });
+
+    job = nullptr;
+    taskCount = 0;
+}
+
+// Static partition of [0, n) into one chunk per thread.
+// The chunk lambda captures a single pointer so it fits std::function's inline storage.
+
+void ThreadPool::parallelFor(size_t n, const function<void(size_t, size_t)>& fn) {
+    size_t chunks = (size_t)size();
+    if (chunks > n) chunks = n;
+    if (chunks == 0) return;
+
+    struct Split {
+        size_t n;
+        size_t chunks;
+        const function<void(size_t, size_t)>* fn;
+    } split = {n, chunks, &fn};
+
+    run(chunks, [&split](size_t c) {
+        (*split.fn)(split.n * c / split.chunks, split.n * (c + 1) / split.chunks);
+    });
+}
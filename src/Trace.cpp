@@ -0,0 +1,358 @@
+#include <cstdio>
+#include <cstring>
+
+#include "../include/Trace.h"
+#include "../include/Sensors.h"
+#include "../include/VehicleSystem.h"
+
+using namespace std;
+
+const char TRACE_MAGIC[8] = {'A', 'V', 'S', 'T', 'R', 'A', 'C', 'E'};
+
+// Sensor names as written by Lidar, Radar and Camera (the 'arg' of sensor events)
+
+static const char* const SENSOR_TAGS[3] = {"LIDAR", "RADAR", "CAMERA"};
+static const char* const SENSOR_NAMES[3] = {"Lidar", "Radar", "Camera"};
+static const char* const SENSOR_GREETINGS[3] = {"Sensing with pew pews!", "I'm a Radio star!", "Say cheese!"};
+
+// Builds a record with all numbers zero and no name.
+
+TraceRecord makeEvent(EventKind kind, int tick) {
+    TraceRecord record;
+    memset(&record, 0, sizeof(record));
+    record.tick = tick;
+    record.kind = (uint16_t)kind;
+    record.name = -1;
+    return record;
+}
+
+// Fields of a packed record, in the order they follow the mask byte
+
+enum PackedField {PACK_TICK = 1, PACK_ARG = 2, PACK_NAME = 4, PACK_X = 8, PACK_Y = 16, PACK_A = 32, PACK_B = 64, PACK_C = 128};
+
+// Writes an unsigned LEB128 varint.
+
+static size_t putVarint(uint32_t value, unsigned char* out) {
+    size_t length = 0;
+
+    while (value >= 0x80) {
+        out[length++] = (unsigned char)(value | 0x80);
+        value >>= 7;
+    }
+    out[length++] = (unsigned char)value;
+    return length;
+}
+
+// Reads an unsigned varint; returns 0 if the buffer ends first (or it is malformed).
+
+static size_t getVarint(const unsigned char* data, size_t size, uint32_t& value) {
+    value = 0;
+
+    for (size_t i = 0; i < size && i < 5; ++i) {
+        value |= (uint32_t)(data[i] & 0x7f) << (7 * i);
+        if ((data[i] & 0x80) == 0) return i + 1;
+    }
+    return 0;
+}
+
+// Zigzag mapping, so small negative numbers stay short
+
+static uint32_t zigzag(int32_t value) {
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static int32_t unzigzag(uint32_t value) {
+    return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+// Packs a record. Fields that are zero (and a tick equal to the previous one) are left out.
+
+size_t packEvent(const TraceRecord& record, int& lastTick, unsigned char* out) {
+    unsigned char mask = 0;
+    size_t length = 2;
+
+    if (record.tick != lastTick) {
+        mask |= PACK_TICK;
+        length += putVarint(zigzag(record.tick - lastTick), out + length);
+        lastTick = record.tick;
+    }
+    if (record.arg != 0) {
+        mask |= PACK_ARG;
+        length += putVarint(record.arg, out + length);
+    }
+    if (record.name >= 0) {
+        mask |= PACK_NAME;
+        length += putVarint((uint32_t)record.name, out + length);
+    }
+
+    const int32_t values[5] = {record.x, record.y, record.a, record.b, record.c};
+
+    for (int i = 0; i < 5; ++i) {
+        if (values[i] == 0) continue;
+        mask |= (unsigned char)(PACK_X << i);
+        length += putVarint(zigzag(values[i]), out + length);
+    }
+
+    out[0] = (unsigned char)record.kind;
+    out[1] = mask;
+    return length;
+}
+
+// Unpacks a record written by packEvent.
+
+size_t unpackEvent(const unsigned char* data, size_t size, int& lastTick, TraceRecord& record) {
+    if (size < 2) return 0;
+
+    record = makeEvent((EventKind)data[0], lastTick);
+    unsigned char mask = data[1];
+    size_t length = 2;
+    uint32_t value = 0;
+    int32_t values[5] = {0, 0, 0, 0, 0};
+
+    for (int bit = 0; bit < 8; ++bit) {
+        if ((mask & (1 << bit)) == 0) continue;
+
+        size_t used = getVarint(data + length, size - length, value);
+        if (used == 0) return 0;
+        length += used;
+
+        if (bit == 0) record.tick = lastTick + unzigzag(value);
+        else if (bit == 1) record.arg = (uint16_t)value;
+        else if (bit == 2) record.name = (int32_t)value;
+        else values[bit - 3] = unzigzag(value);
+    }
+
+    record.x = values[0];
+    record.y = values[1];
+    record.a = values[2];
+    record.b = values[3];
+    record.c = values[4];
+    lastTick = record.tick;
+    return length;
+}
+
+// Appends a number in printf format.
+
+static void appendNumber(string& out, long long value) {
+    char digits[24];
+    int length = snprintf(digits, sizeof(digits), "%lld", value);
+    out.append(digits, length);
+}
+
+// Appends a world-overfull count. Traces written before the counts were clamped
+// keep its high 32 bits in a position field ('high'), which is zero in newer ones;
+// a count that was clamped to 32 bits reads "2147483647+".
+
+static void appendCount(string& out, int32_t high, int32_t low, bool clamped) {
+    appendNumber(out, (long long)(((uint64_t)(uint32_t)high << 32) | (uint32_t)low));
+    if (clamped) out += "+";
+}
+
+// Text of a "[+TYPE: id] ..." object creation line (arg is the ObjectType).
+
+static const char* objectAddedText(ObjectType type) {
+    switch (type) {
+        case TYPE_TRAFFIC_LIGHT: return "Traffic light added";
+        case TYPE_TRAFFIC_SIGN: return "Traffic sign added";
+        case TYPE_PARKED_CAR: return "Parked car added";
+        case TYPE_CAR: return "Moving car added";
+        case TYPE_BIKE: return "Moving bike added";
+        default: return "Object added";
+    }
+}
+
+// Appends the text form of an event. Reproduces the lines the simulation wrote
+// before the trace format existed, character for character.
+
+void formatEvent(const TraceRecord& record, const string& name, string& out) {
+    int sensor = record.arg <= SENSOR_CAMERA ? (int)record.arg : (int)SENSOR_LIDAR;
+
+    switch ((EventKind)record.kind) {
+        case EV_WORLD_CREATED:
+            out += "[+WORLD: GRID] World initialized ";
+            appendNumber(out, record.x);
+            out += "x";
+            appendNumber(out, record.y);
+            break;
+
+        case EV_WORLD_DESTROYED:
+            out += "[-WORLD] World destroyed.";
+            break;
+
+        case EV_WORLD_NO_FREE_CELL:
+            out += "[WORLD] No free cell for the self-driving car.";
+            break;
+
+        case EV_WORLD_OVERFULL:
+            out += "[WORLD] Requested ";
+            appendCount(out, record.x, record.a, (record.c & 1) != 0);
+            out += " objects but only ";
+            appendCount(out, record.y, record.b, (record.c & 2) != 0);
+            out += " cells are free. Extra objects are skipped.";
+            break;
+
+        case EV_OBJECT_ADDED:
+            out += "[+";
+            out += objectTypeName((ObjectType)record.arg);
+            out += ": ";
+            out += name;
+            out += "] ";
+            out += objectAddedText((ObjectType)record.arg);
+            break;
+
+        case EV_OBJECT_DESTROYED:
+            out += "[-OBJECT: ";
+            out += name;
+            out += "] destroyed.";
+            break;
+
+        case EV_SENSOR_READY:
+            out += "[+";
+            out += SENSOR_TAGS[sensor];
+            out += ": ";
+            out += name;
+            out += "] ";
+            out += SENSOR_NAMES[sensor];
+            out += " sensor ready ";
+            out += SENSOR_GREETINGS[sensor];
+            break;
+
+        case EV_SENSOR_OFFLINE:
+            out += "[-";
+            out += SENSOR_TAGS[sensor];
+            out += ": ";
+            out += name;
+            out += "] ";
+            out += SENSOR_NAMES[sensor];
+            out += " offline";
+            break;
+
+        case EV_SDC_CREATED:
+            out += "[+SDC: ";
+            out += name;
+            out += "] SDC created sensors online";
+            break;
+
+        case EV_SDC_DESTROYED:
+            out += "[-SDC: ";
+            out += name;
+            out += "] SDC destroyed";
+            break;
+
+        case EV_CAR_MOVED:
+            out += "[";
+            out += name;
+            out += "] Moved to (";
+            appendNumber(out, record.x);
+            out += ", ";
+            appendNumber(out, record.y);
+            out += ")";
+            break;
+
+        case EV_NAV_REACHED:
+            out += "[NAV] Reached Target #";
+            appendNumber(out, record.a);
+            out += " at (";
+            appendNumber(out, record.x);
+            out += ",";
+            appendNumber(out, record.y);
+            out += ")";
+            break;
+
+        case EV_PLANNER_PATH:
+            out += "[PLANNER] Target #";
+            appendNumber(out, record.a);
+            out += " path ";
+            appendNumber(out, record.b);
+            out += " cells";
+            break;
+
+        case EV_PLANNER_UNREACHABLE:
+            out += "[PLANNER] Target #";
+            appendNumber(out, record.a);
+            out += " unreachable, steering directly";
+            break;
+
+        case EV_PLANNER_REPAIRED:
+            out += "[PLANNER] Route repaired, path ";
+            appendNumber(out, record.b);
+            out += " cells";
+            break;
+
+        case EV_PLANNER_LOST:
+            out += "[PLANNER] Route lost, steering directly";
+            break;
+
+        case EV_AUTOPILOT_RED_LIGHT:
+            out += "[AUTOPILOT] Red light ahead! Stopping.";
+            break;
+
+        case EV_AUTOPILOT_STOP_SIGN:
+            out += "[AUTOPILOT] STOP sign! Stopping.";
+            break;
+
+        case EV_AUTOPILOT_OBSTACLE:
+            out += "[AUTOPILOT] Obstacle detected (";
+            out += objectTypeName((ObjectType)record.arg);
+            out += ")! Stopping.";
+            break;
+
+        case EV_FLEET_OUT_OF_BOUNDS:
+            out += "[FLEET] ";
+            out += name;
+            out += " went out of bounds at tick ";
+            appendNumber(out, record.tick);
+            break;
+
+        case EV_FLEET_ARRIVED:
+            out += "[FLEET] ";
+            out += name;
+            out += " arrived at tick ";
+            appendNumber(out, record.tick);
+            break;
+
+        case EV_FLEET_SUMMARY:
+            out += "[FLEET] ";
+            out += name;
+            out += " ";
+            out += carOutcomeName((CarOutcome)record.arg);
+            out += " tick=";
+            appendNumber(out, record.x);
+            out += " targets=";
+            appendNumber(out, record.y);
+            out += " stops=";
+            appendNumber(out, record.a);
+            out += " nearMisses=";
+            appendNumber(out, record.b);
+            out += " cells=";
+            appendNumber(out, record.c);
+            break;
+
+        case EV_ERROR_NO_GPS:
+            out += "Error: No GPS targets provided.";
+            break;
+
+        case EV_SIM_END_FLEET:
+            out += "Simulation Ended: All fleet cars finished!";
+            break;
+
+        case EV_SIM_END_OUT_OF_BOUNDS:
+            out += "Simulation Ended: Car went out of bounds!";
+            break;
+
+        case EV_SIM_END_DESTINATION:
+            out += "Simulation Ended: Destination Reached!";
+            break;
+
+        case EV_SIM_FINISHED:
+            out += "Simulation finished after ";
+            appendNumber(out, record.a);
+            out += " ticks.";
+            break;
+
+        default:
+            out += "[TRACE] Unknown event ";
+            appendNumber(out, record.kind);
+            break;
+    }
+}
@@ -2,7 +2,8 @@
 #include <cmath>
 #include <vector>
 #include <string>
-#include <map>
+#include <algorithm>
+#include <chrono>
 
 #include "../include/VehicleSystem.h"
 #include "../include/GridWorld.h"
@@ -10,30 +11,71 @@
 
 using namespace std;
 
+// Most readings a reading buffer is sized for up front
+
+static const size_t MAX_RESERVED_READINGS = 4096;
+
 // SDC Constructor.
 // Initializes the car at a starting position, loads GPS settings, and initializes sensors.
 
-SelfDrivingCar::SelfDrivingCar(int startX, int startY, const GridWorld* wolrdRef, const SimSettings& settings) : MovingObject("SDC", startX, startY, '@', 0,  NORTH), speedState(STOPPED), world(wolrdRef) {
+SelfDrivingCar::SelfDrivingCar(int startX, int startY, const GridWorld* wolrdRef, const SimSettings& settings) : SelfDrivingCar("SDC", startX, startY, wolrdRef, settings, settings.gpsTargets) {}
+
+// Fleet SDC Constructor.
+// Same as above, but with an explicit car ID and GPS route.
+
+SelfDrivingCar::SelfDrivingCar(const string& carID, int startX, int startY, const GridWorld* wolrdRef, const SimSettings& settings, const vector<Position>& route) : MovingObject(carID, startX, startY, '@', 0,  NORTH), speedState(STOPPED), world(wolrdRef), fleetMode(false), plannerMode(settings.planner), planner(nullptr), plannedTarget(-1), lastStopSign(-1) {
     this->minConfidence = settings.minConfidenceThreshold;
-    this->gpsTargets = settings.gpsTargets;
+    this->gpsTargets = route;
     this->currentTargetIndex = 0;
+    this->stats = {CAR_RUNNING, -1, 0, 0, 0, 0};
+
+    for (size_t i = 0; i < gpsTargets.size(); ++i) routeStats.push_back({gpsTargets[i], -1, 0, 0.0});
+
+    if (world != nullptr && plannerMode == PLANNER_ASTAR)
+        planner = new RoutePlanner(world->getWidth(), world->getHeight());
     
-    lidar = new Lidar("LIDAR");
-    radar = new Radar("RADAR");
-    camera = new Camera("CAMERA");
+    // Sensor package from --sensors, or Lidar, Radar and Camera. Sensor noise keys combine
+    // the car and sensor IDs so every sensor instance gets its own samples.
+
+    vector<SensorSpec> package = settings.sensors.empty() ? defaultSensorPackage() : settings.sensors;
+    const NoiseEngine* noise = (world != nullptr) ? world->getNoiseEngine() : nullptr;
+    size_t cells[3] = {0, 0, 0};
+
+    for (size_t s = 0; s < package.size(); ++s) {
+        Sensor* sensor = createSensor(package[s]);
+        sensor->setNoiseEngine(noise, hashString(id + "/" + sensor->getId()));
+        sensor->setOwner(this);
+        sensors.push_back(sensor);
+
+        const SensorFootprint& fp = sensor->getFootprint();
+        cells[sensor->getKind()] += (size_t)(fp.maxAhead - fp.minAhead + 1) * (fp.maxSide - fp.minSide + 1) - (fp.skipOrigin ? 1 : 0);
+    }
 
-    simLog << "[+SDC: " << id << "] SDC created sensors online" << endl;
+    sensorSuite = new SensorSuite(sensors);
+
+    // Size the reading buffers for one object per cell of the footprints of each kind
+    // (80, 12 and 49 for the standard Lidar 9x9 box, Radar 12-cell beam and Camera 7x7
+    // field of view). Very long ranges are capped; the buffers grow if a scan needs it.
+
+    lidarData.reserve(min(cells[SENSOR_LIDAR], MAX_RESERVED_READINGS));
+    radarData.reserve(min(cells[SENSOR_RADAR], MAX_RESERVED_READINGS));
+    cameraData.reserve(min(cells[SENSOR_CAMERA], MAX_RESERVED_READINGS));
+    fusionTouched.reserve(min(cells[0] + cells[1] + cells[2], MAX_RESERVED_READINGS));
+    currentObstacles.reserve(min(cells[0] + cells[1] + cells[2], MAX_RESERVED_READINGS));
+    pendingEvents.reserve(8);
+
+    SIM_EVENT(EV_SDC_CREATED).name(id);
 }
 
 // SDC Destructor.
 // Cleans up dynamically allocated sensors.
 
 SelfDrivingCar::~SelfDrivingCar() {
-    delete lidar;
-    delete radar;
-    delete camera;
+    delete sensorSuite;
+    for (size_t s = 0; s < sensors.size(); ++s) delete sensors[s];
+    delete planner;
 
-    simLog << "[-SDC: " << id << "] SDC destroyed" << endl;
+    SIM_EVENT(EV_SDC_DESTROYED).name(id);
 }
 
 // Increases speed state: STOPPED -> HALF_SPEED -> FULL_SPEED.
@@ -70,79 +112,222 @@ void SelfDrivingCar::turn(Direction newDirection) {
     direction = newDirection;
 }
 
+// Adds a reading to the fusion table, opening the object's entry on first sight.
+
+void SelfDrivingCar::accumulateReading(const SensorReading& r) {
+    int handle = r.objectHandle;
+    if (handle < 0) return;
+
+    if (handle >= (int)fusionTable.size()) {
+        FusionEntry blank = {false, false, 0, 0.0, 0.0, {-1, -1}, createEmptyReading()};
+        fusionTable.resize(handle + 1, blank);
+    }
+
+    FusionEntry& e = fusionTable[handle];
+
+    if (!e.used) {
+        e.used = true;
+        e.sawBike = false;
+        e.count = 0;
+        e.totalScore = 0.0;
+        e.weightedDist = 0.0;
+        e.firstPos = r.pos;
+        e.merged = createEmptyReading();
+        e.merged.objectHandle = handle;
+        fusionTouched.push_back(handle);
+    }
+
+    e.totalScore += r.confidence;
+    e.weightedDist += r.distance * r.confidence;
+
+    if (r.type != TYPE_UNKNOWN) e.merged.type = r.type;
+
+    if (r.type == TYPE_TRAFFIC_LIGHT && r.lightState != RED)
+        e.merged.lightState = r.lightState;
+
+    if (r.type == TYPE_TRAFFIC_SIGN && r.sign != SIGN_NONE)
+        e.merged.sign = r.sign;
+
+    if (r.speed != 0)
+        e.merged.speed = r.speed;
+
+    if (r.type == TYPE_BIKE)
+        e.sawBike = true;
+
+    e.count++;
+}
+
 // Sensor Fusion Algorithm.
-// Takes data from Lidar, Radar, and Camera, groups readings by Object ID, and merges them.
+// Takes data from Lidar, Radar, and Camera, groups readings by object handle, and merges them.
 // Calculates a weighted average for distance and confidence.
 // Prioritizes specific information like Traffic Light color from Camera or Speed from Radar.
+// Readings accumulate straight into the per-handle fusion table; only the touched
+// entries are visited afterwards and reset for the next tick.
 
-vector<SensorReading> SelfDrivingCar::fuseSensorData(
+void SelfDrivingCar::fuseSensorData(
     const vector<SensorReading>& lidarData,
     const vector<SensorReading>& radarData,
-    const vector<SensorReading>& cameraData
+    const vector<SensorReading>& cameraData,
+    vector<SensorReading>& fused
 )
 {
-    // Group all readings by their object ID
-    map<string, vector<SensorReading>> groupedData;
+    fused.clear();
+    fusionTouched.clear();
 
-    for (const auto& r : lidarData)
-        groupedData[r.objectID].push_back(r);
+    // Sensor order decides the merged fields: later sensors overwrite earlier ones
 
-    for (const auto& r: radarData)
-        groupedData[r.objectID].push_back(r);
+    for (size_t i = 0; i < lidarData.size(); ++i) accumulateReading(lidarData[i]);
+    for (size_t i = 0; i < radarData.size(); ++i) accumulateReading(radarData[i]);
+    for (size_t i = 0; i < cameraData.size(); ++i) accumulateReading(cameraData[i]);
 
-    for (const auto& r : cameraData)
-        groupedData[r.objectID].push_back(r);
+    // Emit in handle order so the obstacle list (and the log) does not depend on scan order
 
-    vector<SensorReading> finalResults;
+    sort(fusionTouched.begin(), fusionTouched.end());
 
-    // Process each group to create a single fused reading
+    for (size_t i = 0; i < fusionTouched.size(); ++i) {
+        FusionEntry& e = fusionTable[fusionTouched[i]];
+        SensorReading& merged = e.merged;
 
-    for (auto const& entry : groupedData) {
-        string id = entry.first;
-        vector<SensorReading> readings = entry.second;
+        if (e.totalScore > 0) {
+            merged.distance = e.weightedDist / e.totalScore;
+            merged.confidence = e.totalScore / e.count;
+            merged.pos = e.firstPos;
+        }
 
-        SensorReading merged = createEmptyReading();
-        merged.objectID = id;
+        // Only include objects that meet the confidence threshold or are Bikes (high priority)
+        
+        if (merged.confidence >= this->minConfidence || e.sawBike)
+            fused.push_back(merged);
 
-        double totalScore = 0.0;
-        double weightedDist = 0.0;
-        int count = 0;
-        bool sawBike = false;
+        e.used = false;
+    }
+}
 
-        for (const auto& r : readings) {
-            totalScore += r.confidence;
-            weightedDist += r.distance * r.confidence;
+// Scans the sensors of one kind into its buffer, in package order. Used directly
+// and as a thread pool task.
 
-            if (r.type != "UNKNOWN") merged.type = r.type;
+void SelfDrivingCar::scanSensor(int sensor) {
+    PROFILE_SCOPE((ProfilePhase)(PHASE_LIDAR + sensor));
 
-            if (r.type == "TRAFFIC_LIGHT" && r.lightState != RED)
-                merged.lightState = r.lightState;
+    const SpatialIndex& index = world->getSpatialIndex();
+    int tick = world->getTicks();
+    vector<SensorReading>& buffer = sensorBuffer(sensor);
 
-            if (r.type == "TRAFFIC_SIGN" && r.signText != "N/A")
-                merged.signText = r.signText;
+    buffer.clear();
+    for (size_t s = 0; s < sensors.size(); ++s) {
+        if (sensors[s]->getKind() == sensor) sensors[s]->addReadings(index, pos, direction, tick, buffer);
+    }
+}
 
-            if (r.speed != 0)
-                merged.speed = r.speed;
+// Scans all sensors into their buffers with one traversal of the index.
 
-            if (r.type == "BIKE")
-                sawBike = true;
+void SelfDrivingCar::scanSensors() {
+    PROFILE_SCOPE(PHASE_SENSORS);
 
-            count++;
-        }
+    vector<SensorReading>* const buffers[3] = {&lidarData, &radarData, &cameraData};
+    sensorSuite->getReadings(world->getSpatialIndex(), pos, direction, world->getTicks(), buffers);
+}
+
+// Adds every fused static object (parked car, sign, light) to the planner's blockers.
+
+bool SelfDrivingCar::learnBlockers() {
+    bool added = false;
 
-        if (totalScore > 0) {
-            merged.distance = weightedDist / totalScore;
-            merged.confidence = totalScore / count;
-            merged.pos = readings[0].pos;
+    for (size_t i = 0; i < currentObstacles.size(); ++i) {
+        const SensorReading& r = currentObstacles[i];
+
+        if (r.type == TYPE_PARKED_CAR || r.type == TYPE_TRAFFIC_SIGN || r.type == TYPE_TRAFFIC_LIGHT) {
+            if (planner->addBlocker(r.pos)) added = true;
         }
+    }
+    return added;
+}
 
-        // Only include objects that meet the confidence threshold or are Bikes (high priority)
-        
-        if (merged.confidence >= this->minConfidence || sawBike)
-            finalResults.push_back(merged);
+// Keeps the cached route to the current target up to date and turns onto it.
+// A new target gets a full A* plan; new blockers on the path trigger a local repair.
+// turnAhead is set when the route turns after the next cell, so the car slows
+// down and does not overshoot the corner.
+
+bool SelfDrivingCar::steerAlongRoute(Position target, bool newBlockers, bool& turnAhead) {
+    RouteStats& route = routeStats[currentTargetIndex];
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    bool planned = false;
+
+    if (plannedTarget != currentTargetIndex) {
+        plannedTarget = currentTargetIndex;
+        planner->plan(pos, direction, target);
+        planned = true;
+
+        route.pathLength = planner->getPathLength();
+
+        if (route.pathLength >= 0) queueEvent(EV_PLANNER_PATH, 0, currentTargetIndex + 1, route.pathLength);
+        else queueEvent(EV_PLANNER_UNREACHABLE, 0, currentTargetIndex + 1, 0);
     }
 
-    return finalResults;
+    else if (newBlockers && planner->getPathLength() >= 0 && planner->isPathBlocked()) {
+        planner->repair(pos, direction);
+        planned = true;
+
+        route.repairs++;
+        route.pathLength = planner->getPathLength();
+
+        if (route.pathLength >= 0) queueEvent(EV_PLANNER_REPAIRED, 0, currentTargetIndex + 1, route.pathLength);
+        else queueEvent(EV_PLANNER_LOST, 0, currentTargetIndex + 1, 0);
+    }
+
+    Direction next = direction;
+    int runLength = 0;
+    bool onRoute = planner->follow(pos, next, runLength);
+
+    // Off the cached path (e.g. after waiting out an obstacle): plan again from here
+
+    if (!onRoute && planner->getPathLength() >= 0) {
+        planner->plan(pos, direction, target);
+        planned = true;
+
+        route.repairs++;
+        route.pathLength = planner->getPathLength();
+        onRoute = planner->follow(pos, next, runLength);
+    }
+
+    if (planned) route.planMillis += chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    if (!onRoute) return false;
+
+    turn(next);
+    turnAhead = (runLength < 2);
+    return true;
+}
+
+// Picks up the distance field when the target changes (waiting for the cache's
+// worker only if the field is not finished yet) and queues the next target's field.
+// Steering is then a lookup of the four neighbouring distances.
+
+bool SelfDrivingCar::steerAlongField(Position target, bool& turnAhead) {
+    if (plannedTarget != currentTargetIndex) {
+        RouteStats& route = routeStats[currentTargetIndex];
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        FlowFieldCache* cache = world->getFlowFields();
+
+        plannedTarget = currentTargetIndex;
+        field = cache->acquire(target);
+        if (currentTargetIndex + 1 < (int)gpsTargets.size()) cache->prefetch(gpsTargets[currentTargetIndex + 1]);
+
+        route.planMillis += chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        route.pathLength = (field != nullptr) ? field->distanceAt(pos.x, pos.y) : -1;
+
+        if (route.pathLength >= 0) queueEvent(EV_PLANNER_PATH, 0, currentTargetIndex + 1, route.pathLength);
+        else queueEvent(EV_PLANNER_UNREACHABLE, 0, currentTargetIndex + 1, 0);
+    }
+
+    Direction next = direction;
+    int runLength = 0;
+
+    if (field == nullptr || !field->gradient(pos, direction, next, runLength)) return false;
+
+    turn(next);
+    turnAhead = (runLength < 2);
+    return true;
 }
 
 // Main logic for Autonomous Navigation.
@@ -155,15 +340,38 @@ vector<SensorReading> SelfDrivingCar::fuseSensorData(
 
 void SelfDrivingCar::syncNavigationSystem() {
    if (world == nullptr) return;
- 
-    // Gather Raw Data
 
-    const vector<WorldObjects*> objects = world->getObjects();
-    vector<SensorReading> lidarData = lidar->getReadings(objects, pos, direction);
-    vector<SensorReading> radarData = radar->getReadings(objects, pos, direction);
-    vector<SensorReading> cameraData = camera->getReadings(objects, pos, direction);
+    // Gather Raw Data. With a worker pool the three sensor kinds scan concurrently;
+    // otherwise the sensor suite scans all sensors in a single pass. Sensor noise is
+    // counter-based, so the result does not depend on scheduling.
+
+    ThreadPool* pool = fleetMode ? nullptr : world->getThreadPool();
+
+    if (pool != nullptr) {
+        pool->run(3, [this](size_t sensor) { scanSensor((int)sensor); });
+    }
 
-    vector<SensorReading> currentObstacles = fuseSensorData(lidarData, radarData, cameraData);
+    else {
+        scanSensors();
+    }
+
+    navigate();
+}
+
+// Everything after sensing: fusion, target management, steering and speed control.
+// Works on whatever the sensor buffers hold, so a replay can fill them instead.
+
+void SelfDrivingCar::navigate() {
+    if (world == nullptr) return;
+
+    {
+        PROFILE_SCOPE(PHASE_FUSE);
+        PROFILE_COUNT(COUNTER_READINGS_FUSED, lidarData.size() + radarData.size() + cameraData.size());
+
+        fuseSensorData(lidarData, radarData, cameraData, currentObstacles);
+    }
+
+    PROFILE_SCOPE(PHASE_PLAN);
 
     // Target Management
     
@@ -175,8 +383,9 @@ void SelfDrivingCar::syncNavigationSystem() {
     Position target = gpsTargets[currentTargetIndex];
 
     if (pos.x == target.x && pos.y == target.y) {
-        simLog << "[NAV] Reached Target #" << currentTargetIndex + 1 << " at (" << pos.x << "," << pos.y << ")" << endl;
+        queueEvent(EV_NAV_REACHED, 0, currentTargetIndex + 1, 0);
         currentTargetIndex++;
+        stats.targetsReached = currentTargetIndex;
 
         if (currentTargetIndex < (int) gpsTargets.size()) {
             target = gpsTargets[currentTargetIndex];
@@ -196,57 +405,85 @@ void SelfDrivingCar::syncNavigationSystem() {
     if (distToTarget <= 5) 
         approachingTarget = true;
 
-    int dx = target.x - pos.x;
-    int dy = target.y - pos.y;
+    // Follow the planned route; steer straight at the target when there is none
 
-    if (abs(dx) >= abs(dy)) {
-        if (dx > 0) turn(EAST);
-        else if (dx < 0) turn(WEST);
+    bool turnAhead = false;
+    bool onRoute = false;
 
-        else {
-             if (dy > 0) turn(NORTH);
-             else if (dy < 0) turn(SOUTH);
+    if (planner != nullptr) {
+        bool newBlockers = learnBlockers();
+        onRoute = steerAlongRoute(target, newBlockers, turnAhead);
+    }
+
+    else if (plannerMode == PLANNER_FIELD && world->getFlowFields() != nullptr) {
+        onRoute = steerAlongField(target, turnAhead);
+    }
+
+    if (!onRoute) {
+        int dx = target.x - pos.x;
+        int dy = target.y - pos.y;
+
+        if (abs(dx) >= abs(dy)) {
+            if (dx > 0) turn(EAST);
+            else if (dx < 0) turn(WEST);
+
+            else {
+                 if (dy > 0) turn(NORTH);
+                 else if (dy < 0) turn(SOUTH);
+            }
+            
+        } else {
+            if (dy > 0) turn(NORTH);
+            else if (dy < 0) turn(SOUTH);
         }
-        
-    } else {
-        if (dy > 0) turn(NORTH);
-        else if (dy < 0) turn(SOUTH);
     }
 
     // Obstacle Avoidance Logic
     
     bool safetyStop = false;
     bool cautionarySlow = false;
+    bool nearMiss = false;
 
     for (const auto& obj : currentObstacles) {
-        if (obj.type == "TRAFFIC_LIGHT") {
+        // Only lights ahead count: those are in the camera's view, which is the only
+        // sensor that reads the color (the others report the default RED)
+
+        if (obj.type == TYPE_TRAFFIC_LIGHT && isAhead(obj.pos)) {
             if (obj.lightState == RED && obj.distance <= 3.0) {
                 safetyStop = true;
-                simLog << "[AUTOPILOT] Red light ahead! Stopping." << endl;
+                queueEvent(EV_AUTOPILOT_RED_LIGHT, 0, 0, 0);
             }
             if (obj.lightState == YELLOW && obj.distance <= 3.0) cautionarySlow = true;
         }
         
-        if (obj.type == "TRAFFIC_SIGN" && obj.signText == "STOP" && obj.distance <= 1.0) {
+        // A STOP sign means one full stop; after that the car may go on
+
+        if (obj.type == TYPE_TRAFFIC_SIGN && obj.sign == SIGN_STOP && obj.distance <= 1.0 && obj.objectHandle != lastStopSign) {
             safetyStop = true; 
-            simLog << "[AUTOPILOT] STOP sign! Stopping." << endl;
+            lastStopSign = obj.objectHandle;
+            queueEvent(EV_AUTOPILOT_STOP_SIGN, 0, 0, 0);
         }
 
-        if (obj.type == "CAR" || obj.type == "BIKE" || obj.type == "PARKED_CAR") {
-            if (obj.distance <= 1.0) {
+        if (obj.type == TYPE_CAR || obj.type == TYPE_BIKE || obj.type == TYPE_PARKED_CAR) {
+            if (obj.distance <= 1.0 && isAhead(obj.pos)) {
                 safetyStop = true;
-                simLog << "[AUTOPILOT] Obstacle detected (" << obj.type << ")! Stopping." << endl;
+                queueEvent(EV_AUTOPILOT_OBSTACLE, obj.type, 0, 0);
+
+                if (obj.type != TYPE_PARKED_CAR) nearMiss = true;
             }
         }
     }
 
+    if (safetyStop) stats.safetyStops++;
+    if (nearMiss) stats.nearMisses++;
+
     // Speed Control Execution
     
     if (safetyStop) {
         if (speedState != STOPPED) decelerate();
     }
 
-    else if (cautionarySlow || approachingTarget) {
+    else if (cautionarySlow || approachingTarget || turnAhead) {
         if (speedState == FULL_SPEED) decelerate();
         else if (speedState == STOPPED) accelerate();
     }
@@ -257,19 +494,37 @@ void SelfDrivingCar::syncNavigationSystem() {
 }
 
 // Physically updates the car's position in the world based on its speed and direction.
+// Writes the events collected while planning first, so the log keeps the old order.
 
 void SelfDrivingCar::executeMovement() {
-    move();
+    for (size_t i = 0; i < pendingEvents.size(); ++i)
+        if (SIM_EVENT_ENABLED(pendingEvents[i].kind)) currentLog().event(pendingEvents[i], id);
+    pendingEvents.clear();
+
+    if (speed > 0) {
+        move();
+        stats.cellsTravelled += speed;
+        SIM_EVENT(EV_CAR_MOVED).name(id).at(pos.x, pos.y);
+    }
+}
+
+// Records a navigation event at the car's position for executeMovement to write.
+
+void SelfDrivingCar::queueEvent(EventKind kind, int arg, int a, int b) {
+    TraceRecord record = makeEvent(kind, world != nullptr ? world->getTicks() : 0);
+    record.arg = (uint16_t)arg;
+    record.x = pos.x;
+    record.y = pos.y;
+    record.a = a;
+    record.b = b;
+    pendingEvents.push_back(record);
 }
 
 // Update loop for the car. Calls syncing method and moves if speed > 0.
 
 void SelfDrivingCar::update() {
    syncNavigationSystem();
-   if (speed > 0) {
-        move();
-        simLog << "[SDC] Moved to (" << pos.x << ", " << pos.y << ")" << endl;
-    }
+   executeMovement();
 }
 
 // Returns true if all GPS targets have been visited.
@@ -278,6 +533,134 @@ bool SelfDrivingCar::hasReachedDestination() const{
     return currentTargetIndex >= (int) gpsTargets.size();
 }
 
+// Returns true while the car has neither arrived nor left the grid.
+
+bool SelfDrivingCar::isActive() const {
+    return stats.outcome == CAR_RUNNING;
+}
+
+// Records how and when the car's run ended.
+
+void SelfDrivingCar::markFinished(CarOutcome outcome, int tick) {
+    stats.outcome = outcome;
+    stats.finishTick = tick;
+}
+
+// Accessor for the car's statistics.
+
+const CarStats& SelfDrivingCar::getStats() const {
+    return stats;
+}
+
+// Returns the string representation of the car's outcome.
+
+string SelfDrivingCar::getOutcomeName() const {
+    return carOutcomeName(stats.outcome);
+}
+
+// Name of an outcome as printed in the fleet summary.
+
+const char* carOutcomeName(CarOutcome outcome) {
+    switch(outcome) {
+        case CAR_RUNNING: return "RUNNING";
+        case CAR_ARRIVED: return "ARRIVED";
+        case CAR_OUT_OF_BOUNDS: return "OUT_OF_BOUNDS";
+        default: return "UNKNOWN";
+    }
+}
+
+// Switches between single-car and fleet behaviour (see fleetMode).
+
+void SelfDrivingCar::setFleetMode(bool enabled) {
+    fleetMode = enabled;
+}
+
+// Queues the fields this car needs first, so they are computed in the background.
+
+void SelfDrivingCar::prefetchRoute() const {
+    FlowFieldCache* cache = (world != nullptr) ? world->getFlowFields() : nullptr;
+    if (cache == nullptr) return;
+
+    for (int i = currentTargetIndex; i < (int)gpsTargets.size() && i <= currentTargetIndex + 1; ++i)
+        cache->prefetch(gpsTargets[i]);
+}
+
+// Copies the car's navigation state into a snapshot record.
+
+void SelfDrivingCar::saveState(CarState& state) const {
+    state.id = id;
+    state.handle = handle;
+    state.pos = pos;
+    state.direction = direction;
+    state.speedState = speedState;
+    state.gpsTargets = gpsTargets;
+    state.currentTargetIndex = currentTargetIndex;
+    state.stats = stats;
+    state.routeStats = routeStats;
+    state.plannedTarget = plannedTarget;
+    state.lastStopSign = lastStopSign;
+    state.blockedCells.clear();
+    state.path.clear();
+    state.pathCursor = 0;
+
+    if (planner != nullptr) planner->saveState(state.blockedCells, state.path, state.pathCursor);
+}
+
+// Restores the navigation state of a snapshot record. Speed follows the speed state.
+
+void SelfDrivingCar::restoreState(const CarState& state) {
+    static const int speeds[3] = {0, 1, 2};
+
+    direction = state.direction;
+    speedState = state.speedState;
+    speed = speeds[speedState];
+    currentTargetIndex = state.currentTargetIndex;
+    stats = state.stats;
+    routeStats = state.routeStats;
+    plannedTarget = state.plannedTarget;
+    lastStopSign = state.lastStopSign;
+
+    if (planner != nullptr) planner->restoreState(state.blockedCells, state.path, state.pathCursor);
+
+    // Pick up the distance field of the planned target again (--planner field)
+
+    FlowFieldCache* cache = (world != nullptr) ? world->getFlowFields() : nullptr;
+
+    if (cache != nullptr && plannedTarget >= 0 && plannedTarget < (int)gpsTargets.size()) {
+        field = cache->acquire(gpsTargets[plannedTarget]);
+        if (plannedTarget + 1 < (int)gpsTargets.size()) cache->prefetch(gpsTargets[plannedTarget + 1]);
+    }
+}
+
+// Reading buffer of one sensor (0 = Lidar, 1 = Radar, 2 = Camera).
+
+vector<SensorReading>& SelfDrivingCar::sensorBuffer(int sensor) {
+    if (sensor == 0) return lidarData;
+    if (sensor == 1) return radarData;
+    return cameraData;
+}
+
+// Accessor for the per-target route planning results.
+
+const vector<RouteStats>& SelfDrivingCar::getRouteStats() const {
+    return routeStats;
+}
+
+// Returns true if a position is in the car's cell or in front of it along its heading.
+
+bool SelfDrivingCar::isAhead(Position p) const {
+    int dx = p.x - pos.x;
+    int dy = p.y - pos.y;
+
+    switch (direction) {
+        case NORTH: return dy > 0 || (dx == 0 && dy == 0);
+        case SOUTH: return dy < 0 || (dx == 0 && dy == 0);
+        case EAST: return dx > 0 || (dx == 0 && dy == 0);
+        case WEST: return dx < 0 || (dx == 0 && dy == 0);
+    }
+    return true;
+}
+
 // Returns the string representation of the current speed state.
 
 string SelfDrivingCar::getStatus() const {
@@ -3,13 +3,17 @@
 #include <vector>
 
 #include "../include/WorldObjects.h"
+#include "../include/SpatialIndex.h"
+#include "../include/ActorStore.h"
+#include "../include/Sensors.h"
+#include "../include/Random.h"
 
 using namespace std;
 
 // Constructor for WorldObjects.
 // Initializes common attributes: unique ID, position (x, y), and display glyph.
 
-WorldObjects::WorldObjects(const string& objectID, int x, int y, char g):id(objectID), pos{x, y}, glyph(g) {
+WorldObjects::WorldObjects(const string& objectID, int x, int y, char g):id(objectID), key(hashString(objectID)), handle(-1), pos{x, y}, glyph(g), index(nullptr), store(nullptr), slot(-1) {
     // simLog << "World Object Created (" << id << ")" << endl;
 }
 
@@ -17,7 +21,20 @@ WorldObjects::WorldObjects(const string& objectID, int x, int y, char g):id(obje
 // Logs the destruction of the object.
 
 WorldObjects :: ~WorldObjects() {
-    simLog << "[-OBJECT: " << id << "] destroyed." << endl;
+    SIM_EVENT(EV_OBJECT_DESTROYED).name(id);
+}
+
+// Attaches the object to the world's spatial index (nullptr detaches it).
+
+void WorldObjects::setIndex(SpatialIndex* spatialIndex) {
+    index = spatialIndex;
+}
+
+// Binds the object to an ActorStore slot. Called by the store whenever the slot changes.
+
+void WorldObjects::bindStore(const ActorStore* actorStore, int actorSlot) {
+    store = actorStore;
+    slot = actorSlot;
 }
 
 // Accessor for the object's unique ID.
@@ -26,15 +43,35 @@ const string& WorldObjects::getId() const {
     return id;
 }
  
+// Accessor for the object's hashed ID.
+
+uint64_t WorldObjects::getKey() const {
+    return key;
+}
+ 
+// Accessor for the object's world handle.
+
+int WorldObjects::getHandle() const {
+    return handle;
+}
+
+// Sets the world handle. Called by GridWorld when the object enters or leaves the world.
+
+void WorldObjects::setHandle(int objectHandle) {
+    handle = objectHandle;
+}
+ 
 // Accessor for the object's current position.
 
 Position WorldObjects::getPosition() const {
+    if (store != nullptr) return {store->x[slot], store->y[slot]};
     return pos;
 }
 
 // Accessor for the object's display glyph.
 
 char WorldObjects::getGlyph() const {
+    if (store != nullptr) return store->glyph[slot];
     return glyph;
 }
 
@@ -55,7 +92,7 @@ void StaticObject::update() {
 // Inherits from StaticObject. Starts in RED state.
 
 TrafficLight::TrafficLight(const string& objectID, int x, int y):StaticObject(objectID, x, y, 'R'), state(RED), timer(0) {
-    simLog << "[+TRAFFIC_LIGHT: " << objectID << "] Traffic light added" << endl; 
+    SIM_EVENT(EV_OBJECT_ADDED).name(objectID).arg(TYPE_TRAFFIC_LIGHT);
 }
 
 // Updates the traffic light state based on a timer.
@@ -95,14 +132,32 @@ void TrafficLight::update() {
 // Returns the current state (color) of the traffic light.
 
 LightState TrafficLight::getState() const {
+    if (store != nullptr) return (LightState)store->lightState[slot];
     return state;
 }
+
+// Returns the number of ticks spent in the current state.
+
+int TrafficLight::getTimer() const {
+    if (store != nullptr) return store->lightTimer[slot];
+    return timer;
+}
+
+// Sets the light's state and timer; the glyph follows the state.
+
+void TrafficLight::setState(LightState lightState, int lightTimer) {
+    static const char glyphs[3] = {'R', 'G', 'Y'};
+
+    state = lightState;
+    timer = lightTimer;
+    glyph = glyphs[state];
+}
  
 // Constructor for TrafficSign.
 // Inherits from StaticObject. Stores the sign text (e.g., "STOP").
  
-TrafficSign::TrafficSign(const string& objectID, int x, int y, const string& txt):StaticObject(objectID, x, y, 'S'), text(txt) {
-    simLog << "[+TRAFFIC_SIGN: " << objectID << "] Traffic sign added" << endl;
+TrafficSign::TrafficSign(const string& objectID, int x, int y, const string& txt):StaticObject(objectID, x, y, 'S'), text(txt), signType(txt == "STOP" ? SIGN_STOP : SIGN_NONE) {
+    SIM_EVENT(EV_OBJECT_ADDED).name(objectID).arg(TYPE_TRAFFIC_SIGN);
 }
 
 // Accessor for the sign's text content.
@@ -111,11 +166,17 @@ const string& TrafficSign::getText() const {
     return text;
 }
 
+// Accessor for the sign's meaning, derived from its text.
+
+SignType TrafficSign::getSignType() const {
+    return signType;
+}
+
 // Constructor for StationaryVehicles (parked cars).
 // Inherits from StaticObject. Displayed with 'P'.
  
 StationaryVehicles::StationaryVehicles(const string& objectID, int x, int y):StaticObject(objectID, x, y, 'P') {
-    simLog << "[+PARKED_CAR: " << objectID << "] Parked car added" << endl;
+    SIM_EVENT(EV_OBJECT_ADDED).name(objectID).arg(TYPE_PARKED_CAR);
 }
  
 // Constructor for MovingObject.
@@ -132,8 +193,11 @@ void MovingObject::update() {
 }
 
 // Updates the object's position based on its current direction and speed.
+// Keeps the spatial index (if attached) in sync with the new position.
 
 void MovingObject::move() {
+    Position oldPos = pos;
+
     switch(direction) {
         case NORTH:
             pos.y += speed;
@@ -148,17 +212,21 @@ void MovingObject::move() {
             pos.x -= speed;
             break;
     }
+
+    if (index != nullptr) index->relocate(this, oldPos, pos);
 }
 
 // Accessor for the object's speed.
  
 int MovingObject::getSpeed() const {
+    if (store != nullptr) return store->speed[slot];
     return speed;
 }
 
 // Accessor for the object's direction.
 
 Direction MovingObject::getDirection() const {
+    if (store != nullptr) return (Direction)store->direction[slot];
     return direction;
 
 }
@@ -167,14 +235,14 @@ Direction MovingObject::getDirection() const {
 // Inherits from MovingObject. Displayed with 'C'. Speed 1.
  
 Car::Car(const string& objectID, int x, int y, Direction d):MovingObject(objectID, x, y, 'C', 1, d) {
-    simLog << "[+CAR: " << objectID << "] Moving car added" << endl;
+    SIM_EVENT(EV_OBJECT_ADDED).name(objectID).arg(TYPE_CAR);
 }
  
 // Constructor for Bike.
 // Inherits from MovingObject. Displayed with 'B'. Speed 1.
  
 Bike::Bike(const string& objectID, int x, int y, Direction d):MovingObject(objectID, x, y, 'B', 1, d) {
-    simLog << "[+BIKE: " << objectID << "] Moving bike added" << endl;
+    SIM_EVENT(EV_OBJECT_ADDED).name(objectID).arg(TYPE_BIKE);
 }
 
     
@@ -1,194 +1,413 @@
 #include <iostream>
 #include <vector>
 #include <string>
+#include <algorithm>
+#include <chrono>
 
 #include "../include/Simulation.h"
 #include "../include/GridWorld.h"
 #include "../include/VehicleSystem.h"
 #include "../include/WorldObjects.h"
 #include "../include/Common.h"
+#include "../include/Renderer.h"
+#include "../include/BatchRunner.h"
+#include "../include/Snapshot.h"
+#include "../include/SensorRecording.h"
+#include "../include/Profiler.h"
+#include "../include/SensorKernels.h"
+#include "../include/Sensors.h"
 
 using namespace std;
 
 
-// Global log file stream, used for logging simulation events to a file.
+// Global log, used for logging simulation events to a file.
 
-ofstream simLog;
+AsyncLog simLog;
 
-// Determines the character representation (glyph) for a specific cell in the grid.
-// It checks for the presence of the self-driving car and then iterates through other
-// world objects. If multiple objects occupy the same cell, it prioritizes the display
-// based on a specific order: Traffic Light (R) > Traffic Sign (S) > etc.
+// Prints the outcome counts of a fleet run to the console and one line per car to the log.
 
-char getCellGlyph(GridWorld& world, int x, int y) {
-    SelfDrivingCar* car = world.getCar();
-    if (car != nullptr) {
-        Position carPos = car->getPosition();
-        if (carPos.x == x && carPos.y == y) return '@';
+void printFleetSummary(GridWorld& world) {
+    const vector<SelfDrivingCar*>& fleet = world.getFleet();
+    int arrived = 0, outOfBounds = 0, running = 0;
+
+    for (size_t i = 0; i < fleet.size(); i++) {
+        const CarStats& stats = fleet[i]->getStats();
+
+        if (stats.outcome == CAR_ARRIVED) arrived++;
+        else if (stats.outcome == CAR_OUT_OF_BOUNDS) outOfBounds++;
+        else running++;
+
+        SIM_EVENT(EV_FLEET_SUMMARY).name(fleet[i]->getId()).arg(stats.outcome)
+                                   .at(stats.finishTick, stats.targetsReached)
+                                   .values(stats.safetyStops, stats.nearMisses, stats.cellsTravelled);
     }
 
-    const vector<WorldObjects*>& worldObjects = world.getObjects();
-    vector<char> glyphsInCell;
+    cout << "Fleet of " << fleet.size() << " cars: " << arrived << " arrived, "
+         << outOfBounds << " out of bounds, " << running << " still running." << endl;
+}
+
+// Prints the route planner results: per target for the primary car, totals for a fleet.
+// Planning times are wall-clock, so they are only printed with --profile ('times');
+// otherwise the output is the same for every run with the same seed.
 
-    // Iterate through all objects and collect glyphs for the current coordinates.
-    
-    for (const auto& obj : worldObjects) {
-        Position objPos = obj->getPosition();
-        if (objPos.x == x && objPos.y == y) 
-            glyphsInCell.push_back(obj->getGlyph());
+void printRouteReport(GridWorld& world, bool times) {
+    const vector<SelfDrivingCar*>& fleet = world.getFleet();
+    if (fleet.empty()) return;
+
+    const vector<RouteStats>& routes = fleet[0]->getRouteStats();
+
+    for (size_t i = 0; i < routes.size(); i++) {
+        const RouteStats& r = routes[i];
+        cout << "Route to target #" << i + 1 << " (" << r.target.x << ", " << r.target.y << "): ";
+
+        if (r.pathLength >= 0) cout << r.pathLength << " cells, ";
+        else cout << "no path, ";
+
+        cout << r.repairs << " repairs";
+        if (times) cout << ", planned in " << r.planMillis << " ms";
+        cout << endl;
     }
 
-    if(glyphsInCell.empty()) return '.';
+    if (fleet.size() <= 1) return;
 
-    // Priority check for glyph rendering.
-    
-    for (size_t i = 0; i < glyphsInCell.size(); i++) 
-        if (glyphsInCell[i] == 'R') return 'R';
+    int planned = 0, unreachable = 0, repairs = 0;
+    long long cells = 0;
+    double millis = 0.0;
 
-    for (size_t i = 0; i < glyphsInCell.size(); i++)
-        if (glyphsInCell[i] == 'Y') return 'Y';
+    for (size_t c = 0; c < fleet.size(); c++) {
+        const vector<RouteStats>& carRoutes = fleet[c]->getRouteStats();
 
-    for (size_t i = 0; i < glyphsInCell.size(); i++) 
-        if (glyphsInCell[i] == 'S') return 'S';
+        for (size_t i = 0; i < carRoutes.size(); i++) {
+            if (carRoutes[i].pathLength >= 0) {
+                planned++;
+                cells += carRoutes[i].pathLength;
+            }
 
-    for (size_t i = 0; i < glyphsInCell.size(); i++)
-        if (glyphsInCell[i] == 'B') return 'B';
-    
-    for (size_t i = 0; i < glyphsInCell.size(); i++)
-        if (glyphsInCell[i] == 'C') return 'C';
-        
-    for (size_t i = 0; i < glyphsInCell.size(); i++)
-        if (glyphsInCell[i] == 'G') return 'G';
+            else if (carRoutes[i].planMillis > 0.0) unreachable++;
 
-    for (size_t i = 0; i < glyphsInCell.size(); i++)
-        if (glyphsInCell[i] == 'P') return 'P';
+            repairs += carRoutes[i].repairs;
+            millis += carRoutes[i].planMillis;
+        }
+    }
 
-    return '?';
+    cout << "Fleet routes: " << planned << " planned (avg " << (planned > 0 ? cells / planned : 0) << " cells), "
+         << unreachable << " unreachable, " << repairs << " repairs";
+    if (times) cout << ", " << millis << " ms planning";
+    cout << endl;
 }
 
-// Visualizes the entire grid world state to the console.
-// Iterates through every cell from top-left to bottom-right and prints the glyph.
+// Prints how the distance field cache was used (--planner field).
 
-void visualizationFull(GridWorld& world) {
-    int width = world.getWidth();
-    int height = world.getHeight();
+void printFieldCacheReport(GridWorld& world) {
+    FlowFieldCache* fields = world.getFlowFields();
+    if (fields == nullptr) return;
+
+    cout << "Distance fields: " << fields->getComputed() << " computed, " << fields->getHits() << " cache hits, "
+         << fields->getEvictions() << " evicted, peak " << fields->getPeakBytes() / (1024 * 1024) << " MB" << endl;
+}
 
-    cout << "--- FULL MAP (Tick: " << world.getTicks() << ") ---" << endl;
+// Writes the snapshot due after the current tick, if any. The first frame (at
+// --save-at, or at the start when only --checkpoint-every is given) is complete;
+// with --checkpoint-every a delta follows every n ticks. A write error ends snapshotting.
 
-    for (int y = height - 1; y >= 0; --y) {
-        for (int x = 0; x < width; ++x) {
-            cout << getCellGlyph(world, x, y) << " ";
+void writeDueSnapshot(GridWorld& world, const SimSettings& settings, int firstTick, SnapshotWriter& snapshots) {
+    int tick = world.getTicks();
+    bool written = true;
+
+    if (tick == firstTick && snapshots.getFrames() == 0) {
+        if (!snapshots.open(settings.snapshotPath, settings)) {
+            cout << "Error: Could not open snapshot file '" << settings.snapshotPath << "'!" << endl;
+            return;
         }
-        cout << endl;
+
+        written = snapshots.writeFull(world);
+        if (written && settings.checkpointEvery == 0) snapshots.close();
+    }
+
+    else if (snapshots.isOpen() && tick > firstTick && (tick - firstTick) % settings.checkpointEvery == 0) {
+        written = snapshots.writeDelta(world);
+    }
+
+    if (!written) {
+        cout << "Error: Could not write snapshot file '" << settings.snapshotPath << "'!" << endl;
+        snapshots.close();
+    }
+}
+
+// Prints the profile (--profile) and writes the per-tick files that were asked for.
+
+void writeProfile(const SimSettings& settings) {
+    simProfiler.printReport();
+
+    if (!settings.profileCsvPath.empty()) {
+        if (simProfiler.writeCsv(settings.profileCsvPath)) cout << "Profile: " << simProfiler.getTicks() << " ticks written to " << settings.profileCsvPath << endl;
+        else cout << "Error: Could not write profile file '" << settings.profileCsvPath << "'!" << endl;
+    }
+
+    if (!settings.profileTracePath.empty()) {
+        if (simProfiler.writeChromeTrace(settings.profileTracePath)) cout << "Profile trace written to " << settings.profileTracePath << endl;
+        else cout << "Error: Could not write profile trace '" << settings.profileTracePath << "'!" << endl;
     }
-    cout << "-----------------------------------" << endl;
 }
 
-// Visualizes a limited "Point of View" (POV) area around the self-driving car.
-// Only cells within the specified radius of the car's current position are displayed.
+// Value below which the given fraction of the sorted samples lie (nearest rank).
 
-void visualizationPov(GridWorld& world, int radius) {
-    SelfDrivingCar* car = world.getCar();
-    if (car == nullptr) return;
+double percentile(const vector<double>& sorted, double fraction) {
+    if (sorted.empty()) return 0.0;
+    return sorted[(size_t)(fraction * (sorted.size() - 1) + 0.5)];
+}
+
+// Replays a sensor recording (--replay): generates the recorded world, then hands
+// every recorded tick to the fleet's fusion and navigation as fast as it can.
+// Only replayTick() is timed; reading and decoding the recording is not.
 
-    Position carPos = car->getPosition();
-    int width = world.getWidth();
-    int height = world.getHeight();
+int runReplay(const SimSettings& settings, SensorReplay& replay) {
+    GridWorld world(settings.dimX, settings.dimY);
+    world.generateWorld(settings);
 
-    cout << "--- POV MAP (Radius: " << radius << ") ---" << endl;
+    vector<double> latencies;
+    long long readings = 0;
+    long long diverged = 0;
+    bool damaged = false;
 
-    int startY = carPos.y + radius;
-    int endY = carPos.y - radius;
-    int startX = carPos.x - radius;
-    int endX = carPos.x + radius;
+    if (settings.profile) simProfiler.enable(!settings.profileCsvPath.empty(), !settings.profileTracePath.empty());
 
-    for (int y = startY; y >= endY; --y) {
-        for (int x = startX; x <= endX; ++x) {
-            if (x < 0 || x >= width || y < 0 || y >= height) cout << "X ";
-            else cout << getCellGlyph(world, x, y) << " ";
+    while (replay.nextTick(damaged)) {
+        if (replay.getTick() != world.getTicks() + 1) {
+            damaged = true;
+            break;
         }
-        cout << endl;
+
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        diverged += world.replayTick(replay);
+        latencies.push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - start).count());
+
+        readings += (long long)replay.getReadingCount();
+        simProfiler.endTick(world.getTicks());
     }
-    cout << "-----------------------------------" << endl;
+
+    if (damaged) cout << "Error: The sensor recording is damaged after tick " << world.getTicks() << "." << endl;
+
+    double total = 0.0;
+    for (size_t i = 0; i < latencies.size(); i++) total += latencies[i];
+
+    vector<double> sorted = latencies;
+    sort(sorted.begin(), sorted.end());
+
+    double seconds = total / 1e6;
+
+    cout << "Replayed " << latencies.size() << " ticks (" << readings << " readings) in " << total / 1000.0 << " ms";
+    if (seconds > 0.0) cout << ": " << (long long)(latencies.size() / seconds) << " ticks/sec, " << (long long)(readings / seconds) << " readings/sec";
+    cout << endl;
+
+    cout << "Tick latency (us): p50 " << percentile(sorted, 0.50) << ", p90 " << percentile(sorted, 0.90)
+         << ", p99 " << percentile(sorted, 0.99) << ", max " << (sorted.empty() ? 0.0 : sorted.back()) << endl;
+
+    cout << "Cars off the recorded track: " << diverged << endl;
+
+    if (world.getFleet().size() > 1) printFleetSummary(world);
+    if (settings.planner != PLANNER_GREEDY) printRouteReport(world, settings.profile);
+    if (settings.profile) writeProfile(settings);
+
+    return (damaged || diverged > 0) ? 1 : 0;
 }
 
 int main(int argc, char**argv) {
     
-    // Open the log file for writing simulation events.
-    
-    simLog.open("logs/oopproj_2025.log");
+    // A batch runs its own simulations (see BatchRunner.h).
 
-    if (!simLog.is_open()) {
-        cout << "Error: Could not open log file in logs/ directory!" << endl;
-        cout << "Make sure you are running the program from the project root and the 'logs' folder exists." << endl;
-        return 1;
+    if (isBatchCommand(argc, argv)) {
+        BatchRunner batch(parseBatchArguments(argc, argv));
+        return batch.run();
     }
-    
+
     // Parse command line arguments to configure the simulation settings.
 
     SimSettings settings = parseArguments(argc, argv);
 
-    if (settings.helpRequested) {
-        simLog.close();
-        return 0;
+    if (settings.helpRequested) return 0;
+
+    SensorKernelMode kernel = selectSensorKernel(settings.sensorKernel);
+
+    if (settings.sensorKernel != KERNEL_AUTO && kernel != settings.sensorKernel)
+        cout << "Sensor kernel '" << sensorKernelName(settings.sensorKernel) << "' is not supported by this CPU. Using " << sensorKernelName(kernel) << "." << endl;
+
+    // Every self-driving car gets the sensor package of --sensors
+
+    if (!settings.sensorPath.empty()) {
+        string error;
+
+        if (!loadSensorPackage(settings.sensorPath, settings.sensors, error)) {
+            cout << "Error: " << error << endl;
+            return 1;
+        }
+    }
+
+    // A replay and a run from a snapshot take the world settings saved with them
+
+    SensorReplay replay;
+
+    if (!settings.replayPath.empty()) {
+        string error;
+
+        if (!replay.open(settings.replayPath, settings, error)) {
+            cout << "Error: " << error << endl;
+            return 1;
+        }
     }
 
-    if (settings.gpsTargets.empty()) {
+    if (!settings.recordPath.empty() && !settings.loadPath.empty()) {
+        cout << "Error: Sensor recordings start from a generated world; --record-sensors cannot be used with --load." << endl;
+        return 1;
+    }
+
+    WorldState loaded;
+
+    if (!settings.loadPath.empty()) {
+        string error;
+
+        if (!loadSnapshot(settings.loadPath, settings.loadTick, settings, loaded, error)) {
+            cout << "Error: " << error << endl;
+            return 1;
+        }
+    }
+
+    // Open the log file (or the binary trace) for writing simulation events.
+
+    if (!settings.tracePath.empty()) {
+        if (!simLog.openTrace(settings.tracePath)) {
+            cout << "Error: Could not open trace file '" << settings.tracePath << "'!" << endl;
+            return 1;
+        }
+    }
+
+    else if (!simLog.open("logs/oopproj_2025.log")) {
+        cout << "Error: Could not open log file in logs/ directory!" << endl;
+        cout << "Make sure you are running the program from the project root and the 'logs' folder exists." << endl;
+        return 1;
+    }
+
+    simLog.setLevel(settings.logLevel);
+
+    if (settings.gpsTargets.empty() && settings.fleetSize <= 1) {
         cout << "Error: No GPS targets provided. Use --gps <x> <y> ..." << endl;
-        simLog << "Error: No GPS targets provided." << endl;
+        SIM_EVENT(EV_ERROR_NO_GPS);
         return 1;
     }
     
-    // Seed the random number generator with the provided seed.
-    
-    srand(settings.seed);
+    if (!settings.replayPath.empty()) {
+        int result = runReplay(settings, replay);
+        simLog.close();
+        return result;
+    }
 
     {
         // Initialize the GridWorld and populate it with objects based on settings.
         
         GridWorld world(settings.dimX, settings.dimY);
-        world.generateWorld(settings);
 
-        visualizationFull(world);
+        if (settings.loadPath.empty()) world.generateWorld(settings);
+
+        else {
+            world.restoreState(loaded, settings);
+            loaded = WorldState();
+            cout << "Loaded tick " << world.getTicks() << " from " << settings.loadPath << endl;
+        }
+
+        SensorRecorder recorder;
+
+        if (!settings.recordPath.empty()) {
+            if (!recorder.open(settings.recordPath, settings)) {
+                cout << "Error: Could not open sensor recording '" << settings.recordPath << "'!" << endl;
+                return 1;
+            }
+            world.setRecorder(&recorder);
+        }
+
+        // Snapshots start at --save-at, or right away when only checkpoints are asked for
+
+        SnapshotWriter snapshots;
+        int firstSnapshot = settings.saveAt;
+        if (firstSnapshot < 0 && settings.checkpointEvery > 0) firstSnapshot = world.getTicks();
+
+        if (firstSnapshot >= 0) writeDueSnapshot(world, settings, firstSnapshot, snapshots);
+
+        Renderer renderer(settings.dimX, settings.dimY, settings.render, settings.renderEvery);
+        renderer.showStart(world);
 
         bool simulationRunning = true;
+
+        if (settings.profile) simProfiler.enable(!settings.profileCsvPath.empty(), !settings.profileTracePath.empty());
         
         // Main simulation loop. Continues until the simulation is no longer running
         // or the tick limit is reached.
      
         while (simulationRunning && world.getTicks() < settings.simulationTicks) {
             
-            // Update the world state and visualize the car's POV.
+            // Update the world state and draw the map (the car's POV by default).
 
             world.update();
-            visualizationPov(world, 5);
-            SelfDrivingCar* car = world.getCar();
+
+            {
+                PROFILE_SCOPE(PHASE_RENDER);
+                renderer.showTick(world);
+            }
+
+            simProfiler.endTick(world.getTicks());
+
+            if (firstSnapshot >= 0) writeDueSnapshot(world, settings, firstSnapshot, snapshots);
 
             // Check for end conditions: car out of bounds, destination reached, or car destroyed.
-            
-            if (world.isCarOutOfBounds()) {
+            // A fleet runs until every car has arrived or left the grid.
+
+            RunEnd end = world.checkEnd();
+
+            if (end == RUN_FLEET_DONE) {
+                cout << "Simulation Ended: All fleet cars finished!" << endl;
+                SIM_EVENT(EV_SIM_END_FLEET);
+            }
+
+            else if (end == RUN_OUT_OF_BOUNDS) {
                 cout << "Simulation Ended: Car went out of bounds!" << endl;
-                simLog << "Simulation Ended: Car went out of bounds!" << endl;
-                simulationRunning = false;
+                SIM_EVENT(EV_SIM_END_OUT_OF_BOUNDS);
             }
 
-            else if (car != nullptr && car->hasReachedDestination() && car->getSpeed() == 0) {
+            else if (end == RUN_DESTINATION) {
                 cout << "Simulation Ended: Destination Reached!" << endl;
-                simLog << "Simulation Ended: Destination Reached!" << endl;
-                simulationRunning = false;
+                SIM_EVENT(EV_SIM_END_DESTINATION);
             }
 
-            else if (car == nullptr) {
+            else if (end == RUN_CAR_GONE) {
                 cout << "Simulation Ended: Car is gone!" << endl;
-                simulationRunning = false;
             }
 
+            simulationRunning = (end == RUN_ACTIVE);
         }
 
-        visualizationFull(world);
+        renderer.showEnd(world);
 
         cout << "Simulation finished after " << world.getTicks() << " ticks." << endl;
-        simLog << "Simulation finished after " << world.getTicks() << " ticks." << endl;
+        SIM_EVENT(EV_SIM_FINISHED).values(world.getTicks());
+
+        if (world.getFleet().size() > 1) printFleetSummary(world);
+        if (settings.planner != PLANNER_GREEDY) printRouteReport(world, settings.profile);
+        printFieldCacheReport(world);
+
+        if (world.getSpawned() > 0) {
+            cout << "Traffic: " << world.getSpawned() << " entered at the edges, " << world.getDeparted() << " left the grid, "
+                 << world.getMovers() << " cars and bikes at the end" << endl;
+        }
+
+        if (!settings.recordPath.empty()) {
+            cout << "Sensor recording: " << recorder.getTicks() << " ticks, " << recorder.getReadings() << " readings, "
+                 << recorder.getBytes() << " bytes written to " << settings.recordPath << endl;
+        }
+
+        if (snapshots.getFrames() > 0) {
+            cout << "Snapshots: " << snapshots.getFrames() << " frames, " << snapshots.getBytes() << " bytes written to " << settings.snapshotPath << endl;
+        }
+
+        if (settings.profile) writeProfile(settings);
     }
 
     // Close the log file before program exit. 
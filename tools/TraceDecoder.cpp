@@ -0,0 +1,191 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <climits>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../include/Common.h"
+#include "../include/Trace.h"
+
+using namespace std;
+
+// The simulation objects linked into the decoder refer to the global log; it stays closed.
+
+AsyncLog simLog;
+
+// Bytes read from the file at a time
+
+static const size_t CHUNK_BYTES = 1 << 16;
+
+// Decoder options
+
+struct DecodeOptions {
+    string path;
+    int fromTick;
+    int toTick;
+    string object;
+    bool valid;
+};
+
+// Prints the usage of avs-trace.
+
+void printUsage() {
+    cout << "Usage: avs-trace <trace file> [options]" << endl;
+    cout << "Prints a binary trace (written with avs --trace) in the text log format." << endl;
+    cout << " --from <tick> First tick to print (default : 0)" << endl;
+    cout << " --to <tick> Last tick to print (default : last)" << endl;
+    cout << " --object <id> Only print events of this object, sensor or car" << endl;
+}
+
+// Parses the command line.
+
+DecodeOptions parseOptions(int argc, char** argv) {
+    DecodeOptions options;
+    options.fromTick = 0;
+    options.toTick = INT_MAX;
+    options.valid = true;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+
+        if (arg == "--from" && (i + 1) < argc) options.fromTick = atoi(argv[++i]);
+
+        else if (arg == "--to" && (i + 1) < argc) options.toTick = atoi(argv[++i]);
+
+        else if (arg == "--object" && (i + 1) < argc) options.object = argv[++i];
+
+        else if (arg.substr(0, 2) != "--" && options.path.empty()) options.path = arg;
+
+        else options.valid = false;
+    }
+
+    if (options.path.empty()) options.valid = false;
+    return options;
+}
+
+// Reads the string table stored after the records.
+
+bool readNames(FILE* file, const TraceHeader& header, vector<string>& names) {
+    if (fseek(file, (long)header.namesOffset, SEEK_SET) != 0) return false;
+
+    uint32_t count = 0;
+    if (fread(&count, sizeof(count), 1, file) != 1) return false;
+    names.resize(count);
+
+    for (uint32_t i = 0; i < count; ++i) {
+        uint32_t length = 0;
+        if (fread(&length, sizeof(length), 1, file) != 1) return false;
+
+        names[i].resize(length);
+        if (length > 0 && fread(&names[i][0], 1, length, file) != length) return false;
+    }
+
+    return true;
+}
+
+int main(int argc, char** argv) {
+    DecodeOptions options = parseOptions(argc, argv);
+
+    if (!options.valid) {
+        printUsage();
+        return 1;
+    }
+
+    FILE* file = fopen(options.path.c_str(), "rb");
+    if (file == nullptr) {
+        cerr << "Error: Could not open trace file '" << options.path << "'!" << endl;
+        return 1;
+    }
+
+    // Check the header. A trace whose writer did not close it has no record count.
+
+    TraceHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1 || memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) != 0) {
+        cerr << "Error: '" << options.path << "' is not a complete trace file." << endl;
+        fclose(file);
+        return 1;
+    }
+
+    if (header.version != TRACE_VERSION) {
+        cerr << "Error: Unsupported trace version " << header.version << "." << endl;
+        fclose(file);
+        return 1;
+    }
+
+    vector<string> names;
+    if (!readNames(file, header, names)) {
+        cerr << "Error: The string table of the trace is damaged." << endl;
+        fclose(file);
+        return 1;
+    }
+
+    // With --object only records naming that ID are printed; an unknown ID prints nothing.
+
+    int objectName = -1;
+    bool filterObject = !options.object.empty();
+
+    for (size_t i = 0; i < names.size() && filterObject && objectName < 0; ++i)
+        if (names[i] == options.object) objectName = (int)i;
+
+    if (filterObject && objectName < 0) {
+        fclose(file);
+        return 0;
+    }
+
+    // Unpack the records chunk by chunk; a record cut by the end of a chunk is
+    // moved to the front and completed by the next read.
+
+    fseek(file, (long)sizeof(TraceHeader), SEEK_SET);
+
+    vector<unsigned char> chunk(CHUNK_BYTES);
+    const string noName;
+    string text;
+    uint64_t bytesLeft = header.namesOffset - sizeof(TraceHeader);
+    uint64_t recordsLeft = header.recordCount;
+    size_t filled = 0;
+    int lastTick = 0;
+
+    while (recordsLeft > 0 && (bytesLeft > 0 || filled > 0)) {
+        size_t wanted = chunk.size() - filled;
+        if (wanted > bytesLeft) wanted = (size_t)bytesLeft;
+
+        size_t got = fread(chunk.data() + filled, 1, wanted, file);
+        bytesLeft -= got;
+        filled += got;
+
+        size_t offset = 0;
+        text.clear();
+
+        while (recordsLeft > 0) {
+            TraceRecord record;
+            size_t used = unpackEvent(chunk.data() + offset, filled - offset, lastTick, record);
+            if (used == 0) break;
+
+            offset += used;
+            recordsLeft--;
+
+            if (record.tick < options.fromTick || record.tick > options.toTick) continue;
+            if (filterObject && record.name != objectName) continue;
+
+            bool named = record.name >= 0 && record.name < (int)names.size();
+            formatEvent(record, named ? names[record.name] : noName, text);
+            text += '\n';
+        }
+
+        fwrite(text.data(), 1, text.size(), stdout);
+
+        if (offset == 0 && got == 0) break;
+        memmove(chunk.data(), chunk.data() + offset, filled - offset);
+        filled -= offset;
+    }
+
+    fclose(file);
+
+    if (recordsLeft > 0) {
+        cerr << "Error: The trace ends inside a record." << endl;
+        return 1;
+    }
+    return 0;
+}